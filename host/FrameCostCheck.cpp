@@ -0,0 +1,338 @@
+#include "FrameCostCheck.h"
+#include "MemorySystem.h"
+#include "MeshGenerator.h"
+#include "VertexCacheOptimizer.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+// Same parameters as MeshLoadJob
+static const f32 WELD_TOLERANCE = 1e-5f;
+static const f32 CREASE_ANGLE = 30.0f;
+
+// Generated model for the degenerate facet check
+static const u32 DEGENERATE_TRIANGLES = 3000;
+
+// Normal directions swept by the lighting bake check
+static const int BAKE_CHECK_LATITUDES = 24;
+static const int BAKE_CHECK_LONGITUDES = 48;
+
+/**
+ * Renderer submission paths: display lists, immediate indexed strips and
+ * immediate strips with full vertices
+ */
+struct FrameConfiguration {
+    const char* name;
+    bool displayLists;
+    bool vertexArrays;
+};
+
+static const FrameConfiguration CONFIGURATIONS[] = {
+    { "lists",     true,  true },
+    { "immediate", false, true },
+    { "direct",    false, false },
+};
+
+struct FrameView {
+    const char* name;
+    f32 distance;
+    f32 rotationX;
+    f32 rotationY;
+};
+
+// The default view, views that cull different sides of the model, a close
+// up that selects a finer level of detail and a far view
+static const FrameView VIEWS[] = {
+    { "front", 100.0f,  0.0f, 0.0f },
+    { "above", 100.0f,  0.9f, 0.6f },
+    { "edge",  100.0f, -0.2f, 1.57f },
+    { "close",  15.0f,  0.2f, 0.4f },
+    { "far",   200.0f,  0.5f, 3.1f },
+};
+
+static const int METRIC_COUNT = 5;
+static const char* METRIC_NAMES[METRIC_COUNT] = {
+    "FIFO bytes", "list bytes", "vertices", "primitives", "state changes"
+};
+
+static void GetMetrics(const GXFrameCost& cost, u32 metrics[METRIC_COUNT]) {
+    metrics[0] = cost.fifoBytes;
+    metrics[1] = cost.displayListBytes;
+    metrics[2] = cost.vertices;
+    metrics[3] = cost.primitives;
+    metrics[4] = cost.stateChanges;
+}
+
+FrameCostCheck::FrameCostCheck() : mesh(&MemorySystem::GetMeshArena()), errorCount(0) {
+}
+
+FrameCostCheck::~FrameCostCheck() {
+    renderer.Shutdown();
+}
+
+// The load passes of MeshLoadJob, short of the levels of detail
+static bool PreprocessMesh(Mesh& mesh, const char* modelPath) {
+    if (!mesh.LoadFromSTL(modelPath)) {
+        return false;
+    }
+
+    mesh.Weld(mesh.GetMaxSize() * WELD_TOLERANCE);
+    if (mesh.IsIndexed() && mesh.BuildRenderGeometry(CREASE_ANGLE)) {
+        mesh.OptimizeVertexCache(VertexCacheOptimizer::DEFAULT_CACHE_SIZE);
+        mesh.BuildClusters();
+        mesh.BuildStrips();
+        mesh.Quantize();
+    }
+    return true;
+}
+
+bool FrameCostCheck::Initialize(const char* modelPath) {
+    if (!PreprocessMesh(mesh, modelPath)) {
+        return false;
+    }
+
+    if (!renderer.Initialize(&TVNtsc480IntDf)) {
+        return false;
+    }
+    renderer.AcquireDisplay();
+    return true;
+}
+
+bool FrameCostCheck::RenderFrame(const Camera& camera, const std::string& name, bool measure) {
+    GXRecorder::Reset();
+    renderer.BeginFrame();
+    renderer.RenderMesh(&mesh, camera);
+    renderer.EndFrame();
+
+    bool ok = true;
+    for (const std::string& error : GXRecorder::GetErrors()) {
+        printf("ERROR: %s: %s\n", name.c_str(), error.c_str());
+        ok = false;
+    }
+
+    // The renderer counts its own submissions; they must match what it sent
+    const GXFrameCost& cost = GXRecorder::GetCost();
+    if (renderer.GetFrameStats().vertices != cost.vertices) {
+        printf("ERROR: %s: renderer counted %u vertices, %u were sent\n", name.c_str(),
+               renderer.GetFrameStats().vertices, cost.vertices);
+        ok = false;
+    }
+
+    if (measure) {
+        FrameCostSample sample;
+        sample.name = name;
+        sample.cost = cost;
+        samples.push_back(sample);
+    }
+    return ok;
+}
+
+bool FrameCostCheck::Measure() {
+    samples.clear();
+    errorCount = 0;
+
+    // At full detail, then as the viewer draws the model once the loader
+    // has built the levels of detail: at the level each view selects
+    MeasureConfigurations("full");
+    if (mesh.HasRenderGeometry() && mesh.BuildLods()) {
+        MeasureConfigurations("lod");
+    }
+    return errorCount == 0;
+}
+
+void FrameCostCheck::MeasureConfigurations(const char* phase) {
+    for (const FrameConfiguration& configuration : CONFIGURATIONS) {
+        renderer.SetDisplayListsEnabled(configuration.displayLists);
+        renderer.SetVertexArraysEnabled(configuration.vertexArrays);
+
+        for (const FrameView& view : VIEWS) {
+            Camera camera;
+            camera.SetDistance(view.distance);
+            camera.SetRotation(view.rotationX, view.rotationY);
+
+            std::string name = std::string(phase) + "/" + configuration.name + "/" + view.name;
+            for (int frame = 0; frame < 2; frame++) {
+                if (!RenderFrame(camera, name, frame == 1)) {
+                    errorCount++;
+                }
+            }
+        }
+    }
+}
+
+bool FrameCostCheck::CheckDegenerateFacets(const char* directory) {
+    std::string path = std::string(directory) + "/degenerate_check.stl";
+    if (!MeshGenerator::Write(path.c_str(), MESH_SHAPE_DEGENERATE, DEGENERATE_TRIANGLES, false)) {
+        return false;
+    }
+
+    // Zero-area facets have zero normals, which once left corners without
+    // a render vertex; every index the passes build must address one
+    Mesh mesh(&MemorySystem::GetMeshArena());
+    bool loaded = PreprocessMesh(mesh, path.c_str());
+    unlink(path.c_str());
+    if (!loaded || !mesh.HasStrips() || mesh.GetLoadStats().degenerateTriangles == 0) {
+        printf("ERROR: Degenerate facet check could not build strips for %s\n", path.c_str());
+        return false;
+    }
+
+    u32 vertexCount = static_cast<u32>(mesh.GetRenderVertexCount());
+    u32 indexCount = static_cast<u32>(mesh.GetTriangleCount()) * 3;
+    u32 badIndices = 0;
+    for (u32 i = 0; i < indexCount; i++) {
+        badIndices += (mesh.GetRenderIndices()[i] >= vertexCount);
+    }
+    const StripSet& strips = mesh.GetStrips();
+    for (u32 i = 0; i < strips.indexCount; i++) {
+        badIndices += (strips.indices[i] >= vertexCount);
+    }
+
+    if (badIndices > 0) {
+        printf("ERROR: %u render indices of %s are out of range (%u render vertices)\n", badIndices,
+               path.c_str(), vertexCount);
+        return false;
+    }
+    printf("Degenerate facet check passed (%u zero-area facets, %u render vertices)\n",
+           mesh.GetLoadStats().degenerateTriangles, vertexCount);
+    return true;
+}
+
+bool FrameCostCheck::CheckLightingBake() {
+    // Every direction of a latitude/longitude grid plus the axes, where
+    // lights are exactly grazing or the sum saturates
+    std::vector<Vector3> directions;
+    for (int lat = 0; lat <= BAKE_CHECK_LATITUDES; lat++) {
+        f32 theta = static_cast<f32>(M_PI) * lat / BAKE_CHECK_LATITUDES;
+        for (int lon = 0; lon < BAKE_CHECK_LONGITUDES; lon++) {
+            f32 phi = 2.0f * static_cast<f32>(M_PI) * lon / BAKE_CHECK_LONGITUDES;
+            directions.push_back(Vector3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)));
+        }
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        for (f32 sign = -1.0f; sign <= 1.0f; sign += 2.0f) {
+            directions.push_back(Vector3(axis == 0 ? sign : 0.0f, axis == 1 ? sign : 0.0f,
+                                         axis == 2 ? sign : 0.0f));
+        }
+    }
+
+    // Each channel takes every value from 0 to 255 across the materials
+    std::vector<Vector3> normals;
+    std::vector<u32> materials;
+    std::vector<u32> baked;
+    for (u32 level = 0; level < 256; level++) {
+        u32 material = (level << 24) | ((255 - level) << 16) | (((level * 97) & 0xff) << 8) | 0xff;
+        for (const Vector3& normal : directions) {
+            normals.push_back(normal);
+            materials.push_back(material);
+            baked.push_back(LightingSystem::ApplyLighting(material, normal));
+        }
+    }
+
+    u32 count = static_cast<u32>(baked.size());
+    u32 error = LightingSystem::ValidateBake(&normals[0], &materials[0], &baked[0], count, 1);
+    if (error > 0) {
+        printf("ERROR: Baked lighting differs from the reference by %u/255 over %u samples\n", error, count);
+        return false;
+    }
+    printf("Lighting bake check passed (%zu normals x 256 materials within 1/255)\n", directions.size());
+    return true;
+}
+
+void FrameCostCheck::PrintReport() const {
+    printf("%-24s %10s %10s %9s %10s %9s %7s\n", "frame", "FIFO B", "list B", "vertices",
+           "primitives", "state", "calls");
+    for (const FrameCostSample& sample : samples) {
+        const GXFrameCost& cost = sample.cost;
+        printf("%-24s %10u %10u %9u %10u %9u %7u\n", sample.name.c_str(), cost.fifoBytes,
+               cost.displayListBytes, cost.vertices, cost.primitives, cost.stateChanges, cost.listCalls);
+    }
+}
+
+bool FrameCostCheck::CompareWithBaseline(const char* path) const {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        printf("ERROR: Cannot open baseline: %s\n", path);
+        return false;
+    }
+
+    std::vector<FrameCostSample> baseline;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char name[64];
+        FrameCostSample entry;
+        GXFrameCost& cost = entry.cost;
+        if (line[0] == '#' ||
+            sscanf(line, "%63s %u %u %u %u %u", name, &cost.fifoBytes, &cost.displayListBytes,
+                   &cost.vertices, &cost.primitives, &cost.stateChanges) != 6) {
+            continue;
+        }
+        entry.name = name;
+        baseline.push_back(entry);
+    }
+    fclose(file);
+
+    bool ok = (errorCount == 0);
+    u32 improvements = 0;
+    for (const FrameCostSample& sample : samples) {
+        const FrameCostSample* expected = nullptr;
+        for (const FrameCostSample& entry : baseline) {
+            if (entry.name == sample.name) {
+                expected = &entry;
+                break;
+            }
+        }
+        if (!expected) {
+            printf("FAIL: %s is not in the baseline\n", sample.name.c_str());
+            ok = false;
+            continue;
+        }
+
+        u32 actual[METRIC_COUNT];
+        u32 limit[METRIC_COUNT];
+        GetMetrics(sample.cost, actual);
+        GetMetrics(expected->cost, limit);
+        for (int i = 0; i < METRIC_COUNT; i++) {
+            if (actual[i] > limit[i]) {
+                printf("FAIL: %s: %s rose from %u to %u (+%.1f%%)\n", sample.name.c_str(), METRIC_NAMES[i],
+                       limit[i], actual[i], 100.0f * (actual[i] - limit[i]) / (limit[i] ? limit[i] : 1));
+                ok = false;
+            } else if (actual[i] < limit[i]) {
+                improvements++;
+            }
+        }
+    }
+
+    if (ok && improvements > 0) {
+        printf("%u metric(s) improved on the baseline; rerun with --update to lock them in\n", improvements);
+    }
+    printf("Frame cost check %s (%u frames against %s)\n", ok ? "passed" : "FAILED",
+           static_cast<u32>(samples.size()), path);
+    return ok;
+}
+
+bool FrameCostCheck::WriteBaseline(const char* path) const {
+    if (errorCount > 0) {
+        printf("ERROR: Not writing a baseline from frames with errors\n");
+        return false;
+    }
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        printf("ERROR: Cannot write baseline: %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "# Frame costs of bitcoin.stl recorded by host/framecheck; regenerate with\n");
+    fprintf(file, "# make -C host update-baseline after an intended change\n");
+    fprintf(file, "# frame fifo_bytes list_bytes vertices primitives state_changes\n");
+    for (const FrameCostSample& sample : samples) {
+        const GXFrameCost& cost = sample.cost;
+        fprintf(file, "%s %u %u %u %u %u\n", sample.name.c_str(), cost.fifoBytes, cost.displayListBytes,
+                cost.vertices, cost.primitives, cost.stateChanges);
+    }
+    fclose(file);
+
+    printf("Wrote %u frame costs to %s\n", static_cast<u32>(samples.size()), path);
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef FRAME_COST_CHECK_H
+#define FRAME_COST_CHECK_H
+
+#include <string>
+#include <vector>
+#include "Mesh.h"
+#include "Renderer.h"
+#include "GXRecorder.h"
+
+/**
+ * Recorded cost of one frame: a renderer configuration and a camera view
+ */
+struct FrameCostSample {
+    std::string name;
+    GXFrameCost cost;
+};
+
+/**
+ * Renders a model from fixed views through the real Renderer with GX
+ * recorded, and compares what each frame would send to the GPU with a
+ * baseline. The HUD is left off: its text shows live timings, so its cost
+ * varies from run to run.
+ */
+class FrameCostCheck {
+public:
+    FrameCostCheck();
+    ~FrameCostCheck();
+
+    // Load and preprocess the model as MeshLoadJob does, then set up the
+    // renderer
+    bool Initialize(const char* modelPath);
+
+    // Render every view under each configuration, before and after the
+    // levels of detail are built; each view's second frame is measured,
+    // after display lists have been compiled
+    bool Measure();
+
+    void PrintReport() const;
+
+    // False if any frame costs more than in the baseline, a frame is
+    // missing from it, or the recorder saw malformed commands
+    bool CompareWithBaseline(const char* path) const;
+    bool WriteBaseline(const char* path) const;
+
+    // Run the load passes over a generated sphere with zero-area facets,
+    // written to directory, and fail if any render index is out of range
+    static bool CheckDegenerateFacets(const char* directory);
+
+    // Bake a sweep of unit normals and materials as Renderer::BakeLighting
+    // does, and fail if any channel is a whole step or more from the
+    // double precision reference
+    static bool CheckLightingBake();
+
+private:
+    Mesh mesh;
+    Renderer renderer;
+    std::vector<FrameCostSample> samples;
+    u32 errorCount;
+
+    void MeasureConfigurations(const char* phase);
+    bool RenderFrame(const Camera& camera, const std::string& name, bool measure);
+};
+
+#endif // FRAME_COST_CHECK_H
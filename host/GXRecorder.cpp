@@ -0,0 +1,858 @@
+#include "GXRecorder.h"
+#include <gccore.h>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+namespace {
+
+// FIFO cost of libogc's register writes
+const u32 BP_WRITE = 5;             // Opcode + register and value
+const u32 CP_WRITE = 6;             // Opcode + register + value
+const u32 PRIMITIVE_HEADER = 3;     // Opcode + u16 vertex count
+const u32 LIST_CALL_BYTES = 9;      // Opcode + address + size
+const u32 FLUSH_BYTES = 32;         // GX_Flush pads the write gather pipe
+
+inline u32 XfWrite(u32 words) {
+    return 5 + 4 * words;           // Opcode + length and address + words
+}
+
+const u32 MAX_ERRORS = 100;
+
+struct DisplayListRecord {
+    u32 size;
+    GXFrameCost cost;
+};
+
+/**
+ * Everything the recorder knows about the GPU
+ */
+struct RecorderState {
+    std::vector<GXCommand> commands;
+    GXFrameCost cost;
+    std::vector<std::string> errors;
+    u32 bytesSinceFlush;
+
+    // Display list being recorded, and the ones recorded so far
+    bool recordingList;
+    void* listBase;
+    u32 listCapacity;
+    u32 listBytes;
+    GXFrameCost listCost;
+    std::map<const void*, DisplayListRecord> lists;
+
+    // Vertex descriptor and formats; libogc sends them with the next GX_Begin
+    u8 vertexDesc[GX_VA_MAX];
+    bool descDirty;
+    bool formatDirty[GX_MAXVTXFMT];
+
+    // Primitive being recorded
+    bool inPrimitive;
+    const char* primitiveName;
+    u32 declaredVertices;
+    u32 attributesSent[GX_VA_MAX];
+    u32 primitiveBytes;
+    bool mismatchReported;
+
+    GXDrawDoneCallback drawDoneCallback;
+    VIRetraceCallback retraceCallback;
+    u32 retraceCount;
+
+    RecorderState() : bytesSinceFlush(0), recordingList(false), listBase(nullptr), listCapacity(0),
+                      listBytes(0), descDirty(true), inPrimitive(false), primitiveName(nullptr),
+                      declaredVertices(0), primitiveBytes(0), mismatchReported(false),
+                      drawDoneCallback(nullptr), retraceCallback(nullptr), retraceCount(0) {
+        memset(vertexDesc, GX_NONE, sizeof(vertexDesc));
+        memset(attributesSent, 0, sizeof(attributesSent));
+        for (int i = 0; i < GX_MAXVTXFMT; i++) {
+            formatDirty[i] = true;
+        }
+    }
+};
+
+RecorderState state;
+
+void AddError(const char* format, ...) {
+    if (state.errors.size() > MAX_ERRORS) {
+        return;
+    }
+    if (state.errors.size() == MAX_ERRORS) {
+        state.errors.push_back("further errors omitted");
+        return;
+    }
+
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    state.errors.push_back(message);
+}
+
+void AccountCost(GXFrameCost& cost, GXCommandKind kind, u32 vertices, u32 primitives) {
+    cost.vertices += vertices;
+    cost.primitives += primitives;
+    if (kind == GX_COMMAND_STATE || kind == GX_COMMAND_MATRIX) {
+        cost.stateChanges++;
+    } else if (kind == GX_COMMAND_COPY) {
+        cost.copies++;
+    }
+}
+
+void Record(const char* name, GXCommandKind kind, u32 bytes, u32 vertices = 0, u32 primitives = 0) {
+    if (state.inPrimitive && kind != GX_COMMAND_PRIMITIVE) {
+        AddError("%s inside GX_Begin/GX_End", name);
+    }
+
+    // Commands of a list are only seen through the calls of that list
+    if (state.recordingList) {
+        state.listBytes += bytes;
+        state.listCost.fifoBytes += bytes;
+        AccountCost(state.listCost, kind, vertices, primitives);
+        return;
+    }
+
+    GXCommand command = { name, kind, bytes, vertices, primitives };
+    state.commands.push_back(command);
+    state.cost.fifoBytes += bytes;
+    state.bytesSinceFlush += bytes;
+    AccountCost(state.cost, kind, vertices, primitives);
+}
+
+const char* GetAttributeName(u32 attribute) {
+    switch (attribute) {
+        case GX_VA_POS:  return "position";
+        case GX_VA_NRM:  return "normal";
+        case GX_VA_CLR0: return "color";
+        case GX_VA_TEX0: return "texture coordinate";
+        default:         return "attribute";
+    }
+}
+
+const char* GetPrimitiveName(u8 primitive) {
+    switch (primitive) {
+        case GX_QUADS:         return "GX_QUADS";
+        case GX_TRIANGLES:     return "GX_TRIANGLES";
+        case GX_TRIANGLESTRIP: return "GX_TRIANGLESTRIP";
+        case GX_TRIANGLEFAN:   return "GX_TRIANGLEFAN";
+        case GX_LINES:         return "GX_LINES";
+        case GX_LINESTRIP:     return "GX_LINESTRIP";
+        case GX_POINTS:        return "GX_POINTS";
+        default:               return "GX_Begin";
+    }
+}
+
+void SendAttribute(const char* name, u32 attribute, u8 type, u32 bytes) {
+    if (!state.inPrimitive) {
+        AddError("%s outside GX_Begin/GX_End", name);
+        return;
+    }
+
+    if (state.vertexDesc[attribute] != type && !state.mismatchReported) {
+        AddError("%s sent for a %s the vertex descriptor sets to type %u", name,
+                 GetAttributeName(attribute), state.vertexDesc[attribute]);
+        state.mismatchReported = true;
+    }
+    state.attributesSent[attribute]++;
+    state.primitiveBytes += bytes;
+}
+
+// Deferred vertex descriptor (two CP registers and the XF vertex spec)
+// and attribute formats (three CP registers each)
+u32 FlushVertexFormat() {
+    u32 bytes = 0;
+    if (state.descDirty) {
+        bytes += 2 * CP_WRITE + XfWrite(1);
+        state.descDirty = false;
+    }
+    for (int i = 0; i < GX_MAXVTXFMT; i++) {
+        if (state.formatDirty[i]) {
+            bytes += 3 * CP_WRITE;
+            state.formatDirty[i] = false;
+        }
+    }
+    return bytes;
+}
+
+void SetDrawDoneToken(const char* name) {
+    Record(name, GX_COMMAND_SYNC, BP_WRITE + FLUSH_BYTES);
+    state.bytesSinceFlush = 0;
+
+    // The simulated GPU is already done
+    if (state.drawDoneCallback) {
+        state.drawDoneCallback();
+    }
+}
+
+GXFifoObj fifoObject;
+
+} // namespace
+
+// Libogc's NTSC 480i double-strike mode
+GXRModeObj TVNtsc480IntDf = {
+    0, 640, 480, 480, 40, 0, 640, 480, 1, GX_FALSE, GX_FALSE,
+    { {6, 6}, {6, 6}, {6, 6}, {6, 6}, {6, 6}, {6, 6}, {6, 6}, {6, 6}, {6, 6}, {6, 6}, {6, 6}, {6, 6} },
+    { 7, 7, 12, 12, 12, 7, 7 }
+};
+
+// Blank glyphs in place of libogc's console font; only the quads matter here
+extern "C" {
+u8 console_font_8x16[256 * 16];
+}
+
+void GXRecorder::Reset() {
+    state.commands.clear();
+    state.cost.Clear();
+    state.errors.clear();
+}
+
+const std::vector<GXCommand>& GXRecorder::GetCommands() {
+    return state.commands;
+}
+
+const GXFrameCost& GXRecorder::GetCost() {
+    return state.cost;
+}
+
+const std::vector<std::string>& GXRecorder::GetErrors() {
+    return state.errors;
+}
+
+void GXRecorder::SimulateRetrace() {
+    if (!state.retraceCallback) {
+        // Nothing would ever wake the sleeping thread
+        fprintf(stderr, "ERROR: Thread sleeps waiting for the display without a retrace callback\n");
+        abort();
+    }
+    state.retraceCallback(++state.retraceCount);
+}
+
+void GXRecorder::PrintCommands(u32 maxCommands) {
+    static const char* kindNames[] = { "state", "matrix", "primitive", "list", "copy", "sync" };
+
+    u32 count = 0;
+    for (const GXCommand& command : state.commands) {
+        if (count++ == maxCommands) {
+            printf("... %u more\n", static_cast<u32>(state.commands.size()) - maxCommands);
+            break;
+        }
+        printf("%-24s %-9s %7u bytes %7u vertices\n", command.name, kindNames[command.kind],
+               command.bytes, command.vertices);
+    }
+}
+
+// Setup
+
+GXFifoObj* GX_Init(void* base, u32 size) {
+    (void)base;
+    (void)size;
+    state.descDirty = true;
+    for (int i = 0; i < GX_MAXVTXFMT; i++) {
+        state.formatDirty[i] = true;
+    }
+    return &fifoObject;
+}
+
+void GX_GetCPUFifo(GXFifoObj* fifo) {
+    *fifo = fifoObject;
+}
+
+u32 GX_GetFifoCount(GXFifoObj* fifo) {
+    // The simulated GPU drains the FIFO whenever it is flushed
+    (void)fifo;
+    return state.bytesSinceFlush;
+}
+
+void GX_Flush(void) {
+    Record("GX_Flush", GX_COMMAND_SYNC, FLUSH_BYTES);
+    state.bytesSinceFlush = 0;
+}
+
+void GX_DrawDone(void) {
+    SetDrawDoneToken("GX_DrawDone");
+}
+
+void GX_SetDrawDone(void) {
+    SetDrawDoneToken("GX_SetDrawDone");
+}
+
+GXDrawDoneCallback GX_SetDrawDoneCallback(GXDrawDoneCallback callback) {
+    GXDrawDoneCallback previous = state.drawDoneCallback;
+    state.drawDoneCallback = callback;
+    return previous;
+}
+
+// Framebuffer and copies
+
+void GX_SetCopyClear(GXColor color, u32 z) {
+    (void)color;
+    (void)z;
+    Record("GX_SetCopyClear", GX_COMMAND_STATE, 3 * BP_WRITE);
+}
+
+void GX_SetViewport(f32 x, f32 y, f32 width, f32 height, f32 nearZ, f32 farZ) {
+    (void)x; (void)y; (void)width; (void)height; (void)nearZ; (void)farZ;
+    Record("GX_SetViewport", GX_COMMAND_STATE, XfWrite(6));
+}
+
+void GX_SetScissor(u32 x, u32 y, u32 width, u32 height) {
+    (void)x; (void)y; (void)width; (void)height;
+    Record("GX_SetScissor", GX_COMMAND_STATE, 2 * BP_WRITE);
+}
+
+void GX_SetDispCopyYScale(f32 scale) {
+    (void)scale;
+    Record("GX_SetDispCopyYScale", GX_COMMAND_STATE, BP_WRITE);
+}
+
+void GX_SetDispCopySrc(u16 left, u16 top, u16 width, u16 height) {
+    (void)left; (void)top; (void)width; (void)height;
+    Record("GX_SetDispCopySrc", GX_COMMAND_STATE, 2 * BP_WRITE);
+}
+
+void GX_SetDispCopyDst(u16 width, u16 height) {
+    (void)width; (void)height;
+    Record("GX_SetDispCopyDst", GX_COMMAND_STATE, BP_WRITE);
+}
+
+void GX_SetDispCopyGamma(u8 gamma) {
+    // Kept with the copy settings and sent by GX_CopyDisp
+    (void)gamma;
+    Record("GX_SetDispCopyGamma", GX_COMMAND_STATE, 0);
+}
+
+void GX_SetCopyFilter(u8 aa, u8 samplePattern[12][2], u8 verticalFilter, u8 filter[7]) {
+    (void)aa; (void)samplePattern; (void)verticalFilter; (void)filter;
+    Record("GX_SetCopyFilter", GX_COMMAND_STATE, 6 * BP_WRITE);
+}
+
+void GX_SetFieldMode(u8 fieldMode, u8 halfAspectRatio) {
+    (void)fieldMode; (void)halfAspectRatio;
+    Record("GX_SetFieldMode", GX_COMMAND_STATE, 2 * BP_WRITE);
+}
+
+void GX_CopyDisp(void* destination, u8 clear) {
+    (void)destination;
+    Record("GX_CopyDisp", GX_COMMAND_COPY, (clear ? 4 : 2) * BP_WRITE);
+}
+
+// Pixel state
+
+void GX_SetZMode(u8 enable, u8 function, u8 updateEnable) {
+    (void)enable; (void)function; (void)updateEnable;
+    Record("GX_SetZMode", GX_COMMAND_STATE, BP_WRITE);
+}
+
+void GX_SetColorUpdate(u8 enable) {
+    (void)enable;
+    Record("GX_SetColorUpdate", GX_COMMAND_STATE, BP_WRITE);
+}
+
+void GX_SetAlphaUpdate(u8 enable) {
+    (void)enable;
+    Record("GX_SetAlphaUpdate", GX_COMMAND_STATE, BP_WRITE);
+}
+
+void GX_SetCullMode(u8 mode) {
+    (void)mode;
+    Record("GX_SetCullMode", GX_COMMAND_STATE, BP_WRITE);
+}
+
+void GX_SetBlendMode(u8 type, u8 sourceFactor, u8 destinationFactor, u8 operation) {
+    (void)type; (void)sourceFactor; (void)destinationFactor; (void)operation;
+    Record("GX_SetBlendMode", GX_COMMAND_STATE, BP_WRITE);
+}
+
+// Transform and lighting
+
+void GX_LoadProjectionMtx(Mtx44 matrix, u8 type) {
+    (void)matrix; (void)type;
+    Record("GX_LoadProjectionMtx", GX_COMMAND_MATRIX, XfWrite(7));
+}
+
+void GX_LoadPosMtxImm(Mtx matrix, u32 index) {
+    (void)matrix; (void)index;
+    Record("GX_LoadPosMtxImm", GX_COMMAND_MATRIX, XfWrite(12));
+}
+
+void GX_SetCurrentMtx(u32 index) {
+    (void)index;
+    Record("GX_SetCurrentMtx", GX_COMMAND_STATE, CP_WRITE + XfWrite(1));
+}
+
+void GX_SetNumChans(u8 count) {
+    (void)count;
+    Record("GX_SetNumChans", GX_COMMAND_STATE, XfWrite(1));
+}
+
+void GX_SetChanCtrl(s32 channel, u8 enable, u8 ambientSource, u8 materialSource, u8 lightMask,
+                    u8 diffuseFunction, u8 attenuationFunction) {
+    (void)enable; (void)ambientSource; (void)materialSource; (void)lightMask;
+    (void)diffuseFunction; (void)attenuationFunction;
+
+    // GX_COLOR0A0 sets the color and alpha channels separately
+    Record("GX_SetChanCtrl", GX_COMMAND_STATE, (channel == GX_COLOR0A0 ? 2 : 1) * XfWrite(1));
+}
+
+void GX_SetChanAmbColor(s32 channel, GXColor color) {
+    (void)channel; (void)color;
+    Record("GX_SetChanAmbColor", GX_COMMAND_STATE, XfWrite(1));
+}
+
+// Light objects are built in main memory; only the load reaches the FIFO
+void GX_InitLightPos(GXLightObj* light, f32 x, f32 y, f32 z) {
+    (void)light; (void)x; (void)y; (void)z;
+}
+
+void GX_InitLightDir(GXLightObj* light, f32 x, f32 y, f32 z) {
+    (void)light; (void)x; (void)y; (void)z;
+}
+
+void GX_InitLightColor(GXLightObj* light, GXColor color) {
+    (void)light; (void)color;
+}
+
+void GX_LoadLightObj(GXLightObj* light, u8 id) {
+    (void)light; (void)id;
+    Record("GX_LoadLightObj", GX_COMMAND_MATRIX, XfWrite(16));
+}
+
+// Texturing and TEV
+
+void GX_SetNumTexGens(u32 count) {
+    (void)count;
+    Record("GX_SetNumTexGens", GX_COMMAND_STATE, XfWrite(1));
+}
+
+void GX_SetTexCoordGen(u16 texCoord, u32 type, u32 source, u32 matrix) {
+    (void)texCoord; (void)type; (void)source; (void)matrix;
+    Record("GX_SetTexCoordGen", GX_COMMAND_STATE, 2 * XfWrite(1));
+}
+
+void GX_InitTexObj(GXTexObj* texture, void* data, u16 width, u16 height, u8 format, u8 wrapS, u8 wrapT,
+                   u8 mipmap) {
+    (void)texture; (void)data; (void)width; (void)height; (void)format; (void)wrapS; (void)wrapT; (void)mipmap;
+}
+
+void GX_InitTexObjLOD(GXTexObj* texture, u8 minFilter, u8 magFilter, f32 minLod, f32 maxLod, f32 lodBias,
+                      u8 biasClamp, u8 edgeLod, u8 maxAniso) {
+    (void)texture; (void)minFilter; (void)magFilter; (void)minLod; (void)maxLod; (void)lodBias;
+    (void)biasClamp; (void)edgeLod; (void)maxAniso;
+}
+
+void GX_LoadTexObj(GXTexObj* texture, u8 map) {
+    (void)texture; (void)map;
+    Record("GX_LoadTexObj", GX_COMMAND_STATE, 4 * BP_WRITE);
+}
+
+void GX_InvalidateTexAll(void) {
+    Record("GX_InvalidateTexAll", GX_COMMAND_SYNC, 2 * BP_WRITE);
+}
+
+void GX_SetTevOrder(u8 stage, u8 texCoord, u32 texMap, u8 color) {
+    (void)stage; (void)texCoord; (void)texMap; (void)color;
+    Record("GX_SetTevOrder", GX_COMMAND_STATE, BP_WRITE);
+}
+
+void GX_SetTevOp(u8 stage, u8 mode) {
+    // Color and alpha combiners
+    (void)stage; (void)mode;
+    Record("GX_SetTevOp", GX_COMMAND_STATE, 2 * BP_WRITE);
+}
+
+// Vertex format and arrays
+
+void GX_ClearVtxDesc(void) {
+    memset(state.vertexDesc, GX_NONE, sizeof(state.vertexDesc));
+    state.descDirty = true;
+    Record("GX_ClearVtxDesc", GX_COMMAND_STATE, 0);
+}
+
+void GX_SetVtxDesc(u8 attribute, u8 type) {
+    if (attribute >= GX_VA_MAX) {
+        AddError("GX_SetVtxDesc of unknown attribute %u", attribute);
+        return;
+    }
+    state.vertexDesc[attribute] = type;
+    state.descDirty = true;
+    Record("GX_SetVtxDesc", GX_COMMAND_STATE, 0);
+}
+
+void GX_SetVtxAttrFmt(u8 format, u32 attribute, u32 componentCount, u32 componentType, u32 fracBits) {
+    (void)attribute; (void)componentCount; (void)componentType; (void)fracBits;
+    if (format >= GX_MAXVTXFMT) {
+        AddError("GX_SetVtxAttrFmt of unknown format %u", format);
+        return;
+    }
+    state.formatDirty[format] = true;
+    Record("GX_SetVtxAttrFmt", GX_COMMAND_STATE, 0);
+}
+
+void GX_SetArray(u32 attribute, void* base, u8 stride) {
+    (void)attribute; (void)base; (void)stride;
+    Record("GX_SetArray", GX_COMMAND_STATE, 2 * CP_WRITE);
+}
+
+void GX_InvVtxCache(void) {
+    Record("GX_InvVtxCache", GX_COMMAND_SYNC, 1);
+}
+
+// Primitives and vertex data
+
+void GX_Begin(u8 primitive, u8 format, u16 vertexCount) {
+    if (state.inPrimitive) {
+        AddError("GX_Begin inside GX_Begin/GX_End");
+    }
+    if (format >= GX_MAXVTXFMT) {
+        AddError("GX_Begin with unknown format %u", format);
+    }
+
+    u32 flushBytes = FlushVertexFormat();
+
+    state.inPrimitive = true;
+    state.primitiveName = GetPrimitiveName(primitive);
+    state.declaredVertices = vertexCount;
+    state.primitiveBytes = PRIMITIVE_HEADER + flushBytes;
+    state.mismatchReported = false;
+    memset(state.attributesSent, 0, sizeof(state.attributesSent));
+}
+
+void GX_End(void) {
+    if (!state.inPrimitive) {
+        AddError("GX_End without GX_Begin");
+        return;
+    }
+
+    // Every attribute in the descriptor, once per declared vertex
+    static const u32 attributes[] = { GX_VA_POS, GX_VA_NRM, GX_VA_CLR0, GX_VA_TEX0 };
+    for (u32 attribute : attributes) {
+        u32 expected = (state.vertexDesc[attribute] != GX_NONE) ? state.declaredVertices : 0;
+        if (state.attributesSent[attribute] != expected) {
+            AddError("%s of %u vertices sent %u %s values, expected %u", state.primitiveName,
+                     state.declaredVertices, state.attributesSent[attribute],
+                     GetAttributeName(attribute), expected);
+        }
+    }
+
+    state.inPrimitive = false;
+    Record(state.primitiveName, GX_COMMAND_PRIMITIVE, state.primitiveBytes, state.declaredVertices, 1);
+}
+
+void GX_Position3f32(f32 x, f32 y, f32 z) {
+    (void)x; (void)y; (void)z;
+    SendAttribute("GX_Position3f32", GX_VA_POS, GX_DIRECT, 3 * sizeof(f32));
+}
+
+void GX_Position3s16(s16 x, s16 y, s16 z) {
+    (void)x; (void)y; (void)z;
+    SendAttribute("GX_Position3s16", GX_VA_POS, GX_DIRECT, 3 * sizeof(s16));
+}
+
+void GX_Position2s16(s16 x, s16 y) {
+    (void)x; (void)y;
+    SendAttribute("GX_Position2s16", GX_VA_POS, GX_DIRECT, 2 * sizeof(s16));
+}
+
+void GX_Position1x16(u16 index) {
+    (void)index;
+    SendAttribute("GX_Position1x16", GX_VA_POS, GX_INDEX16, sizeof(u16));
+}
+
+void GX_Position1x8(u8 index) {
+    (void)index;
+    SendAttribute("GX_Position1x8", GX_VA_POS, GX_INDEX8, sizeof(u8));
+}
+
+void GX_Normal3f32(f32 x, f32 y, f32 z) {
+    (void)x; (void)y; (void)z;
+    SendAttribute("GX_Normal3f32", GX_VA_NRM, GX_DIRECT, 3 * sizeof(f32));
+}
+
+void GX_Normal3s8(s8 x, s8 y, s8 z) {
+    (void)x; (void)y; (void)z;
+    SendAttribute("GX_Normal3s8", GX_VA_NRM, GX_DIRECT, 3 * sizeof(s8));
+}
+
+void GX_Normal1x16(u16 index) {
+    (void)index;
+    SendAttribute("GX_Normal1x16", GX_VA_NRM, GX_INDEX16, sizeof(u16));
+}
+
+void GX_Normal1x8(u8 index) {
+    (void)index;
+    SendAttribute("GX_Normal1x8", GX_VA_NRM, GX_INDEX8, sizeof(u8));
+}
+
+void GX_Color1u32(u32 color) {
+    (void)color;
+    SendAttribute("GX_Color1u32", GX_VA_CLR0, GX_DIRECT, sizeof(u32));
+}
+
+void GX_Color1x16(u16 index) {
+    (void)index;
+    SendAttribute("GX_Color1x16", GX_VA_CLR0, GX_INDEX16, sizeof(u16));
+}
+
+void GX_Color1x8(u8 index) {
+    (void)index;
+    SendAttribute("GX_Color1x8", GX_VA_CLR0, GX_INDEX8, sizeof(u8));
+}
+
+void GX_TexCoord2f32(f32 s, f32 t) {
+    (void)s; (void)t;
+    SendAttribute("GX_TexCoord2f32", GX_VA_TEX0, GX_DIRECT, 2 * sizeof(f32));
+}
+
+// Display lists
+
+void GX_BeginDispList(void* list, u32 size) {
+    if (state.recordingList) {
+        AddError("GX_BeginDispList while a list is being recorded");
+    }
+
+    // Pending state goes to the FIFO first, as libogc does, so the list
+    // does not depend on it
+    u32 flushBytes = FlushVertexFormat();
+    if (flushBytes > 0) {
+        Record("GX_BeginDispList", GX_COMMAND_SYNC, flushBytes);
+    }
+
+    state.recordingList = true;
+    state.listBase = list;
+    state.listCapacity = size;
+    state.listBytes = 0;
+    state.listCost.Clear();
+}
+
+u32 GX_EndDispList(void) {
+    if (!state.recordingList) {
+        AddError("GX_EndDispList without GX_BeginDispList");
+        return 0;
+    }
+    state.recordingList = false;
+
+    // Padded with NOPs to 32 bytes; 0 if the buffer overflowed
+    u32 size = (state.listBytes + 31) & ~31u;
+    if (size > state.listCapacity) {
+        state.lists.erase(state.listBase);
+        return 0;
+    }
+
+    DisplayListRecord& record = state.lists[state.listBase];
+    record.size = size;
+    record.cost = state.listCost;
+    return size;
+}
+
+void GX_CallDispList(void* list, u32 size) {
+    if (state.recordingList) {
+        AddError("GX_CallDispList inside a display list");
+        return;
+    }
+
+    std::map<const void*, DisplayListRecord>::const_iterator found = state.lists.find(list);
+    if (found == state.lists.end()) {
+        AddError("GX_CallDispList of a list that was never recorded");
+        return;
+    }
+    const DisplayListRecord& record = found->second;
+    if (size != record.size) {
+        AddError("GX_CallDispList of %u bytes for a list of %u", size, record.size);
+    }
+
+    Record("GX_CallDispList", GX_COMMAND_CALL_LIST, LIST_CALL_BYTES, record.cost.vertices,
+           record.cost.primitives);
+    state.cost.displayListBytes += record.size;
+    state.cost.stateChanges += record.cost.stateChanges;
+    state.cost.listCalls++;
+}
+
+// Performance counters: selecting them costs register writes, reading
+// them returns nothing since no work is measured
+
+void GX_SetGPMetric(u32 perf0, u32 perf1) {
+    (void)perf0; (void)perf1;
+    Record("GX_SetGPMetric", GX_COMMAND_STATE, BP_WRITE + CP_WRITE);
+}
+
+void GX_ReadGPMetric(u32* perf0, u32* perf1) {
+    *perf0 = 0;
+    *perf1 = 0;
+}
+
+void GX_InitXfRasMetric(void) {
+    Record("GX_InitXfRasMetric", GX_COMMAND_STATE, BP_WRITE + XfWrite(1));
+}
+
+void GX_ReadXfRasMetric(u32* xfWaitIn, u32* xfWaitOut, u32* rasterBusy, u32* clocks) {
+    *xfWaitIn = 0;
+    *xfWaitOut = 0;
+    *rasterBusy = 0;
+    *clocks = 0;
+}
+
+void GX_SetVCacheMetric(u32 attribute) {
+    (void)attribute;
+    Record("GX_SetVCacheMetric", GX_COMMAND_STATE, 2 * CP_WRITE);
+}
+
+void GX_ReadVCacheMetric(u32* checks, u32* misses, u32* stalls) {
+    *checks = 0;
+    *misses = 0;
+    *stalls = 0;
+}
+
+// Matrix math, as libogc's C versions
+
+void guMtxIdentity(Mtx matrix) {
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 4; column++) {
+            matrix[row][column] = (row == column) ? 1.0f : 0.0f;
+        }
+    }
+}
+
+void guMtxCopy(Mtx source, Mtx destination) {
+    if (source != destination) {
+        memcpy(destination, source, sizeof(Mtx));
+    }
+}
+
+void guMtxConcat(Mtx a, Mtx b, Mtx ab) {
+    Mtx result;
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 4; column++) {
+            result[row][column] = a[row][0] * b[0][column] + a[row][1] * b[1][column] +
+                                  a[row][2] * b[2][column] + (column == 3 ? a[row][3] : 0.0f);
+        }
+    }
+    memcpy(ab, result, sizeof(Mtx));
+}
+
+void guMtxScaleApply(Mtx source, Mtx destination, f32 x, f32 y, f32 z) {
+    const f32 scale[3] = { x, y, z };
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 4; column++) {
+            destination[row][column] = source[row][column] * scale[row];
+        }
+    }
+}
+
+void guMtxTransApply(Mtx source, Mtx destination, f32 x, f32 y, f32 z) {
+    guMtxCopy(source, destination);
+    destination[0][3] += x;
+    destination[1][3] += y;
+    destination[2][3] += z;
+}
+
+void guLookAt(Mtx matrix, guVector* position, guVector* up, guVector* target) {
+    f32 look[3] = { position->x - target->x, position->y - target->y, position->z - target->z };
+    f32 length = sqrtf(look[0] * look[0] + look[1] * look[1] + look[2] * look[2]);
+    for (int i = 0; i < 3; i++) look[i] /= length;
+
+    f32 right[3] = { up->y * look[2] - up->z * look[1], up->z * look[0] - up->x * look[2],
+                     up->x * look[1] - up->y * look[0] };
+    length = sqrtf(right[0] * right[0] + right[1] * right[1] + right[2] * right[2]);
+    for (int i = 0; i < 3; i++) right[i] /= length;
+
+    f32 cameraUp[3] = { look[1] * right[2] - look[2] * right[1], look[2] * right[0] - look[0] * right[2],
+                        look[0] * right[1] - look[1] * right[0] };
+
+    const f32* axes[3] = { right, cameraUp, look };
+    for (int row = 0; row < 3; row++) {
+        matrix[row][0] = axes[row][0];
+        matrix[row][1] = axes[row][1];
+        matrix[row][2] = axes[row][2];
+        matrix[row][3] = -(position->x * axes[row][0] + position->y * axes[row][1] + position->z * axes[row][2]);
+    }
+}
+
+void guPerspective(Mtx44 matrix, f32 fovY, f32 aspect, f32 nearZ, f32 farZ) {
+    f32 cotangent = 1.0f / tanf(fovY * 0.5f * static_cast<f32>(M_PI) / 180.0f);
+    f32 inverseDepth = 1.0f / (farZ - nearZ);
+    memset(matrix, 0, sizeof(Mtx44));
+    matrix[0][0] = cotangent / aspect;
+    matrix[1][1] = cotangent;
+    matrix[2][2] = -nearZ * inverseDepth;
+    matrix[2][3] = -(farZ * nearZ) * inverseDepth;
+    matrix[3][2] = -1.0f;
+}
+
+void guOrtho(Mtx44 matrix, f32 top, f32 bottom, f32 left, f32 right, f32 nearZ, f32 farZ) {
+    memset(matrix, 0, sizeof(Mtx44));
+    matrix[0][0] = 2.0f / (right - left);
+    matrix[0][3] = -(right + left) / (right - left);
+    matrix[1][1] = 2.0f / (top - bottom);
+    matrix[1][3] = -(top + bottom) / (top - bottom);
+    matrix[2][2] = -1.0f / (farZ - nearZ);
+    matrix[2][3] = -farZ / (farZ - nearZ);
+    matrix[3][3] = 1.0f;
+}
+
+// Video, threads, interrupts and caches
+
+void* SYS_AllocateFramebuffer(GXRModeObj* mode) {
+    // Owned by the system for the life of the program, as on the console
+    return aligned_alloc(32, VIDEO_GetFrameBufferSize(mode));
+}
+
+u32 VIDEO_GetFrameBufferSize(GXRModeObj* mode) {
+    // Two bytes per pixel, rounded up to whole 32-byte lines
+    return (static_cast<u32>(mode->fbWidth) * mode->xfbHeight * 2 + 31) & ~31u;
+}
+
+void VIDEO_SetNextFramebuffer(void* frameBuffer) {
+    (void)frameBuffer;
+}
+
+void VIDEO_SetBlack(int black) {
+    (void)black;
+}
+
+void VIDEO_Flush(void) {
+}
+
+VIRetraceCallback VIDEO_SetPreRetraceCallback(VIRetraceCallback callback) {
+    VIRetraceCallback previous = state.retraceCallback;
+    state.retraceCallback = callback;
+    return previous;
+}
+
+s32 LWP_InitQueue(lwpq_t* queue) {
+    *queue = 1;
+    return 0;
+}
+
+void LWP_CloseQueue(lwpq_t queue) {
+    (void)queue;
+}
+
+s32 LWP_ThreadSleep(lwpq_t queue) {
+    // The GPU is never behind, so only the display can keep a thread waiting
+    (void)queue;
+    GXRecorder::SimulateRetrace();
+    return 0;
+}
+
+void LWP_ThreadBroadcast(lwpq_t queue) {
+    (void)queue;
+}
+
+u32 IRQ_Disable(void) {
+    return 0;
+}
+
+void IRQ_Restore(u32 level) {
+    (void)level;
+}
+
+void DCFlushRange(void* start, u32 size) {
+    (void)start; (void)size;
+}
+
+void DCInvalidateRange(void* start, u32 size) {
+    (void)start; (void)size;
+}
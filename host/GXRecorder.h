@@ -0,0 +1,89 @@
+#ifndef GX_RECORDER_H
+#define GX_RECORDER_H
+
+#include <string>
+#include <vector>
+#include "Platform.h"
+
+/**
+ * What a recorded command does to the GPU
+ */
+enum GXCommandKind {
+    GX_COMMAND_STATE = 0,   // BP, CP or XF register writes
+    GX_COMMAND_MATRIX,      // Matrix and light loads into XF memory
+    GX_COMMAND_PRIMITIVE,   // GX_Begin to GX_End, with its vertex data
+    GX_COMMAND_CALL_LIST,   // GX_CallDispList
+    GX_COMMAND_COPY,        // EFB to XFB copy
+    GX_COMMAND_SYNC         // Draw done tokens, cache invalidation and FIFO flushes
+};
+
+/**
+ * One entry of the command log. bytes is what the call writes into the
+ * FIFO, following libogc's register writes; vertex format state libogc
+ * defers to the next GX_Begin is charged to that primitive. For a list
+ * call, vertices and primitives are those of the list.
+ */
+struct GXCommand {
+    const char* name;
+    GXCommandKind kind;
+    u32 bytes;
+    u32 vertices;
+    u32 primitives;
+};
+
+/**
+ * Totals over the commands recorded since the last Reset
+ */
+struct GXFrameCost {
+    u32 fifoBytes;          // Written by the CPU
+    u32 displayListBytes;   // Fetched by the GPU from called lists
+    u32 vertices;           // Including those of called lists
+    u32 primitives;         // GX_Begin batches, including those of called lists
+    u32 stateChanges;       // State and matrix commands, including those of called lists
+    u32 listCalls;
+    u32 copies;
+
+    GXFrameCost() { Clear(); }
+
+    void Clear() {
+        fifoBytes = 0;
+        displayListBytes = 0;
+        vertices = 0;
+        primitives = 0;
+        stateChanges = 0;
+        listCalls = 0;
+        copies = 0;
+    }
+};
+
+/**
+ * Host backend of the GX functions declared by host/gx/gccore.h. Instead
+ * of drawing, every call is appended to an in-memory command log, and
+ * display lists are recorded as logs of their own that list calls refer
+ * to. Sequences the hardware would reject (vertex data outside
+ * GX_Begin/GX_End, a vertex count that does not match GX_Begin, an
+ * attribute sent in a different form than the vertex descriptor says,
+ * calling a list that was never recorded) are logged as errors.
+ *
+ * The simulated GPU finishes each command as soon as it is written, so a
+ * draw done callback runs from GX_SetDrawDone, and a thread that sleeps
+ * waiting for the display sleeps until the next retrace, which runs the
+ * pre-retrace callback.
+ */
+class GXRecorder {
+public:
+    // Drop the command log, cost and errors; display lists stay recorded
+    static void Reset();
+
+    static const std::vector<GXCommand>& GetCommands();
+    static const GXFrameCost& GetCost();
+    static const std::vector<std::string>& GetErrors();
+
+    // Run the pre-retrace callback as the next vertical retrace would
+    static void SimulateRetrace();
+
+    // One line per command of the log, up to maxCommands
+    static void PrintCommands(u32 maxCommands);
+};
+
+#endif // GX_RECORDER_H
@@ -0,0 +1,330 @@
+#include "LoadBenchmark.h"
+#include "Mesh.h"
+#include "MemorySystem.h"
+#include "VertexCacheOptimizer.h"
+#include "FileManager.h"
+#include "GXRecorder.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// Same parameters as MeshLoadJob
+static const f32 WELD_TOLERANCE = 1e-5f;
+static const f32 CREASE_ANGLE = 30.0f;
+
+static const char* STAGE_NAMES[STAGE_COUNT] = { "load", "bounds", "weld", "process", "frame" };
+
+u32 LoadBenchmarkResult::GetMeshPeakBytes() const {
+    u32 peak = 0;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        if (stages[i].meshPeakBytes > peak) peak = stages[i].meshPeakBytes;
+    }
+    return peak;
+}
+
+u32 LoadBenchmarkResult::GetScratchPeakBytes() const {
+    u32 peak = 0;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        if (stages[i].scratchPeakBytes > peak) peak = stages[i].scratchPeakBytes;
+    }
+    return peak;
+}
+
+f32 LoadBenchmarkResult::GetMegabytesPerSecond() const {
+    u32 micros = stages[STAGE_LOAD].micros;
+    return micros > 0 ? (fileBytes / (1024.0f * 1024.0f)) / (micros / 1000000.0f) : 0.0f;
+}
+
+f32 LoadBenchmarkResult::GetTrianglesPerSecond() const {
+    u32 micros = stages[STAGE_LOAD].micros;
+    return micros > 0 ? triangleCount / (micros / 1000000.0f) : 0.0f;
+}
+
+/**
+ * Times one stage and takes the arenas' high-water marks over it
+ */
+class StageTimer {
+public:
+    explicit StageTimer(StageResult& stage) : stage(stage),
+        meshArena(MemorySystem::GetMeshArena()), scratchArena(MemorySystem::GetScratchArena()) {
+        meshArena.ResetHighWaterMark();
+        scratchArena.ResetHighWaterMark();
+        startTime = gettime();
+    }
+
+    void Finish(bool completed) {
+        stage.micros = diff_usec(startTime, gettime());
+        stage.completed = completed;
+        stage.meshPeakBytes = meshArena.GetHighWaterMark();
+        stage.scratchPeakBytes = scratchArena.GetHighWaterMark();
+    }
+
+private:
+    StageResult& stage;
+    Arena& meshArena;
+    Arena& scratchArena;
+    u64 startTime;
+};
+
+/**
+ * Sends stdout to /dev/null for its lifetime
+ */
+class QuietOutput {
+public:
+    explicit QuietOutput(bool enable) : savedDescriptor(-1) {
+        if (!enable) {
+            return;
+        }
+        fflush(stdout);
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) {
+            savedDescriptor = dup(STDOUT_FILENO);
+            dup2(null, STDOUT_FILENO);
+            close(null);
+        }
+    }
+
+    ~QuietOutput() {
+        if (savedDescriptor >= 0) {
+            fflush(stdout);
+            dup2(savedDescriptor, STDOUT_FILENO);
+            close(savedDescriptor);
+        }
+    }
+
+private:
+    int savedDescriptor;
+};
+
+static u32 TimeBoundsSweep(const Mesh& mesh) {
+    u64 startTime = gettime();
+    const Triangle* triangles = mesh.GetTriangles();
+    Vector3 minBounds(1e9f, 1e9f, 1e9f);
+    Vector3 maxBounds(-1e9f, -1e9f, -1e9f);
+    for (int i = 0; i < mesh.GetTriangleCount(); i++) {
+        for (int j = 0; j < 3; j++) {
+            const Vector3& v = triangles[i].vertices[j];
+            if (v.x < minBounds.x) minBounds.x = v.x;
+            if (v.x > maxBounds.x) maxBounds.x = v.x;
+            if (v.y < minBounds.y) minBounds.y = v.y;
+            if (v.y > maxBounds.y) maxBounds.y = v.y;
+            if (v.z < minBounds.z) minBounds.z = v.z;
+            if (v.z > maxBounds.z) maxBounds.z = v.z;
+        }
+    }
+    u32 micros = diff_usec(startTime, gettime());
+
+    // Also keeps the sweep from being optimized away
+    Vector3 fusedMin = mesh.GetMinBounds();
+    Vector3 fusedMax = mesh.GetMaxBounds();
+    if (minBounds.x != fusedMin.x || minBounds.y != fusedMin.y || minBounds.z != fusedMin.z ||
+        maxBounds.x != fusedMax.x || maxBounds.y != fusedMax.y || maxBounds.z != fusedMax.z) {
+        fprintf(stderr, "ERROR: Bounds sweep disagrees with the bounds computed during decoding\n");
+    }
+    return micros;
+}
+
+LoadBenchmark::LoadBenchmark() : repeatCount(3), verbose(false), rendererReady(false) {
+}
+
+LoadBenchmark::~LoadBenchmark() {
+    renderer.Shutdown();
+}
+
+const char* LoadBenchmark::GetStageName(BenchmarkStage stage) {
+    return STAGE_NAMES[stage];
+}
+
+bool LoadBenchmark::Run(const std::string& path, const std::string& group) {
+    FileManager files;
+    LoadBenchmarkResult best;
+    size_t slash = path.find_last_of('/');
+    best.name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    best.group = group;
+    best.fileBytes = files.GetFileSize(path);
+
+    // A file the viewer would not load is still a result: where the size
+    // limits cut in is what a sweep is after
+    bool ok = files.IsValidSTLFile(path);
+    if (!ok) {
+        fprintf(stderr, "ERROR: Not a loadable STL file: %s\n", path.c_str());
+    }
+
+    for (int run = 0; ok && run < repeatCount; run++) {
+        LoadBenchmarkResult result;
+        if (!RunOnce(path, result)) {
+            fprintf(stderr, "ERROR: Failed to load %s\n", path.c_str());
+            ok = false;
+            break;
+        }
+
+        if (run == 0) {
+            memcpy(best.stages, result.stages, sizeof(best.stages));
+            best.triangleCount = result.triangleCount;
+            best.vertexCount = result.vertexCount;
+            best.binary = result.binary;
+            best.frameBytes = result.frameBytes;
+            continue;
+        }
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            if (result.stages[i].micros < best.stages[i].micros) {
+                best.stages[i].micros = result.stages[i].micros;
+            }
+        }
+    }
+
+    if (!ok) {
+        memset(best.stages, 0, sizeof(best.stages));
+        best.triangleCount = 0;
+        best.vertexCount = 0;
+        best.binary = false;
+        best.frameBytes = 0;
+    }
+    results.push_back(best);
+    return ok;
+}
+
+bool LoadBenchmark::RunOnce(const std::string& path, LoadBenchmarkResult& result) {
+    QuietOutput quiet(!verbose);
+
+    memset(result.stages, 0, sizeof(result.stages));
+    result.frameBytes = 0;
+
+    Mesh mesh(&MemorySystem::GetMeshArena());
+    StageTimer load(result.stages[STAGE_LOAD]);
+    bool loaded = mesh.LoadFromSTL(path.c_str());
+    load.Finish(loaded);
+    if (!loaded) {
+        return false;
+    }
+    result.triangleCount = mesh.GetTriangleCount();
+    result.binary = mesh.GetLoadStats().binary;
+    // The decoder's own time, without the file open around it
+    result.stages[STAGE_LOAD].micros = mesh.GetLoadStats().loadMicros;
+
+    StageTimer bounds(result.stages[STAGE_BOUNDS]);
+    u32 boundsMicros = TimeBoundsSweep(mesh);
+    bounds.Finish(true);
+    result.stages[STAGE_BOUNDS].micros = boundsMicros;
+
+    StageTimer weld(result.stages[STAGE_WELD]);
+    mesh.Weld(mesh.GetMaxSize() * WELD_TOLERANCE);
+    weld.Finish(mesh.IsIndexed());
+    result.vertexCount = mesh.GetVertexCount();
+
+    StageTimer process(result.stages[STAGE_PROCESS]);
+    bool processed = false;
+    if (mesh.IsIndexed() && mesh.BuildRenderGeometry(CREASE_ANGLE)) {
+        mesh.OptimizeVertexCache(VertexCacheOptimizer::DEFAULT_CACHE_SIZE);
+        mesh.BuildClusters();
+        processed = mesh.BuildStrips();
+        mesh.BuildLods();
+        mesh.Quantize();
+    }
+    process.Finish(processed);
+
+    // Drawn whatever state the mesh was left in, as the viewer would
+    return RenderFrame(mesh, result);
+}
+
+bool LoadBenchmark::RenderFrame(const Mesh& mesh, LoadBenchmarkResult& result) {
+    if (!rendererReady) {
+        if (!renderer.Initialize(&TVNtsc480IntDf)) {
+            return false;
+        }
+        // Display lists would hide the submission cost this stage is after
+        renderer.SetDisplayListsEnabled(false);
+        renderer.AcquireDisplay();
+        rendererReady = true;
+    }
+
+    Camera camera;
+    GXRecorder::Reset();
+    StageTimer frame(result.stages[STAGE_FRAME]);
+    renderer.BeginFrame();
+    renderer.RenderMesh(&mesh, camera);
+    renderer.EndFrame();
+    frame.Finish(GXRecorder::GetErrors().empty());
+
+    const GXFrameCost& cost = GXRecorder::GetCost();
+    result.frameBytes = cost.fifoBytes;
+
+    renderer.WaitForIdle();
+    GXRecorder::Reset();
+    return true;
+}
+
+void LoadBenchmark::PrintReport() const {
+    printf("%-26s %6s %9s %9s %9s %8s %8s %9s %9s %9s %9s %9s %9s %9s\n",
+           "file", "format", "MB", "triangles", "load ms", "MB/s", "Mtri/s",
+           "bounds ms", "weld ms", "proc ms", "frame ms", "frame KB", "mesh KB", "scratch KB");
+    bool anyFailed = false;
+    for (const LoadBenchmarkResult& result : results) {
+        char times[STAGE_COUNT][16];
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            const StageResult& stage = result.stages[i];
+            if (stage.completed) {
+                snprintf(times[i], sizeof(times[i]), "%.2f", stage.micros / 1000.0f);
+            } else {
+                snprintf(times[i], sizeof(times[i]), "-");
+                anyFailed = true;
+            }
+        }
+
+        bool loaded = result.stages[STAGE_LOAD].completed;
+        printf("%-26s %6s %9.2f %9d %9s %8.1f %8.2f %9s %9s %9s %9s %9u %9u %9u\n",
+               result.name.c_str(), loaded ? (result.binary ? "binary" : "ASCII") : "-",
+               result.fileBytes / (1024.0f * 1024.0f), result.triangleCount,
+               times[STAGE_LOAD], result.GetMegabytesPerSecond(),
+               result.GetTrianglesPerSecond() / 1000000.0f, times[STAGE_BOUNDS],
+               times[STAGE_WELD], times[STAGE_PROCESS], times[STAGE_FRAME], result.frameBytes / 1024,
+               result.GetMeshPeakBytes() / 1024, result.GetScratchPeakBytes() / 1024);
+    }
+    if (anyFailed) {
+        printf("- : pass failed within the console's file size or arena limits (run with -v for the reason)\n");
+    }
+    printf("Frames are drawn in immediate mode with GX recorded: frame ms is CPU submission time on this host\n");
+
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        printf("Peak resident size: %ld KB (arenas are reserved up front; see the high-water marks above)\n",
+               usage.ru_maxrss);
+    }
+}
+
+bool LoadBenchmark::WriteCsv(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        printf("ERROR: Cannot write %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "file,group,format,file_bytes,triangles,vertices");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const char* stage = STAGE_NAMES[i];
+        fprintf(file, ",%s_ok,%s_us,%s_mesh_bytes,%s_scratch_bytes", stage, stage, stage, stage);
+    }
+    fprintf(file, ",frame_gpu_bytes\n");
+
+    for (const LoadBenchmarkResult& result : results) {
+        const char* format = result.stages[STAGE_LOAD].completed ? (result.binary ? "binary" : "ascii") : "";
+        fprintf(file, "%s,%s,%s,%ld,%d,%d", result.name.c_str(), result.group.c_str(), format, result.fileBytes, result.triangleCount, result.vertexCount);
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            const StageResult& stage = result.stages[i];
+            fprintf(file, ",%d,%u,%u,%u", stage.completed ? 1 : 0, stage.micros,
+                    stage.meshPeakBytes, stage.scratchPeakBytes);
+        }
+        fprintf(file, ",%u\n", result.frameBytes);
+    }
+
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        printf("ERROR: Failed to write %s\n", path);
+    }
+    return ok;
+}
@@ -0,0 +1,89 @@
+#ifndef LOAD_BENCHMARK_H
+#define LOAD_BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include "Platform.h"
+#include "Renderer.h"
+
+/**
+ * Passes of the load path, in the order they run
+ */
+enum BenchmarkStage {
+    STAGE_LOAD = 0,     // LoadFromSTL: read, decode, fused bounds and normal checks
+    STAGE_BOUNDS,       // A separate bounds sweep over the decoded triangles
+    STAGE_WELD,
+    STAGE_PROCESS,      // Render geometry, vertex cache order, clusters, strips and levels of detail
+    STAGE_FRAME,        // CPU side of drawing one frame in immediate mode, GX recorded
+    STAGE_COUNT
+};
+
+/**
+ * Time and arena use of one stage. Processing is skipped when welding
+ * fails, as on the console; the frame is drawn either way.
+ */
+struct StageResult {
+    bool completed;
+    u32 micros;
+    u32 meshPeakBytes;      // Arena high-water marks while the stage ran
+    u32 scratchPeakBytes;
+};
+
+/**
+ * Best-of-N timings of one model through the console's load path
+ */
+struct LoadBenchmarkResult {
+    std::string name;
+    std::string group;      // Generated shape, or empty for files given
+    long fileBytes;
+    int triangleCount;
+    int vertexCount;
+    bool binary;
+
+    StageResult stages[STAGE_COUNT];
+    u32 frameBytes;         // FIFO bytes of the measured frame
+
+    u32 GetMeshPeakBytes() const;
+    u32 GetScratchPeakBytes() const;
+    f32 GetMegabytesPerSecond() const;
+    f32 GetTrianglesPerSecond() const;
+};
+
+/**
+ * Runs STL files through the same passes MeshLoadJob does, on the host,
+ * then draws a frame through the renderer with GX recorded. Progress
+ * output of the passes is discarded unless verbose is set.
+ */
+class LoadBenchmark {
+public:
+    LoadBenchmark();
+    ~LoadBenchmark();
+
+    void SetRepeatCount(int count) { repeatCount = count; }
+    void SetVerbose(bool enable) { verbose = enable; }
+
+    // Benchmark one file and append its result; false if it failed to load
+    bool Run(const std::string& path, const std::string& group = "");
+
+    const std::vector<LoadBenchmarkResult>& GetResults() const { return results; }
+
+    // Result table, followed by the process's peak resident size
+    void PrintReport() const;
+
+    // One row per result with every stage's time and arena peaks
+    bool WriteCsv(const char* path) const;
+
+    static const char* GetStageName(BenchmarkStage stage);
+
+private:
+    int repeatCount;
+    bool verbose;
+    std::vector<LoadBenchmarkResult> results;
+    Renderer renderer;
+    bool rendererReady;
+
+    bool RunOnce(const std::string& path, LoadBenchmarkResult& result);
+    bool RenderFrame(const Mesh& mesh, LoadBenchmarkResult& result);
+};
+
+#endif // LOAD_BENCHMARK_H
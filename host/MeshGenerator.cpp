@@ -0,0 +1,329 @@
+#include "MeshGenerator.h"
+#include "Vector3.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+static const f32 MODEL_RADIUS = 50.0f;
+
+static const char* SHAPE_NAMES[MESH_SHAPE_COUNT] = { "sphere", "scan", "soup", "degenerate" };
+
+namespace {
+
+/**
+ * Buffered STL output. Binary facets are written in host byte order, which
+ * matches the little-endian file format on the x86 and ARM hosts this runs
+ * on; ASCII coordinates are printed with enough digits to read back the
+ * same floats.
+ */
+class StlWriter {
+public:
+    StlWriter() : file(nullptr), ascii(false), used(0), written(0) {}
+
+    ~StlWriter() {
+        if (file) {
+            fclose(file);
+        }
+    }
+
+    bool Open(const char* path, u32 triangleCount, bool asciiFormat) {
+        ascii = asciiFormat;
+        file = fopen(path, "wb");
+        if (!file) {
+            printf("ERROR: Cannot create file: %s\n", path);
+            return false;
+        }
+
+        if (ascii) {
+            return fprintf(file, "solid synthetic\n") > 0;
+        }
+
+        u8 header[80];
+        memset(header, 0, sizeof(header));
+        strncpy(reinterpret_cast<char*>(header), "gamecube_stl_viewer synthetic mesh", sizeof(header) - 1);
+        return fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+               fwrite(&triangleCount, 4, 1, file) == 1;
+    }
+
+    // Facet with its geometric normal
+    void AddTriangle(const Vector3& a, const Vector3& b, const Vector3& c) {
+        f32 e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+        f32 e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+        Vector3 normal(e1y * e2z - e1z * e2y, e1z * e2x - e1x * e2z, e1x * e2y - e1y * e2x);
+        f32 length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        if (length > 0.0f) {
+            normal.x /= length;
+            normal.y /= length;
+            normal.z /= length;
+        }
+        AddTriangle(normal, a, b, c);
+    }
+
+    // Facet with whatever normal the caller wants stored
+    void AddTriangle(const Vector3& normal, const Vector3& a, const Vector3& b, const Vector3& c) {
+        written++;
+        if (ascii) {
+            fprintf(file, "  facet normal %.9g %.9g %.9g\n    outer loop\n", normal.x, normal.y, normal.z);
+            fprintf(file, "      vertex %.9g %.9g %.9g\n", a.x, a.y, a.z);
+            fprintf(file, "      vertex %.9g %.9g %.9g\n", b.x, b.y, b.z);
+            fprintf(file, "      vertex %.9g %.9g %.9g\n", c.x, c.y, c.z);
+            fprintf(file, "    endloop\n  endfacet\n");
+            return;
+        }
+
+        if (used + FACET_SIZE > sizeof(buffer)) {
+            FlushBuffer();
+        }
+
+        f32 values[12] = { normal.x, normal.y, normal.z, a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z };
+        memcpy(buffer + used, values, sizeof(values));
+        memset(buffer + used + sizeof(values), 0, 2); // Attribute byte count
+        used += FACET_SIZE;
+    }
+
+    bool Close(u32 expectedCount) {
+        if (ascii) {
+            fprintf(file, "endsolid synthetic\n");
+        }
+        FlushBuffer();
+        bool ok = !ferror(file) && written == expectedCount;
+        if (fclose(file) != 0) {
+            ok = false;
+        }
+        file = nullptr;
+        return ok;
+    }
+
+private:
+    static const u32 FACET_SIZE = 50;
+
+    FILE* file;
+    bool ascii;
+    u8 buffer[FACET_SIZE * 4096];
+    u32 used;
+    u32 written;
+
+    void FlushBuffer() {
+        if (used > 0) {
+            fwrite(buffer, 1, used, file);
+            used = 0;
+        }
+    }
+};
+
+// Integer hash (lowbias32) standing in for a seeded random generator
+u32 Hash(u32 x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+// Uniform in [-1, 1], a function of key and stream only
+f32 Noise(u32 key, u32 stream) {
+    return Hash(key * 4 + stream) / 2147483647.5f - 1.0f;
+}
+
+/**
+ * How a sphere's facets are perturbed
+ */
+struct SphereStyle {
+    f32 bump;               // Radial displacement per grid vertex, relative to the radius
+    f32 jitter;             // Displacement per facet corner, so shared corners differ slightly
+    bool zeroNormals;       // Store (0, 0, 0) instead of the facet normal
+    u32 degenerateInterval; // Collapse every Nth facet, 0 for none
+
+    SphereStyle() : bump(0.0f), jitter(0.0f), zeroNormals(false), degenerateInterval(0) {}
+};
+
+class SphereGrid {
+public:
+    SphereGrid(f32 radius, u32 segments, u32 rings, const SphereStyle& style)
+        : radius(radius), segments(segments), rings(rings), style(style) {}
+
+    Vector3 GetPoint(u32 segment, u32 ring) const {
+        f32 theta = static_cast<f32>(M_PI) * ring / (rings - 1);
+        f32 phi = 2.0f * static_cast<f32>(M_PI) * (segment % segments) / segments;
+        f32 r = radius;
+        if (style.bump > 0.0f) {
+            // The poles are one vertex each, whatever the segment
+            bool pole = (ring == 0 || ring + 1 == rings);
+            u32 key = pole ? ring * segments : ring * segments + segment % segments;
+            r *= 1.0f + style.bump * Noise(key, 0);
+        }
+        return Vector3(r * sinf(theta) * cosf(phi), r * sinf(theta) * sinf(phi), r * cosf(theta));
+    }
+
+    void Emit(StlWriter& writer, Vector3 a, Vector3 b, Vector3 c, u32 facet) const {
+        if (style.jitter > 0.0f) {
+            Vector3* corners[3] = { &a, &b, &c };
+            f32 amount = style.jitter * radius;
+            for (u32 i = 0; i < 3; i++) {
+                u32 key = facet * 3 + i;
+                corners[i]->x += amount * Noise(key, 1);
+                corners[i]->y += amount * Noise(key, 2);
+                corners[i]->z += amount * Noise(key, 3);
+            }
+        }
+
+        if (style.degenerateInterval > 0 && facet % style.degenerateInterval == 0) {
+            // Cycle through what broken exporters produce: a collapsed edge,
+            // a single point and a sliver of three collinear points, stored
+            // with zero, plausible and non-unit normals
+            u32 kind = (facet / style.degenerateInterval) % 3;
+            Vector3 normals[3] = { Vector3(), Vector3(0.0f, 0.0f, 1.0f), Vector3(1.0f, 1.0f, 1.0f) };
+            if (kind == 0) {
+                writer.AddTriangle(normals[0], a, a, c);
+            } else if (kind == 1) {
+                writer.AddTriangle(normals[1], a, a, a);
+            } else {
+                Vector3 middle((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f);
+                writer.AddTriangle(normals[2], a, middle, b);
+            }
+        } else if (style.zeroNormals) {
+            writer.AddTriangle(Vector3(), a, b, c);
+        } else {
+            writer.AddTriangle(a, b, c);
+        }
+    }
+
+    void Write(StlWriter& writer) const {
+        // Wound counter-clockwise seen from outside; the pole rows are fans
+        u32 facet = 0;
+        for (u32 ring = 0; ring + 1 < rings; ring++) {
+            for (u32 segment = 0; segment < segments; segment++) {
+                Vector3 a = GetPoint(segment, ring);
+                Vector3 b = GetPoint(segment, ring + 1);
+                Vector3 c = GetPoint(segment + 1, ring + 1);
+                Vector3 d = GetPoint(segment + 1, ring);
+                if (ring == 0) {
+                    Emit(writer, a, b, c, facet++);
+                } else if (ring + 2 == rings) {
+                    Emit(writer, a, b, d, facet++);
+                } else {
+                    Emit(writer, a, b, c, facet++);
+                    Emit(writer, a, c, d, facet++);
+                }
+            }
+        }
+    }
+
+private:
+    f32 radius;
+    u32 segments;
+    u32 rings;
+    SphereStyle style;
+};
+
+// Sphere grid with at most triangleCount triangles, about twice as many
+// segments as rings so the quads are roughly square
+void GetSphereGrid(u32 triangleCount, u32& segments, u32& rings) {
+    segments = static_cast<u32>(sqrtf(static_cast<f32>(triangleCount)) + 0.5f);
+    if (segments < 3) {
+        segments = 3;
+    }
+    u32 bands = triangleCount / (2 * segments);
+    rings = (bands < 1 ? 1 : bands) + 2;
+}
+
+// Small triangles of random size and orientation scattered through the
+// model's bounding cube, sharing no vertices
+void WriteSoup(StlWriter& writer, u32 triangleCount) {
+    f32 size = 2.0f * MODEL_RADIUS / cbrtf(static_cast<f32>(triangleCount));
+    for (u32 i = 0; i < triangleCount; i++) {
+        Vector3 center(MODEL_RADIUS * Noise(i, 0), MODEL_RADIUS * Noise(i, 1), MODEL_RADIUS * Noise(i, 2));
+        Vector3 corners[3];
+        for (u32 j = 0; j < 3; j++) {
+            u32 key = (i * 3 + j) + 0x9e3779b9U;
+            corners[j] = Vector3(center.x + size * Noise(key, 0), center.y + size * Noise(key, 1),
+                                 center.z + size * Noise(key, 2));
+        }
+        writer.AddTriangle(corners[0], corners[1], corners[2]);
+    }
+}
+
+} // namespace
+
+const char* MeshGenerator::GetShapeName(MeshShape shape) {
+    return (shape >= 0 && shape < MESH_SHAPE_COUNT) ? SHAPE_NAMES[shape] : "unknown";
+}
+
+bool MeshGenerator::ParseShape(const char* name, MeshShape& shape) {
+    for (int i = 0; i < MESH_SHAPE_COUNT; i++) {
+        if (strcmp(name, SHAPE_NAMES[i]) == 0) {
+            shape = static_cast<MeshShape>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+u32 MeshGenerator::GetTriangleCount(MeshShape shape, u32 triangleCount) {
+    if (shape == MESH_SHAPE_SOUP) {
+        return triangleCount;
+    }
+    u32 segments, rings;
+    GetSphereGrid(triangleCount, segments, rings);
+    return GetSphereTriangleCount(segments, rings);
+}
+
+bool MeshGenerator::Write(const char* path, MeshShape shape, u32 triangleCount, bool ascii) {
+    if (shape < 0 || shape >= MESH_SHAPE_COUNT || triangleCount == 0) {
+        printf("ERROR: Invalid shape or triangle count\n");
+        return false;
+    }
+
+    u32 count = GetTriangleCount(shape, triangleCount);
+    StlWriter writer;
+    if (!writer.Open(path, count, ascii)) {
+        return false;
+    }
+
+    if (shape == MESH_SHAPE_SOUP) {
+        WriteSoup(writer, count);
+    } else {
+        SphereStyle style;
+        if (shape == MESH_SHAPE_NOISY_SCAN) {
+            // Corner noise well inside MeshLoadJob's weld tolerance of 1e-5
+            // of the model size
+            style.bump = 0.02f;
+            style.jitter = 2e-6f;
+            style.zeroNormals = true;
+        } else if (shape == MESH_SHAPE_DEGENERATE) {
+            style.degenerateInterval = 8;
+        }
+
+        u32 segments, rings;
+        GetSphereGrid(triangleCount, segments, rings);
+        SphereGrid(MODEL_RADIUS, segments, rings, style).Write(writer);
+    }
+
+    if (!writer.Close(count)) {
+        printf("ERROR: Failed to write %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+bool MeshGenerator::WriteSphere(const char* path, f32 radius, u32 segments, u32 rings, bool ascii) {
+    if (segments < 3 || rings < 3) {
+        printf("ERROR: A sphere needs at least 3 segments and 3 rings\n");
+        return false;
+    }
+
+    u32 triangleCount = GetSphereTriangleCount(segments, rings);
+    StlWriter writer;
+    if (!writer.Open(path, triangleCount, ascii)) {
+        return false;
+    }
+
+    SphereGrid(radius, segments, rings, SphereStyle()).Write(writer);
+
+    if (!writer.Close(triangleCount)) {
+        printf("ERROR: Failed to write %s\n", path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef MESH_GENERATOR_H
+#define MESH_GENERATOR_H
+
+#include "Platform.h"
+
+/**
+ * Generated model topologies, each stressing a different part of the load
+ * path
+ */
+enum MeshShape {
+    MESH_SHAPE_SPHERE = 0,  // Closed UV sphere: every vertex shared, clean normals
+    MESH_SHAPE_NOISY_SCAN,  // Bumpy sphere whose shared corners differ by float noise, zero normals
+    MESH_SHAPE_SOUP,        // Disconnected triangles scattered through a cube: nothing to weld
+    MESH_SHAPE_DEGENERATE,  // Sphere with an eighth of the facets collapsed to zero area
+    MESH_SHAPE_COUNT
+};
+
+/**
+ * Writes synthetic STL files, binary or ASCII, for benchmarking models
+ * larger or stranger than the ones at hand. Output depends only on the
+ * arguments, so repeated runs measure the same files.
+ */
+class MeshGenerator {
+public:
+    // Model of the given shape with about triangleCount triangles (exactly
+    // GetTriangleCount of them), about 100 units across
+    static bool Write(const char* path, MeshShape shape, u32 triangleCount, bool ascii);
+    static u32 GetTriangleCount(MeshShape shape, u32 triangleCount);
+
+    // Closed UV sphere: segments around the axis, rings from pole to pole,
+    // 2 * segments * (rings - 2) triangles
+    static bool WriteSphere(const char* path, f32 radius, u32 segments, u32 rings, bool ascii = false);
+    static u32 GetSphereTriangleCount(u32 segments, u32 rings) { return 2 * segments * (rings - 2); }
+
+    static const char* GetShapeName(MeshShape shape);
+    static bool ParseShape(const char* name, MeshShape& shape);
+};
+
+#endif // MESH_GENERATOR_H
@@ -0,0 +1,244 @@
+// Host benchmark of the STL load path: decoding, bounds, welding, the
+// render preprocessing passes and a recorded frame, on bitcoin.stl or any
+// STL files given, plus generated models too large to keep in the
+// repository: three large spheres, or a sweep of every generated shape
+// from 1K triangles up to the loader's limit, written out as CSV. It can
+// also time the file menu's scan over a generated tree of thousands of
+// models.
+
+#include "LoadBenchmark.h"
+#include "MeshGenerator.h"
+#include "MemorySystem.h"
+#include "FileManager.h"
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * Generated sphere sizes: about 100k, 500k and 1M triangles (the loader's limit)
+ */
+struct GeneratedSphere {
+    const char* name;
+    u32 segments;
+    u32 rings;
+};
+
+static const GeneratedSphere GENERATED_SPHERES[] = {
+    { "sphere_100k.stl", 250, 202 },
+    { "sphere_500k.stl", 500, 502 },
+    { "sphere_1m.stl",   1000, 501 },
+};
+
+// Sweep sizes, about half a decade apart, up to the loader's limit
+static const u32 SWEEP_SIZES[] = { 1000, 3000, 10000, 30000, 100000, 300000, 1000000 };
+
+// Generated scan tree: folders of subfolders of small models, with a file
+// the scanner should pass over in each
+static const u32 SCAN_FOLDERS = 20;
+static const u32 SCAN_SUBFOLDERS = 10;
+static const u32 SCAN_MODELS = 20;
+
+static void PrintUsage(const char* program) {
+    printf("Usage: %s [-n repeats] [-g directory] [-s directory] [-t shape] [-a] [-c file.csv] [-v] [file.stl ...]\n",
+           program);
+    printf("  -n repeats    runs per file, best time reported (default 3)\n");
+    printf("  -g directory  generate large spheres into directory and benchmark them\n");
+    printf("  -s directory  sweep generated models from 1K to 1M triangles through directory\n");
+    printf("  -t shape      sweep only this shape: sphere, scan, soup or degenerate\n");
+    printf("  -a            sweep ASCII files as well as binary ones\n");
+    printf("  -c file.csv   also write every result as CSV\n");
+    printf("  -f directory  time the file menu's startup over a tree of %u models generated in directory\n",
+           SCAN_FOLDERS * SCAN_SUBFOLDERS * SCAN_MODELS);
+    printf("  -v            show the loader's own log\n");
+}
+
+// Generate, benchmark and delete each model of the sweep in turn, so at most
+// one large file is on disk at a time
+static bool RunSweep(LoadBenchmark& benchmark, const char* directory, int shapeFilter, bool ascii) {
+    for (int shape = 0; shape < MESH_SHAPE_COUNT; shape++) {
+        if (shapeFilter >= 0 && shape != shapeFilter) {
+            continue;
+        }
+        for (int format = 0; format < (ascii ? 2 : 1); format++) {
+            for (u32 size : SWEEP_SIZES) {
+                MeshShape meshShape = static_cast<MeshShape>(shape);
+                const char* name = MeshGenerator::GetShapeName(meshShape);
+                char fileName[64];
+                snprintf(fileName, sizeof(fileName), "%s_%u%s.stl", name, size, format ? "_ascii" : "");
+                std::string path = std::string(directory) + "/" + fileName;
+
+                printf("Sweeping %s (%u triangles)\n", path.c_str(), MeshGenerator::GetTriangleCount(meshShape, size));
+                fflush(stdout);
+                if (!MeshGenerator::Write(path.c_str(), meshShape, size, format != 0)) {
+                    return false;
+                }
+                // Files the viewer rejects show up as failed rows, not errors
+                benchmark.Run(path, name);
+                unlink(path.c_str());
+            }
+        }
+    }
+    return true;
+}
+
+static bool WriteScanTree(const std::string& root) {
+    mkdir(root.c_str(), 0755);
+    for (u32 folder = 0; folder < SCAN_FOLDERS; folder++) {
+        char name[64];
+        snprintf(name, sizeof(name), "/set%02u", folder);
+        std::string folderPath = root + name;
+        mkdir(folderPath.c_str(), 0755);
+
+        for (u32 subfolder = 0; subfolder < SCAN_SUBFOLDERS; subfolder++) {
+            snprintf(name, sizeof(name), "/part%02u", subfolder);
+            std::string subfolderPath = folderPath + name;
+            mkdir(subfolderPath.c_str(), 0755);
+
+            FILE* readme = fopen((subfolderPath + "/readme.txt").c_str(), "w");
+            if (readme) {
+                fclose(readme);
+            }
+            for (u32 model = 0; model < SCAN_MODELS; model++) {
+                snprintf(name, sizeof(name), "/model%02u.stl", model);
+                if (!MeshGenerator::Write((subfolderPath + name).c_str(), MESH_SHAPE_SOUP, 2, false)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Bring a file menu up over root and keep its index updating until current;
+// returns the time until the menu could be shown
+static bool StartFileMenu(FileManager& files, const std::string& root, u32& menuMicros) {
+    files.SetScanRoots(std::vector<std::string>(1, root + "/"));
+    u64 startTime = gettime();
+    if (!files.Initialize()) {
+        return false;
+    }
+    menuMicros = diff_usec(startTime, gettime());
+
+    // As in idle menu frames, but without waiting for the retrace between
+    while (!files.IsIndexUpToDate()) {
+        files.UpdateIndex(8000);
+    }
+    return true;
+}
+
+// Start the file menu over the tree as the viewer would: first without a
+// file index, which is scanned and then written, then from that index
+static bool RunScanBenchmark(const char* directory) {
+    std::string root = std::string(directory) + "/scan_tree";
+    struct stat statbuf;
+    if (stat(root.c_str(), &statbuf) != 0 && !WriteScanTree(root)) {
+        return false;
+    }
+    remove((root + "/" + FileManager::INDEX_FILE_NAME).c_str());
+
+    const char* labels[2] = { "without index", "from index" };
+    for (int pass = 0; pass < 2; pass++) {
+        FileManager files;
+        u32 menuMicros = 0;
+        if (!StartFileMenu(files, root, menuMicros)) {
+            return false;
+        }
+
+        const ScanStats& stats = files.GetScanStats();
+        printf("Start %-13s: menu after %.2f ms; recheck of %d models: %u folders, %u stat calls, "
+               "%u probed in %.2f ms\n", labels[pass], menuMicros / 1000.0f, files.GetFileCount(),
+               stats.directories, stats.statCalls, stats.probes, stats.micros / 1000.0f);
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    LoadBenchmark benchmark;
+    std::vector<std::string> paths;
+    const char* generateDirectory = nullptr;
+    const char* sweepDirectory = nullptr;
+    const char* csvPath = nullptr;
+    const char* scanDirectory = nullptr;
+    int shapeFilter = -1;
+    bool sweepAscii = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            int repeats = atoi(argv[++i]);
+            benchmark.SetRepeatCount(repeats > 0 ? repeats : 1);
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            generateDirectory = argv[++i];
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            sweepDirectory = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            MeshShape shape;
+            if (!MeshGenerator::ParseShape(argv[++i], shape)) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            shapeFilter = shape;
+        } else if (strcmp(argv[i], "-a") == 0) {
+            sweepAscii = true;
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            scanDirectory = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            benchmark.SetVerbose(true);
+        } else if (argv[i][0] == '-') {
+            PrintUsage(argv[0]);
+            return 1;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    bool loadWork = !paths.empty() || generateDirectory || sweepDirectory;
+    if (scanDirectory) {
+        if (!RunScanBenchmark(scanDirectory)) {
+            return 1;
+        }
+        if (!loadWork) {
+            return 0;
+        }
+    }
+    if (!loadWork) {
+        paths.push_back("bitcoin.stl");
+    }
+
+    if (generateDirectory) {
+        for (const GeneratedSphere& sphere : GENERATED_SPHERES) {
+            std::string path = std::string(generateDirectory) + "/" + sphere.name;
+            printf("Generating %s (%u triangles)\n", path.c_str(),
+                   MeshGenerator::GetSphereTriangleCount(sphere.segments, sphere.rings));
+            if (!MeshGenerator::WriteSphere(path.c_str(), 50.0f, sphere.segments, sphere.rings)) {
+                return 1;
+            }
+            paths.push_back(path);
+        }
+    }
+
+    if (!MemorySystem::Initialize()) {
+        printf("ERROR: Failed to initialize memory arenas\n");
+        return 1;
+    }
+
+    bool ok = true;
+    for (const std::string& path : paths) {
+        ok = benchmark.Run(path) && ok;
+    }
+    if (sweepDirectory) {
+        ok = RunSweep(benchmark, sweepDirectory, shapeFilter, sweepAscii) && ok;
+    }
+
+    benchmark.PrintReport();
+    if (csvPath) {
+        ok = benchmark.WriteCsv(csvPath) && ok;
+    }
+    MemorySystem::Shutdown();
+    return ok ? 0 : 1;
+}
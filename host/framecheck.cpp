@@ -0,0 +1,78 @@
+// Frame cost regression check: renders bitcoin.stl from fixed views with
+// the GX command recorder and fails if any frame would send the GPU more
+// than the checked-in baseline allows. Optionally also checks the load
+// passes on a generated model with degenerate facets and the lighting bake
+// against its reference.
+
+#include "FrameCostCheck.h"
+#include "MemorySystem.h"
+#include <cstdio>
+#include <cstring>
+
+static void PrintUsage(const char* program) {
+    printf("Usage: %s [--update] [--log] [--degenerate directory] [--lighting] model.stl baseline.txt\n",
+           program);
+    printf("  --update                  write the measured costs as the new baseline\n");
+    printf("  --log                     print the command log of the last frame\n");
+    printf("  --degenerate directory    also check a model with zero-area facets generated in directory\n");
+    printf("  --lighting                also check baked lighting against the reference\n");
+}
+
+int main(int argc, char** argv) {
+    bool update = false;
+    bool log = false;
+    const char* degenerateDirectory = nullptr;
+    bool lighting = false;
+    const char* paths[2] = { nullptr, nullptr };
+    int pathCount = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else if (strcmp(argv[i], "--log") == 0) {
+            log = true;
+        } else if (strcmp(argv[i], "--degenerate") == 0 && i + 1 < argc) {
+            degenerateDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--lighting") == 0) {
+            lighting = true;
+        } else if (argv[i][0] != '-' && pathCount < 2) {
+            paths[pathCount++] = argv[i];
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (pathCount != 2) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if (!MemorySystem::Initialize()) {
+        printf("ERROR: Failed to initialize memory arenas\n");
+        return 1;
+    }
+
+    bool ok = false;
+    {
+        FrameCostCheck check;
+        if (check.Initialize(paths[0])) {
+            bool measured = check.Measure();
+            if (log) {
+                GXRecorder::PrintCommands(200);
+            }
+            check.PrintReport();
+            ok = update ? (measured && check.WriteBaseline(paths[1])) : check.CompareWithBaseline(paths[1]);
+        } else {
+            printf("ERROR: Failed to set up %s\n", paths[0]);
+        }
+    }
+    if (degenerateDirectory) {
+        ok = FrameCostCheck::CheckDegenerateFacets(degenerateDirectory) && ok;
+    }
+    if (lighting) {
+        ok = FrameCostCheck::CheckLightingBake() && ok;
+    }
+
+    MemorySystem::Shutdown();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+#ifndef HOST_GCCORE_H
+#define HOST_GCCORE_H
+
+/**
+ * Host stand-in for libogc's gccore.h: the subset of GX, gu, VIDEO, LWP and
+ * cache functions that Renderer and PerformanceHud use, so they build
+ * unchanged on the host. The GX functions are implemented by GXRecorder,
+ * which logs what a frame would put in the FIFO instead of drawing it.
+ * Enumerant values follow libogc.
+ */
+#include <stddef.h>
+#include "Platform.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+typedef f32 Mtx44[4][4];
+
+typedef struct {
+    f32 x, y, z;
+} guVector;
+
+typedef struct {
+    u8 r, g, b, a;
+} GXColor;
+
+typedef struct {
+    u32 viTVMode;
+    u16 fbWidth;
+    u16 efbHeight;
+    u16 xfbHeight;
+    u16 viXOrigin;
+    u16 viYOrigin;
+    u16 viWidth;
+    u16 viHeight;
+    u32 xfbMode;
+    u8 field_rendering;
+    u8 aa;
+    u8 sample_pattern[12][2];
+    u8 vfilter[7];
+} GXRModeObj;
+
+typedef struct { u32 val[8]; } GXTexObj;
+typedef struct { u32 val[16]; } GXLightObj;
+typedef struct { u8 pad[128]; } GXFifoObj;
+
+typedef u32 lwpq_t;
+#define LWP_TQUEUE_NULL 0xffffffff
+
+#define MEM_K0_TO_K1(x) ((void*)(x))
+
+enum {
+    GX_FALSE = 0, GX_TRUE = 1,
+    GX_DISABLE = 0, GX_ENABLE = 1
+};
+
+// Vertex attributes and how they are sent
+enum { GX_VA_PNMTXIDX = 0, GX_VA_POS = 9, GX_VA_NRM = 10, GX_VA_CLR0 = 11, GX_VA_CLR1 = 12, GX_VA_TEX0 = 13,
+       GX_VA_MAX = 21 };
+enum { GX_NONE = 0, GX_DIRECT = 1, GX_INDEX8 = 2, GX_INDEX16 = 3 };
+enum { GX_VTXFMT0 = 0, GX_VTXFMT1 = 1, GX_VTXFMT2 = 2, GX_MAXVTXFMT = 8 };
+enum { GX_POS_XY = 0, GX_POS_XYZ = 1, GX_NRM_XYZ = 0, GX_CLR_RGB = 0, GX_CLR_RGBA = 1, GX_TEX_S = 0, GX_TEX_ST = 1 };
+enum { GX_U8 = 0, GX_S8 = 1, GX_U16 = 2, GX_S16 = 3, GX_F32 = 4 };
+enum { GX_RGB565 = 0, GX_RGB8 = 1, GX_RGBX8 = 2, GX_RGBA4 = 3, GX_RGBA6 = 4, GX_RGBA8 = 5 };
+
+// Primitives
+enum { GX_QUADS = 0x80, GX_TRIANGLES = 0x90, GX_TRIANGLESTRIP = 0x98, GX_TRIANGLEFAN = 0xa0,
+       GX_LINES = 0xa8, GX_LINESTRIP = 0xb0, GX_POINTS = 0xb8 };
+
+// Matrices
+enum { GX_PNMTX0 = 0, GX_PNMTX1 = 3 };
+enum { GX_PERSPECTIVE = 0, GX_ORTHOGRAPHIC = 1 };
+enum { GX_IDENTITY = 60 };
+
+// Pixel state
+enum { GX_NEVER = 0, GX_LESS, GX_EQUAL, GX_LEQUAL, GX_GREATER, GX_NEQUAL, GX_GEQUAL, GX_ALWAYS };
+enum { GX_CULL_NONE = 0, GX_CULL_FRONT, GX_CULL_BACK, GX_CULL_ALL };
+enum { GX_BM_NONE = 0, GX_BM_BLEND, GX_BM_LOGIC, GX_BM_SUBTRACT };
+enum { GX_BL_ZERO = 0, GX_BL_ONE, GX_BL_SRCCLR, GX_BL_INVSRCCLR, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA };
+enum { GX_LO_CLEAR = 0 };
+enum { GX_GM_1_0 = 0, GX_GM_1_7, GX_GM_2_2 };
+
+// Lighting channels
+enum { GX_COLOR0A0 = 4 };
+enum { GX_SRC_REG = 0, GX_SRC_VTX = 1 };
+enum { GX_LIGHTNULL = 0, GX_LIGHT0 = 0x01, GX_LIGHT1 = 0x02, GX_LIGHT2 = 0x04, GX_LIGHT3 = 0x08 };
+enum { GX_DF_NONE = 0, GX_DF_SIGN, GX_DF_CLAMP };
+enum { GX_AF_SPEC = 0, GX_AF_SPOT, GX_AF_NONE };
+
+// Texturing and TEV
+enum { GX_TEXCOORD0 = 0, GX_TEXCOORDNULL = 0xff };
+enum { GX_TEXMAP0 = 0, GX_TEXMAP_NULL = 0xff };
+enum { GX_TEVSTAGE0 = 0 };
+enum { GX_MODULATE = 0, GX_DECAL, GX_BLEND, GX_REPLACE, GX_PASSCLR };
+enum { GX_TG_MTX3x4 = 0, GX_TG_MTX2x4 = 1 };
+enum { GX_TG_POS = 0, GX_TG_NRM, GX_TG_BINRM, GX_TG_TANGENT, GX_TG_TEX0 };
+enum { GX_TF_I4 = 0, GX_TF_I8 = 1 };
+enum { GX_CLAMP = 0, GX_REPEAT, GX_MIRROR };
+enum { GX_NEAR = 0, GX_LINEAR };
+enum { GX_ANISO_1 = 0 };
+
+// Performance counters
+enum { GX_PERF0_CLIP_VTX = 1, GX_PERF0_TRIANGLES = 11, GX_PERF0_TRIANGLES_CULLED = 12, GX_PERF0_NONE = 35 };
+enum { GX_PERF1_VERTICES = 16, GX_PERF1_FIFO_REQ = 17, GX_PERF1_CALL_REQ = 18, GX_PERF1_NONE = 22 };
+enum { GX_VC_ALL = 0xf };
+
+typedef void (*GXDrawDoneCallback)(void);
+typedef void (*VIRetraceCallback)(u32 retraceCount);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern GXRModeObj TVNtsc480IntDf;
+
+// Setup
+GXFifoObj* GX_Init(void* base, u32 size);
+void GX_GetCPUFifo(GXFifoObj* fifo);
+u32 GX_GetFifoCount(GXFifoObj* fifo);
+void GX_Flush(void);
+void GX_DrawDone(void);
+void GX_SetDrawDone(void);
+GXDrawDoneCallback GX_SetDrawDoneCallback(GXDrawDoneCallback callback);
+
+// Framebuffer and copies
+void GX_SetCopyClear(GXColor color, u32 z);
+void GX_SetViewport(f32 x, f32 y, f32 width, f32 height, f32 nearZ, f32 farZ);
+void GX_SetScissor(u32 x, u32 y, u32 width, u32 height);
+void GX_SetDispCopyYScale(f32 scale);
+void GX_SetDispCopySrc(u16 left, u16 top, u16 width, u16 height);
+void GX_SetDispCopyDst(u16 width, u16 height);
+void GX_SetDispCopyGamma(u8 gamma);
+void GX_SetCopyFilter(u8 aa, u8 samplePattern[12][2], u8 verticalFilter, u8 filter[7]);
+void GX_SetFieldMode(u8 fieldMode, u8 halfAspectRatio);
+void GX_CopyDisp(void* destination, u8 clear);
+
+// Pixel state
+void GX_SetZMode(u8 enable, u8 function, u8 updateEnable);
+void GX_SetColorUpdate(u8 enable);
+void GX_SetAlphaUpdate(u8 enable);
+void GX_SetCullMode(u8 mode);
+void GX_SetBlendMode(u8 type, u8 sourceFactor, u8 destinationFactor, u8 operation);
+
+// Transform and lighting
+void GX_LoadProjectionMtx(Mtx44 matrix, u8 type);
+void GX_LoadPosMtxImm(Mtx matrix, u32 index);
+void GX_SetCurrentMtx(u32 index);
+void GX_SetNumChans(u8 count);
+void GX_SetChanCtrl(s32 channel, u8 enable, u8 ambientSource, u8 materialSource, u8 lightMask,
+                    u8 diffuseFunction, u8 attenuationFunction);
+void GX_SetChanAmbColor(s32 channel, GXColor color);
+void GX_InitLightPos(GXLightObj* light, f32 x, f32 y, f32 z);
+void GX_InitLightDir(GXLightObj* light, f32 x, f32 y, f32 z);
+void GX_InitLightColor(GXLightObj* light, GXColor color);
+void GX_LoadLightObj(GXLightObj* light, u8 id);
+
+// Texturing and TEV
+void GX_SetNumTexGens(u32 count);
+void GX_SetTexCoordGen(u16 texCoord, u32 type, u32 source, u32 matrix);
+void GX_InitTexObj(GXTexObj* texture, void* data, u16 width, u16 height, u8 format, u8 wrapS, u8 wrapT, u8 mipmap);
+void GX_InitTexObjLOD(GXTexObj* texture, u8 minFilter, u8 magFilter, f32 minLod, f32 maxLod, f32 lodBias,
+                      u8 biasClamp, u8 edgeLod, u8 maxAniso);
+void GX_LoadTexObj(GXTexObj* texture, u8 map);
+void GX_InvalidateTexAll(void);
+void GX_SetTevOrder(u8 stage, u8 texCoord, u32 texMap, u8 color);
+void GX_SetTevOp(u8 stage, u8 mode);
+
+// Vertex format and arrays
+void GX_ClearVtxDesc(void);
+void GX_SetVtxDesc(u8 attribute, u8 type);
+void GX_SetVtxAttrFmt(u8 format, u32 attribute, u32 componentCount, u32 componentType, u32 fracBits);
+void GX_SetArray(u32 attribute, void* base, u8 stride);
+void GX_InvVtxCache(void);
+
+// Primitives and vertex data
+void GX_Begin(u8 primitive, u8 format, u16 vertexCount);
+void GX_End(void);
+void GX_Position3f32(f32 x, f32 y, f32 z);
+void GX_Position3s16(s16 x, s16 y, s16 z);
+void GX_Position2s16(s16 x, s16 y);
+void GX_Position1x16(u16 index);
+void GX_Position1x8(u8 index);
+void GX_Normal3f32(f32 x, f32 y, f32 z);
+void GX_Normal3s8(s8 x, s8 y, s8 z);
+void GX_Normal1x16(u16 index);
+void GX_Normal1x8(u8 index);
+void GX_Color1u32(u32 color);
+void GX_Color1x16(u16 index);
+void GX_Color1x8(u8 index);
+void GX_TexCoord2f32(f32 s, f32 t);
+
+// Display lists
+void GX_BeginDispList(void* list, u32 size);
+u32 GX_EndDispList(void);
+void GX_CallDispList(void* list, u32 size);
+
+// Performance counters
+void GX_SetGPMetric(u32 perf0, u32 perf1);
+void GX_ReadGPMetric(u32* perf0, u32* perf1);
+void GX_InitXfRasMetric(void);
+void GX_ReadXfRasMetric(u32* xfWaitIn, u32* xfWaitOut, u32* rasterBusy, u32* clocks);
+void GX_SetVCacheMetric(u32 attribute);
+void GX_ReadVCacheMetric(u32* checks, u32* misses, u32* stalls);
+
+// Matrix math
+void guMtxIdentity(Mtx matrix);
+void guMtxCopy(Mtx source, Mtx destination);
+void guMtxConcat(Mtx a, Mtx b, Mtx ab);
+void guMtxScaleApply(Mtx source, Mtx destination, f32 x, f32 y, f32 z);
+void guMtxTransApply(Mtx source, Mtx destination, f32 x, f32 y, f32 z);
+void guLookAt(Mtx matrix, guVector* position, guVector* up, guVector* target);
+void guPerspective(Mtx44 matrix, f32 fovY, f32 aspect, f32 nearZ, f32 farZ);
+void guOrtho(Mtx44 matrix, f32 top, f32 bottom, f32 left, f32 right, f32 nearZ, f32 farZ);
+
+// Video, threads, interrupts and caches
+void* SYS_AllocateFramebuffer(GXRModeObj* mode);
+u32 VIDEO_GetFrameBufferSize(GXRModeObj* mode);
+void VIDEO_SetNextFramebuffer(void* frameBuffer);
+void VIDEO_SetBlack(int black);
+void VIDEO_Flush(void);
+VIRetraceCallback VIDEO_SetPreRetraceCallback(VIRetraceCallback callback);
+s32 LWP_InitQueue(lwpq_t* queue);
+void LWP_CloseQueue(lwpq_t queue);
+s32 LWP_ThreadSleep(lwpq_t queue);
+void LWP_ThreadBroadcast(lwpq_t queue);
+u32 IRQ_Disable(void);
+void IRQ_Restore(u32 level);
+void DCFlushRange(void* start, u32 size);
+void DCInvalidateRange(void* start, u32 size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_GCCORE_H
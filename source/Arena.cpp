@@ -0,0 +1,125 @@
+#include "Arena.h"
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+
+static inline u32 AlignUp(u32 value, u32 alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+Arena::Arena() : name(""), base(nullptr), capacity(0), offset(0), lastOffset(0), backOffset(0),
+                 highWaterMark(0), failedAllocations(0) {
+}
+
+Arena::~Arena() {
+    Shutdown();
+}
+
+bool Arena::Initialize(const char* arenaName, u32 arenaCapacity) {
+    Shutdown();
+
+    name = arenaName;
+    capacity = AlignUp(arenaCapacity, DEFAULT_ALIGNMENT);
+    base = static_cast<u8*>(memalign(DEFAULT_ALIGNMENT, capacity));
+    if (!base) {
+        printf("ERROR: Failed to reserve %u KB for %s arena\n", capacity / 1024, name);
+        capacity = 0;
+        return false;
+    }
+
+    Reset();
+    highWaterMark = 0;
+    failedAllocations = 0;
+    return true;
+}
+
+void Arena::Shutdown() {
+    if (base) {
+        free(base);
+        base = nullptr;
+    }
+    capacity = 0;
+    offset = 0;
+    lastOffset = 0;
+    backOffset = 0;
+}
+
+void* Arena::Allocate(u32 size, u32 alignment) {
+    u32 start = AlignUp(offset, alignment);
+    u32 limit = capacity - backOffset;
+    if (!base || start > limit || size > limit - start) {
+        failedAllocations++;
+        return nullptr;
+    }
+
+    lastOffset = start;
+    offset = start + size;
+    UpdateHighWaterMark();
+    return base + start;
+}
+
+void* Arena::AllocateBack(u32 size, u32 alignment) {
+    u32 top = capacity - backOffset;
+    if (!base || size > top - offset) {
+        failedAllocations++;
+        return nullptr;
+    }
+
+    // Rounding the start down keeps the block clear of the front
+    u32 start = (top - size) & ~(alignment - 1);
+    if (start < offset) {
+        failedAllocations++;
+        return nullptr;
+    }
+
+    backOffset = capacity - start;
+    UpdateHighWaterMark();
+    return base + start;
+}
+
+void* Arena::Resize(void* block, u32 newSize) {
+    u8* bytes = static_cast<u8*>(block);
+    if (!block || bytes != base + lastOffset) {
+        return nullptr; // Only the most recent allocation can change size
+    }
+
+    if (newSize > capacity - backOffset - lastOffset) {
+        failedAllocations++;
+        return nullptr;
+    }
+
+    offset = lastOffset + newSize;
+    UpdateHighWaterMark();
+    return block;
+}
+
+bool Arena::CanAllocate(u32 size, u32 alignment) const {
+    u32 start = AlignUp(offset, alignment);
+    u32 limit = capacity - backOffset;
+    return base && start <= limit && size <= limit - start;
+}
+
+void Arena::Reset() {
+    offset = 0;
+    lastOffset = 0;
+    backOffset = 0;
+}
+
+void Arena::ResetToMarker(u32 marker) {
+    if (marker <= offset) {
+        offset = marker;
+        lastOffset = marker;
+    }
+}
+
+void Arena::ResetBackToMarker(u32 marker) {
+    if (marker <= backOffset) {
+        backOffset = marker;
+    }
+}
+
+void Arena::UpdateHighWaterMark() {
+    if (offset + backOffset > highWaterMark) {
+        highWaterMark = offset + backOffset;
+    }
+}
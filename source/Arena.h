@@ -0,0 +1,68 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "Platform.h"
+
+/**
+ * Linear region allocator over one fixed, 32-byte aligned block.
+ * Allocations are bumped from the front and released together by Reset or
+ * ResetToMarker; only the most recent allocation can be resized in place.
+ * A second stack grows down from the back, for data with its own lifetime
+ * that must be released without disturbing the front. Nothing is ever
+ * returned to the heap, so the block cannot fragment.
+ */
+class Arena {
+public:
+    Arena();
+    ~Arena();
+
+    bool Initialize(const char* name, u32 capacity);
+    void Shutdown();
+
+    void* Allocate(u32 size, u32 alignment = DEFAULT_ALIGNMENT);
+    void* Resize(void* block, u32 newSize);
+    bool CanAllocate(u32 size, u32 alignment = DEFAULT_ALIGNMENT) const;
+
+    // Release everything, or everything allocated after a marker; the
+    // marker of a block releases it and everything allocated after it
+    void Reset();
+    u32 GetMarker() const { return offset; }
+    u32 GetMarker(const void* block) const { return static_cast<u32>(static_cast<const u8*>(block) - base); }
+    void ResetToMarker(u32 marker);
+
+    // Blocks from the back stack; they cannot be resized, and Reset or a
+    // back marker releases them
+    void* AllocateBack(u32 size, u32 alignment = DEFAULT_ALIGNMENT);
+    u32 GetBackMarker() const { return backOffset; }
+    void ResetBackToMarker(u32 marker);
+
+    // Statistics
+    const char* GetName() const { return name; }
+    u32 GetCapacity() const { return capacity; }
+    u32 GetUsed() const { return offset + backOffset; }
+    u32 GetRemaining() const { return capacity - offset - backOffset; }
+    u32 GetHighWaterMark() const { return highWaterMark; }
+    void ResetHighWaterMark() { highWaterMark = GetUsed(); }
+    u32 GetFailedAllocations() const { return failedAllocations; }
+    bool IsInitialized() const { return base != nullptr; }
+
+    static const u32 DEFAULT_ALIGNMENT = 32;
+
+private:
+    const char* name;
+    u8* base;
+    u32 capacity;
+    u32 offset;
+    u32 lastOffset;
+    u32 backOffset;         // Bytes taken from the back stack
+    u32 highWaterMark;
+    u32 failedAllocations;
+
+    // Non-copyable
+    void UpdateHighWaterMark();
+
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+};
+
+#endif // ARENA_H
@@ -0,0 +1,358 @@
+#include "ClusterCuller.h"
+#include "Log.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+// Cutoff that no view direction can reach, for clusters without a usable cone
+const f32 NO_CONE = 2.0f;
+
+enum SphereTest {
+    SPHERE_OUTSIDE,
+    SPHERE_INTERSECTS,
+    SPHERE_INSIDE
+};
+
+f32 Length(const Vector3& v) {
+    return sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+}
+
+// Smallest sphere around both, or the larger one if it already holds the other
+void MergeSpheres(const Vector3& centerA, f32 radiusA, const Vector3& centerB, f32 radiusB,
+                  Vector3& center, f32& radius) {
+    Vector3 offset(centerB.x - centerA.x, centerB.y - centerA.y, centerB.z - centerA.z);
+    f32 distance = Length(offset);
+    if (distance + radiusB <= radiusA) {
+        center = centerA;
+        radius = radiusA;
+        return;
+    }
+    if (distance + radiusA <= radiusB) {
+        center = centerB;
+        radius = radiusB;
+        return;
+    }
+
+    radius = (distance + radiusA + radiusB) * 0.5f;
+    f32 t = (radius - radiusA) / distance;
+    center = Vector3(centerA.x + offset.x * t, centerA.y + offset.y * t, centerA.z + offset.z * t);
+}
+
+/**
+ * Recursive median splitter. Triangles are addressed through order, which
+ * is permuted in place; clusters and nodes are appended depth first.
+ */
+struct ClusterSplitter {
+    const Vector3* positions;
+    const u32* indices;
+    s32 orientation;
+    u32* order;
+    f32* keys;
+    u32* temp;
+    MeshCluster* clusters;
+    u32 clusterCount;
+    ClusterNode* nodes;
+    u32 nodeCount;
+
+    // Three times the centroid; only the ordering matters
+    f32 CentroidAxis(u32 triangle, int axis) const {
+        const u32* tri = indices + triangle * 3;
+        const f32* a = &positions[tri[0]].x;
+        const f32* b = &positions[tri[1]].x;
+        const f32* c = &positions[tri[2]].x;
+        return a[axis] + b[axis] + c[axis];
+    }
+
+    void Split(u32 first, u32 count) {
+        u32 nodeIndex = nodeCount++;
+        ClusterNode& node = nodes[nodeIndex];
+        node.firstCluster = clusterCount;
+
+        if (count <= ClusterCuller::MAX_TRIANGLES) {
+            MeshCluster& cluster = clusters[clusterCount++];
+            cluster.firstTriangle = first;
+            cluster.triangleCount = count;
+            cluster.firstPrimitive = 0;
+            cluster.primitiveCount = 0;
+            ComputeBounds(cluster);
+            node.center = cluster.center;
+            node.radius = cluster.radius;
+        } else {
+            // Cut across the longest axis of the centroids
+            f32 minimum[3] = { 1e30f, 1e30f, 1e30f };
+            f32 maximum[3] = { -1e30f, -1e30f, -1e30f };
+            for (u32 i = first; i < first + count; i++) {
+                for (int axis = 0; axis < 3; axis++) {
+                    f32 value = CentroidAxis(order[i], axis);
+                    if (value < minimum[axis]) minimum[axis] = value;
+                    if (value > maximum[axis]) maximum[axis] = value;
+                }
+            }
+            int axis = 0;
+            for (int i = 1; i < 3; i++) {
+                if (maximum[i] - minimum[i] > maximum[axis] - minimum[axis]) axis = i;
+            }
+
+            u32 half = count / 2;
+            for (u32 i = 0; i < count; i++) {
+                keys[i] = CentroidAxis(order[first + i], axis);
+            }
+            std::nth_element(keys, keys + half, keys + count);
+            f32 median = keys[half];
+
+            // Stable partition, so each side keeps the vertex cache order;
+            // triangles on the median fill whichever side has room
+            u32 below = 0;
+            for (u32 i = 0; i < count; i++) {
+                if (CentroidAxis(order[first + i], axis) < median) below++;
+            }
+            u32 left = 0;
+            u32 right = half;
+            u32 ties = half - below;
+            for (u32 i = 0; i < count; i++) {
+                u32 triangle = order[first + i];
+                f32 key = CentroidAxis(triangle, axis);
+                if (key < median || (key == median && ties > 0)) {
+                    if (key == median) ties--;
+                    temp[left++] = triangle;
+                } else {
+                    temp[right++] = triangle;
+                }
+            }
+            memcpy(order + first, temp, count * sizeof(u32));
+
+            Split(first, half);
+            u32 rightNode = nodes[nodeIndex + 1].skip;
+            Split(first + half, count - half);
+
+            const ClusterNode& a = nodes[nodeIndex + 1];
+            const ClusterNode& b = nodes[rightNode];
+            MergeSpheres(a.center, a.radius, b.center, b.radius, node.center, node.radius);
+        }
+
+        node.clusterCount = clusterCount - node.firstCluster;
+        node.skip = nodeCount;
+    }
+
+    void ComputeBounds(MeshCluster& cluster) const {
+        const u32* list = order + cluster.firstTriangle;
+
+        Vector3 minimum(1e30f, 1e30f, 1e30f);
+        Vector3 maximum(-1e30f, -1e30f, -1e30f);
+        Vector3 normalSum;
+        for (u32 i = 0; i < cluster.triangleCount; i++) {
+            const u32* tri = indices + list[i] * 3;
+            for (int k = 0; k < 3; k++) {
+                const Vector3& p = positions[tri[k]];
+                if (p.x < minimum.x) minimum.x = p.x;
+                if (p.y < minimum.y) minimum.y = p.y;
+                if (p.z < minimum.z) minimum.z = p.z;
+                if (p.x > maximum.x) maximum.x = p.x;
+                if (p.y > maximum.y) maximum.y = p.y;
+                if (p.z > maximum.z) maximum.z = p.z;
+            }
+
+            // Area weighted, so slivers barely move the axis
+            Vector3 n = FaceNormal(tri);
+            normalSum.x += n.x;
+            normalSum.y += n.y;
+            normalSum.z += n.z;
+        }
+
+        cluster.center = Vector3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f,
+                                 (minimum.z + maximum.z) * 0.5f);
+        cluster.radius = 0.0f;
+        for (u32 i = 0; i < cluster.triangleCount; i++) {
+            const u32* tri = indices + list[i] * 3;
+            for (int k = 0; k < 3; k++) {
+                const Vector3& p = positions[tri[k]];
+                Vector3 offset(p.x - cluster.center.x, p.y - cluster.center.y, p.z - cluster.center.z);
+                f32 distance = Length(offset);
+                if (distance > cluster.radius) cluster.radius = distance;
+            }
+        }
+
+        // The cone spans the axis and the facing furthest from it. Once
+        // that reaches 90 degrees some triangle faces every viewpoint.
+        cluster.coneAxis = Vector3();
+        cluster.coneCutoff = NO_CONE;
+        f32 length = Length(normalSum);
+        if (orientation == 0 || length <= 0.0f) {
+            return;
+        }
+        Vector3 axis(normalSum.x / length, normalSum.y / length, normalSum.z / length);
+
+        f32 minDot = 1.0f;
+        for (u32 i = 0; i < cluster.triangleCount; i++) {
+            Vector3 n = FaceNormal(indices + list[i] * 3);
+            f32 area = Length(n);
+            if (area <= 0.0f) continue;
+            f32 agreement = (n.x * axis.x + n.y * axis.y + n.z * axis.z) / area;
+            if (agreement < minDot) minDot = agreement;
+        }
+        if (minDot <= 0.0f) {
+            return;
+        }
+
+        f32 sign = static_cast<f32>(orientation);
+        cluster.coneAxis = Vector3(axis.x * sign, axis.y * sign, axis.z * sign);
+        cluster.coneCutoff = sqrtf(1.0f - minDot * minDot);
+    }
+
+    Vector3 FaceNormal(const u32* tri) const {
+        const Vector3& a = positions[tri[0]];
+        const Vector3& b = positions[tri[1]];
+        const Vector3& c = positions[tri[2]];
+        f32 e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+        f32 e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+        return Vector3(e1y * e2z - e1z * e2y, e1z * e2x - e1x * e2z, e1x * e2y - e1y * e2x);
+    }
+};
+
+// Classify a model space sphere against the view frustum
+SphereTest TestSphere(const ClusterView& view, f32 cosX, f32 cosY, const Vector3& center, f32 radius) {
+    const Mtx& m = view.modelView;
+    f32 x = m[0][0] * center.x + m[0][1] * center.y + m[0][2] * center.z + m[0][3];
+    f32 y = m[1][0] * center.x + m[1][1] * center.y + m[1][2] * center.z + m[1][3];
+    f32 depth = -(m[2][0] * center.x + m[2][1] * center.y + m[2][2] * center.z + m[2][3]);
+    f32 r = radius * view.scale;
+
+    // Distances inside each plane: near, far, then the tightest side pair
+    f32 distances[4] = {
+        depth - view.nearPlane,
+        view.farPlane - depth,
+        (depth * view.tanHalfFovX - fabsf(x)) * cosX,
+        (depth * view.tanHalfFovY - fabsf(y)) * cosY
+    };
+
+    SphereTest result = SPHERE_INSIDE;
+    for (int i = 0; i < 4; i++) {
+        if (distances[i] < -r) return SPHERE_OUTSIDE;
+        if (distances[i] < r) result = SPHERE_INTERSECTS;
+    }
+    return result;
+}
+
+// True when the eye is behind every triangle of the cluster, wherever in
+// its bounding sphere they are
+bool IsBackFacing(const ClusterView& view, const MeshCluster& cluster) {
+    if (cluster.coneCutoff > 1.0f) {
+        return false;
+    }
+
+    Vector3 offset(cluster.center.x - view.eye.x, cluster.center.y - view.eye.y, cluster.center.z - view.eye.z);
+    f32 along = offset.x * cluster.coneAxis.x + offset.y * cluster.coneAxis.y + offset.z * cluster.coneAxis.z;
+    return along >= cluster.coneCutoff * Length(offset) + cluster.radius;
+}
+
+} // namespace
+
+bool ClusterCuller::Build(const Vector3* positions, u32* indices, u32 triangleCount, s32 orientation,
+                          Arena& output, Arena& scratch, ClusterSet& result) {
+    result.Clear();
+    if (!positions || !indices || triangleCount == 0) {
+        return false;
+    }
+
+    // Median cuts leave every cluster above MIN_TRIANGLES unless the whole
+    // mesh is smaller
+    u32 maxClusters = triangleCount / MIN_TRIANGLES + 1;
+    u32 maxNodes = maxClusters * 2;
+
+    u32 scratchMarker = scratch.GetMarker();
+    u32* order = static_cast<u32*>(scratch.Allocate(triangleCount * sizeof(u32)));
+    MeshCluster* clusters = static_cast<MeshCluster*>(scratch.Allocate(maxClusters * sizeof(MeshCluster)));
+    ClusterNode* nodes = static_cast<ClusterNode*>(scratch.Allocate(maxNodes * sizeof(ClusterNode)));
+    u32 splitMarker = scratch.GetMarker();
+    f32* keys = static_cast<f32*>(scratch.Allocate(triangleCount * sizeof(f32)));
+    u32* temp = static_cast<u32*>(scratch.Allocate(triangleCount * sizeof(u32)));
+    if (!order || !clusters || !nodes || !keys || !temp) {
+        Log::Print("ERROR: Clustering needs more than %u KB of scratch memory\n", scratch.GetCapacity() / 1024);
+        scratch.ResetToMarker(scratchMarker);
+        return false;
+    }
+
+    for (u32 t = 0; t < triangleCount; t++) {
+        order[t] = t;
+    }
+
+    ClusterSplitter splitter;
+    splitter.positions = positions;
+    splitter.indices = indices;
+    splitter.orientation = orientation;
+    splitter.order = order;
+    splitter.keys = keys;
+    splitter.temp = temp;
+    splitter.clusters = clusters;
+    splitter.clusterCount = 0;
+    splitter.nodes = nodes;
+    splitter.nodeCount = 0;
+    splitter.Split(0, triangleCount);
+
+    // Apply the cluster order to the triangles
+    scratch.ResetToMarker(splitMarker);
+    u32* reordered = static_cast<u32*>(scratch.Allocate(triangleCount * 3 * sizeof(u32)));
+    if (!reordered) {
+        Log::Print("ERROR: Clustering needs more than %u KB of scratch memory\n", scratch.GetCapacity() / 1024);
+        scratch.ResetToMarker(scratchMarker);
+        return false;
+    }
+    for (u32 t = 0; t < triangleCount; t++) {
+        memcpy(reordered + t * 3, indices + order[t] * 3, 3 * sizeof(u32));
+    }
+
+    MeshCluster* clusterOutput = static_cast<MeshCluster*>(
+        output.Allocate(splitter.clusterCount * sizeof(MeshCluster)));
+    ClusterNode* nodeOutput = static_cast<ClusterNode*>(output.Allocate(splitter.nodeCount * sizeof(ClusterNode)));
+    if (!clusterOutput || !nodeOutput) {
+        Log::Print("ERROR: Cluster hierarchy needs %u KB but only %u KB are free\n",
+               (splitter.clusterCount * static_cast<u32>(sizeof(MeshCluster)) +
+                splitter.nodeCount * static_cast<u32>(sizeof(ClusterNode))) / 1024,
+               output.GetRemaining() / 1024);
+        scratch.ResetToMarker(scratchMarker);
+        return false;
+    }
+
+    memcpy(indices, reordered, triangleCount * 3 * sizeof(u32));
+    memcpy(clusterOutput, clusters, splitter.clusterCount * sizeof(MeshCluster));
+    memcpy(nodeOutput, nodes, splitter.nodeCount * sizeof(ClusterNode));
+    scratch.ResetToMarker(scratchMarker);
+
+    result.clusters = clusterOutput;
+    result.clusterCount = splitter.clusterCount;
+    result.nodes = nodeOutput;
+    result.nodeCount = splitter.nodeCount;
+    return true;
+}
+
+u32 ClusterCuller::FindVisible(const ClusterSet& set, const ClusterView& view, u32* visible) {
+    f32 cosX = 1.0f / sqrtf(1.0f + view.tanHalfFovX * view.tanHalfFovX);
+    f32 cosY = 1.0f / sqrtf(1.0f + view.tanHalfFovY * view.tanHalfFovY);
+
+    u32 count = 0;
+    for (u32 i = 0; i < set.nodeCount;) {
+        const ClusterNode& node = set.nodes[i];
+        SphereTest test = TestSphere(view, cosX, cosY, node.center, node.radius);
+        if (test == SPHERE_OUTSIDE) {
+            i = node.skip;
+            continue;
+        }
+
+        // Descend only while the frustum cuts through the node; whole
+        // subtrees inside it need just the facing test
+        if (test == SPHERE_INTERSECTS && node.clusterCount > 1) {
+            i++;
+            continue;
+        }
+
+        for (u32 c = node.firstCluster; c < node.firstCluster + node.clusterCount; c++) {
+            if (!IsBackFacing(view, set.clusters[c])) {
+                visible[count++] = c;
+            }
+        }
+        i = node.skip;
+    }
+    return count;
+}
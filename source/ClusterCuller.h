@@ -0,0 +1,94 @@
+#ifndef CLUSTER_CULLER_H
+#define CLUSTER_CULLER_H
+
+#include "Platform.h"
+#include "Arena.h"
+#include "Vector3.h"
+
+/**
+ * Spatially coherent run of triangles drawn or skipped as a whole
+ */
+struct MeshCluster {
+    Vector3 center;         // Bounding sphere, in model space
+    f32 radius;
+    Vector3 coneAxis;       // Normal cone: every facing lies within the
+    f32 coneCutoff;         // cone; a cutoff above 1 disables the test
+    u32 firstTriangle;
+    u32 triangleCount;
+    u32 firstPrimitive;     // Primitives of the strip set drawing it
+    u32 primitiveCount;
+};
+
+/**
+ * Bounding volume hierarchy node over a contiguous range of clusters.
+ * Nodes are stored depth first; skip is the index of the next node after
+ * this one's subtree, so a culled subtree is passed over in one step.
+ */
+struct ClusterNode {
+    Vector3 center;
+    f32 radius;
+    u32 firstCluster;
+    u32 clusterCount;
+    u32 skip;
+};
+
+/**
+ * Clusters of one triangle list and the hierarchy above them
+ */
+struct ClusterSet {
+    MeshCluster* clusters;
+    u32 clusterCount;
+    ClusterNode* nodes;
+    u32 nodeCount;
+
+    ClusterSet() { Clear(); }
+
+    void Clear() {
+        clusters = nullptr;
+        clusterCount = 0;
+        nodes = nullptr;
+        nodeCount = 0;
+    }
+};
+
+/**
+ * Camera state for culling. modelView and scale map model space into view
+ * space; eye is the camera position in model space.
+ */
+struct ClusterView {
+    Mtx modelView;
+    f32 scale;
+    Vector3 eye;
+    f32 tanHalfFovX;
+    f32 tanHalfFovY;
+    f32 nearPlane;
+    f32 farPlane;
+};
+
+/**
+ * Splits a triangle list into clusters of MIN_TRIANGLES to MAX_TRIANGLES
+ * by recursive median cuts along the longest axis of the triangle
+ * centroids. Each cut becomes a hierarchy node. Clusters are tested against
+ * the view frustum and, for closed meshes, their normal cones.
+ */
+class ClusterCuller {
+public:
+    static const u32 MIN_TRIANGLES = 128;
+    static const u32 MAX_TRIANGLES = 256;
+
+    // Reorder the triangles of indices so each cluster is contiguous,
+    // keeping their relative order (and so the vertex cache order) within
+    // a cluster. orientation is +1 for a closed mesh wound outwards, -1 for
+    // one wound inwards and 0 for an open mesh, whose clusters are never
+    // treated as back-facing. Clusters and nodes come from output;
+    // temporary tables from scratch. Primitive ranges are left for the
+    // caller to fill in.
+    static bool Build(const Vector3* positions, u32* indices, u32 triangleCount, s32 orientation,
+                      Arena& output, Arena& scratch, ClusterSet& result);
+
+    // Write the indices of the clusters that may be visible into visible
+    // (room for clusterCount entries) and return how many there are
+    static u32 FindVisible(const ClusterSet& set, const ClusterView& view, u32* visible);
+};
+
+#endif // CLUSTER_CULLER_H
@@ -0,0 +1,143 @@
+#include "ColorScheme.h"
+#include "MemorySystem.h"
+#include <cstdio>
+#include <cmath>
+
+static OrangeColorScheme orangeScheme;
+static HeightColorScheme heightScheme;
+static CurvatureColorScheme curvatureScheme;
+
+static ColorScheme* const schemes[] = { &orangeScheme, &heightScheme, &curvatureScheme };
+
+int ColorScheme::GetSchemeCount() {
+    return static_cast<int>(sizeof(schemes) / sizeof(schemes[0]));
+}
+
+ColorScheme* ColorScheme::GetScheme(int index) {
+    return (index >= 0 && index < GetSchemeCount()) ? schemes[index] : nullptr;
+}
+
+bool ColorScheme::BakeFaceColors(const Mesh& mesh, ColorScheme& scheme, u32* colors) {
+    int triangleCount = mesh.GetTriangleCount();
+    if (!mesh.IsValid() || !colors) {
+        return false;
+    }
+
+    // Curvature lives on welded vertices; faces average their corners.
+    // Without a weld (or the scratch to compute it) faces count as flat.
+    Arena& scratch = MemorySystem::GetScratchArena();
+    u32 scratchMarker = scratch.GetMarker();
+    f32* curvature = nullptr;
+    if (mesh.IsIndexed()) {
+        curvature = static_cast<f32*>(scratch.Allocate(mesh.GetVertexCount() * sizeof(f32)));
+        if (curvature && !mesh.ComputeVertexCurvature(curvature)) {
+            curvature = nullptr;
+        }
+    }
+
+    scheme.Prepare(mesh);
+
+    ColorSample sample;
+    for (int i = 0; i < triangleCount; i++) {
+        const Vector3& a = mesh.GetCorner(i, 0);
+        const Vector3& b = mesh.GetCorner(i, 1);
+        const Vector3& c = mesh.GetCorner(i, 2);
+        sample.position = Vector3((a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f);
+        sample.normal = mesh.GetFaceNormal(i);
+        sample.curvature = curvature ? (curvature[mesh.GetIndex(i * 3)] + curvature[mesh.GetIndex(i * 3 + 1)] +
+                                        curvature[mesh.GetIndex(i * 3 + 2)]) / 3.0f
+                                     : 0.0f;
+        colors[i] = scheme.Evaluate(sample);
+    }
+
+    scratch.ResetToMarker(scratchMarker);
+    return true;
+}
+
+bool ColorScheme::BakeVertexColors(const Mesh& mesh, ColorScheme& scheme, u32* colors) {
+    const Vector3* positions = mesh.GetRenderPositions();
+    const Vector3* normals = mesh.GetRenderNormals();
+    const u8* curvatures = mesh.GetRenderCurvatures();
+    if (!positions || !colors) {
+        return false;
+    }
+
+    scheme.Prepare(mesh);
+
+    ColorSample sample;
+    for (int i = 0; i < mesh.GetRenderVertexCount(); i++) {
+        sample.position = positions[i];
+        sample.normal = normals[i];
+        sample.curvature = curvatures[i] / 255.0f;
+        colors[i] = scheme.Evaluate(sample);
+    }
+    return true;
+}
+
+u32 OrangeColorScheme::Evaluate(const ColorSample& sample) const {
+    // Use material colors for different surface orientations to add variety
+    f32 normalY = sample.normal.y;
+    f32 normalVariation = fabsf(sample.normal.x + sample.normal.z) * 0.3f;
+
+    // Base bitcoin orange with subtle variations based on normal direction
+    if (normalY > 0.3f) {
+        // Top-facing surfaces - brighter, more golden
+        return PackColor(static_cast<u8>(240 + normalVariation * 15),
+                         static_cast<u8>(160 + normalVariation * 20),
+                         static_cast<u8>(20 + normalVariation * 10));
+    } else if (normalY < -0.3f) {
+        // Bottom-facing surfaces - darker, more reddish
+        return PackColor(static_cast<u8>(180 + normalVariation * 15),
+                         static_cast<u8>(80 + normalVariation * 15),
+                         static_cast<u8>(10 + normalVariation * 5));
+    }
+
+    // Side-facing surfaces - standard bitcoin orange
+    return PackColor(static_cast<u8>(220 + normalVariation * 15),
+                     static_cast<u8>(140 + normalVariation * 15),
+                     static_cast<u8>(15 + normalVariation * 10));
+}
+
+void HeightColorScheme::Prepare(const Mesh& mesh) {
+    minHeight = mesh.GetMinBounds().y;
+    f32 range = mesh.GetMaxBounds().y - minHeight;
+    invRange = range > 0.0f ? 1.0f / range : 0.0f;
+}
+
+u32 HeightColorScheme::Evaluate(const ColorSample& sample) const {
+    f32 t = (sample.position.y - minHeight) * invRange;
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+
+    // Blue -> cyan -> green -> yellow -> red in four equal steps
+    static const u8 stops[5][3] = {
+        { 40, 80, 220 }, { 40, 200, 220 }, { 60, 200, 60 }, { 240, 220, 40 }, { 230, 60, 30 }
+    };
+    f32 scaled = t * 4.0f;
+    int stop = static_cast<int>(scaled);
+    if (stop > 3) stop = 3;
+    f32 f = scaled - static_cast<f32>(stop);
+
+    const u8* a = stops[stop];
+    const u8* b = stops[stop + 1];
+    return PackColor(static_cast<u8>(a[0] + (b[0] - a[0]) * f),
+                     static_cast<u8>(a[1] + (b[1] - a[1]) * f),
+                     static_cast<u8>(a[2] + (b[2] - a[2]) * f));
+}
+
+u32 CurvatureColorScheme::Evaluate(const ColorSample& sample) const {
+    // Most surfaces bend only a few degrees per vertex, so stretch the
+    // low end of the range
+    f32 t = sqrtf(sample.curvature);
+    if (t > 1.0f) t = 1.0f;
+
+    if (t < 0.5f) {
+        f32 f = t * 2.0f;
+        return PackColor(static_cast<u8>(150 + 90 * f), static_cast<u8>(150 - 10 * f),
+                         static_cast<u8>(150 - 135 * f));
+    }
+
+    f32 f = (t - 0.5f) * 2.0f;
+    return PackColor(static_cast<u8>(240 - 20 * f), static_cast<u8>(140 - 110 * f),
+                     static_cast<u8>(15 + 15 * f));
+}
@@ -0,0 +1,81 @@
+#ifndef COLOR_SCHEME_H
+#define COLOR_SCHEME_H
+
+#include "Platform.h"
+#include "Mesh.h"
+
+/**
+ * Surface attributes a color scheme may use for one face or vertex
+ */
+struct ColorSample {
+    Vector3 position;
+    Vector3 normal;
+    f32 curvature;      // 0 flat to 1 sharply curved, see Mesh::ComputeVertexCurvature
+};
+
+/**
+ * Policy mapping surface attributes to a material color. Colors are baked
+ * once per mesh into packed 0xRRGGBBAA arrays; schemes never run per frame.
+ */
+class ColorScheme {
+public:
+    virtual ~ColorScheme() {}
+
+    virtual const char* GetName() const = 0;
+
+    // Called once per bake, before any Evaluate, with the mesh being colored
+    virtual void Prepare(const Mesh& mesh) { (void)mesh; }
+
+    virtual u32 Evaluate(const ColorSample& sample) const = 0;
+
+    static u32 PackColor(u8 r, u8 g, u8 b, u8 a = 255) {
+        return (static_cast<u32>(r) << 24) | (static_cast<u32>(g) << 16) |
+               (static_cast<u32>(b) << 8) | a;
+    }
+
+    // Built-in schemes, in the order the viewer cycles through them
+    static int GetSchemeCount();
+    static ColorScheme* GetScheme(int index);
+
+    // One color per facet of the mesh, or per render vertex
+    static bool BakeFaceColors(const Mesh& mesh, ColorScheme& scheme, u32* colors);
+    static bool BakeVertexColors(const Mesh& mesh, ColorScheme& scheme, u32* colors);
+};
+
+/**
+ * The original look: bitcoin orange, brighter on top-facing surfaces and
+ * darker underneath
+ */
+class OrangeColorScheme : public ColorScheme {
+public:
+    const char* GetName() const { return "Bitcoin orange"; }
+    u32 Evaluate(const ColorSample& sample) const;
+};
+
+/**
+ * Blue-to-red ramp along the model's vertical (Y) extent
+ */
+class HeightColorScheme : public ColorScheme {
+public:
+    HeightColorScheme() : minHeight(0.0f), invRange(0.0f) {}
+
+    const char* GetName() const { return "Height"; }
+    void Prepare(const Mesh& mesh);
+    u32 Evaluate(const ColorSample& sample) const;
+
+private:
+    f32 minHeight;
+    f32 invRange;
+};
+
+/**
+ * Neutral grey on flat regions shading to orange and red where the
+ * surface bends
+ */
+class CurvatureColorScheme : public ColorScheme {
+public:
+    const char* GetName() const { return "Curvature"; }
+    u32 Evaluate(const ColorSample& sample) const;
+};
+
+#endif // COLOR_SCHEME_H
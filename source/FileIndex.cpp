@@ -0,0 +1,127 @@
+#include "FileIndex.h"
+#include <cstdio>
+#include <cstring>
+
+bool FileIndex::Load(const std::string& path, std::vector<FileEntry>& entries) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    // The header must describe the file exactly, so a corrupt count is
+    // caught before anything is allocated for it
+    FileIndexHeader header;
+    if (fread(&header, 1, sizeof(header), file) != sizeof(header) ||
+        header.magic != MAGIC || header.version != VERSION ||
+        header.entryCount > MAX_ENTRIES || header.stringBytes > MAX_ENTRIES * 0xffffu ||
+        fileSize < 0 ||
+        static_cast<u64>(fileSize) != sizeof(header) + static_cast<u64>(header.entryCount) * sizeof(FileIndexRecord) +
+                                          header.stringBytes) {
+        printf("Ignoring invalid file index: %s\n", path.c_str());
+        fclose(file);
+        return false;
+    }
+
+    // Read in two blocks; a file shrinking under us is rebuilt rather than trusted
+    std::vector<FileIndexRecord> records(header.entryCount);
+    std::vector<char> strings(header.stringBytes);
+    bool success = (header.entryCount == 0 ||
+                    fread(records.data(), sizeof(FileIndexRecord), header.entryCount, file) == header.entryCount) &&
+                   (header.stringBytes == 0 ||
+                    fread(strings.data(), 1, header.stringBytes, file) == header.stringBytes);
+    fclose(file);
+    if (!success) {
+        printf("Ignoring truncated file index: %s\n", path.c_str());
+        return false;
+    }
+
+    entries.clear();
+    entries.reserve(header.entryCount);
+    for (const FileIndexRecord& record : records) {
+        if (record.pathOffset > header.stringBytes || record.pathLength > header.stringBytes - record.pathOffset ||
+            record.nameStart >= record.pathLength) {
+            printf("Ignoring invalid file index: %s\n", path.c_str());
+            entries.clear();
+            return false;
+        }
+
+        std::string entryPath(strings.data() + record.pathOffset, record.pathLength);
+        FileEntry entry(entryPath.substr(record.nameStart), entryPath, record.size, record.modifiedTime);
+        entry.flags = record.flags;
+        entry.triangleCount = record.triangleCount;
+        entry.memoryBytes = record.memoryBytes;
+        entry.contentHash = record.contentHash;
+        entry.minBounds = record.minBounds;
+        entry.maxBounds = record.maxBounds;
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+bool FileIndex::Save(const std::string& path, const std::vector<FileEntry>& entries) {
+    if (entries.size() > MAX_ENTRIES) {
+        printf("ERROR: Too many files to index (max %u)\n", MAX_ENTRIES);
+        return false;
+    }
+
+    std::vector<FileIndexRecord> records;
+    std::string strings;
+    records.reserve(entries.size());
+    for (const FileEntry& entry : entries) {
+        size_t nameStart = entry.path.length() - entry.name.length();
+        if (entry.path.length() > 0xffff || entry.name.empty() ||
+            entry.path.compare(nameStart, std::string::npos, entry.name) != 0) {
+            continue; // Not representable; found again by the next scan
+        }
+
+        FileIndexRecord record = FileIndexRecord();
+        record.pathOffset = static_cast<u32>(strings.length());
+        record.pathLength = static_cast<u16>(entry.path.length());
+        record.nameStart = static_cast<u16>(nameStart);
+        record.size = static_cast<u32>(entry.size);
+        record.modifiedTime = entry.modifiedTime;
+        record.flags = entry.flags;
+        record.triangleCount = entry.triangleCount;
+        record.memoryBytes = entry.memoryBytes;
+        record.contentHash = entry.contentHash;
+        record.minBounds = entry.minBounds;
+        record.maxBounds = entry.maxBounds;
+        records.push_back(record);
+        strings += entry.path;
+    }
+
+    FileIndexHeader header = FileIndexHeader();
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.entryCount = static_cast<u32>(records.size());
+    header.stringBytes = static_cast<u32>(strings.length());
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        printf("Cannot write file index: %s\n", path.c_str());
+        return false;
+    }
+
+    bool success = fwrite(&header, 1, sizeof(header), file) == sizeof(header) &&
+                   (records.empty() ||
+                    fwrite(records.data(), sizeof(FileIndexRecord), records.size(), file) == records.size()) &&
+                   (strings.empty() || fwrite(strings.data(), 1, strings.length(), file) == strings.length());
+
+    if (fclose(file) != 0) {
+        success = false;
+    }
+
+    if (!success) {
+        printf("ERROR: Failed to write file index: %s\n", path.c_str());
+        remove(path.c_str());
+        return false;
+    }
+
+    printf("Wrote file index: %u file(s), %u bytes\n", header.entryCount,
+           static_cast<u32>(sizeof(header) + records.size() * sizeof(FileIndexRecord) + strings.length()));
+    return true;
+}
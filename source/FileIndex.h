@@ -0,0 +1,60 @@
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+#include "Platform.h"
+#include <string>
+#include <vector>
+#include "FileManager.h"
+
+/**
+ * On-disk header of the file index. The records follow, then the string
+ * table their paths point into.
+ */
+struct FileIndexHeader {
+    u32 magic;
+    u32 version;
+    u32 entryCount;
+    u32 stringBytes;
+    u32 reserved[4];
+};
+
+static_assert(sizeof(FileIndexHeader) == 32, "FileIndexHeader must stay 32 bytes");
+
+/**
+ * One file of the index. The name shown in the menu is the end of the
+ * path, from nameStart on.
+ */
+struct FileIndexRecord {
+    u32 pathOffset;
+    u16 pathLength;
+    u16 nameStart;
+    u32 size;
+    u32 modifiedTime;
+    u32 flags;
+    u32 triangleCount;
+    u32 memoryBytes;
+    u32 contentHash;
+    Vector3 minBounds;
+    Vector3 maxBounds;
+    u32 reserved[2];
+};
+
+static_assert(sizeof(FileIndexRecord) == 64, "FileIndexRecord must stay 64 bytes");
+
+/**
+ * Persistent list of the STL files on the media with what is known about
+ * each, so startup reads one small file instead of walking every folder.
+ * Native-endian, like the mesh cache; a file of another version is
+ * ignored and rebuilt by a scan.
+ */
+class FileIndex {
+public:
+    static bool Load(const std::string& path, std::vector<FileEntry>& entries);
+    static bool Save(const std::string& path, const std::vector<FileEntry>& entries);
+
+    static const u32 MAGIC = 0x47434931; // 'GCI1'
+    static const u32 VERSION = 1;
+    static const u32 MAX_ENTRIES = 65536;
+};
+
+#endif // FILE_INDEX_H
@@ -1,5 +1,9 @@
 #include "FileManager.h"
+#include "FileIndex.h"
+#include "Mesh.h"
+#ifndef HOST_BUILD
 #include <fat.h>
+#endif
 #include <dirent.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -7,50 +11,147 @@
 #include <cstring>
 #include <algorithm>
 
-FileManager::FileManager() : filesystemInitialized(false) {
+const char* const FileManager::INDEX_FILE_NAME = "stlviewer.idx";
+
+// Mesh arena use per triangle after loading, welding and render
+// preprocessing, as measured on bitcoin.stl and generated spheres with the
+// host benchmark; used until a file has been loaded once
+static const u32 ESTIMATED_BYTES_PER_TRIANGLE = 104;
+
+// Bytes from the end of a file that go into its content hash with the header
+static const u32 HASH_TAIL_BYTES = 256;
+
+static u32 HashBytes(u32 hash, const u8* data, u32 length) {
+    // FNV-1a
+    for (u32 i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+u32 FileEntry::GetMemoryBytes() const {
+    if (flags & FILE_INFO_LOADED) {
+        return memoryBytes;
+    }
+    return triangleCount * ESTIMATED_BYTES_PER_TRIANGLE;
+}
+
+FileManager::FileManager() : filesystemInitialized(false), walking(false), probeCursor(0),
+                             indexLoaded(false), indexDirty(false) {
+    scanRoots.push_back("sd:/");
+    scanRoots.push_back("usb:/");
 }
 
 FileManager::~FileManager() {
 }
 
 bool FileManager::Initialize() {
-    if (fatInitDefault()) {
-        filesystemInitialized = true;
-        printf("Filesystem initialized successfully\n");
-        ScanForSTLFiles();
-        return true;
-    } else {
+#ifdef HOST_BUILD
+    // Host builds read the native filesystem directly
+    bool mounted = true;
+#else
+    bool mounted = fatInitDefault();
+#endif
+    if (!mounted) {
         printf("Filesystem initialization failed\n");
         return false;
     }
+
+    filesystemInitialized = true;
+    printf("Filesystem initialized successfully\n");
+
+    // Show the indexed list now and recheck the media during idle frames;
+    // without an index, scan before the menu comes up
+    indexPath = scanRoots.empty() ? "" : scanRoots[0] + INDEX_FILE_NAME;
+    u64 startTime = gettime();
+    if (!indexPath.empty() && FileIndex::Load(indexPath, files)) {
+        indexLoaded = true;
+        RebuildFileIndices();
+        printf("Loaded file index: %d file(s) in %.1f ms\n", GetFileCount(),
+               diff_usec(startTime, gettime()) / 1000.0f);
+        BeginWalk();
+    } else {
+        ScanForSTLFiles();
+    }
+    return true;
 }
 
 void FileManager::ScanForSTLFiles() {
     files.clear();
+    fileIndices.clear();
 
     if (!filesystemInitialized) {
         printf("Filesystem not initialized, cannot scan for files\n");
         return;
     }
 
-    // Scan SD card root
-    ScanDirectory("sd:/");
+    // The whole walk at once; headers are probed later by UpdateIndex
+    BeginWalk();
+    u64 startTime = gettime();
+    while (walking) {
+        WalkStep();
+    }
+    scanStats.micros += diff_usec(startTime, gettime());
+    printf("Found %d STL file(s) in %u folder(s), %u entries in %.1f ms (%.0f entries/s)\n",
+           GetFileCount(), scanStats.directories, scanStats.entries,
+           scanStats.micros / 1000.0f, scanStats.GetEntriesPerSecond());
+}
+
+bool FileManager::UpdateIndex(u32 budgetMicros) {
+    if (!filesystemInitialized || IsIndexUpToDate()) {
+        return false;
+    }
 
-    // Scan USB root
-    ScanDirectory("usb:/");
+    bool redraw = false;
+    u64 startTime = gettime();
+    do {
+        if (walking) {
+            redraw = WalkStep() || redraw;
+        } else {
+            FileEntry& entry = files[probeCursor++];
+            if (!(entry.flags & FILE_INFO_PROBED)) {
+                ProbeFile(entry);
+            }
+        }
+    } while (!IsIndexUpToDate() && diff_usec(startTime, gettime()) < budgetMicros);
+    scanStats.micros += diff_usec(startTime, gettime());
 
-    // Check current directory for bitcoin.stl (fallback)
-    if (FileExists("bitcoin.stl")) {
-        AddFile("bitcoin.stl", "bitcoin.stl");
+    if (IsIndexUpToDate()) {
+        printf("File index up to date: %d file(s), %u folder(s), %u probed in %.1f ms\n",
+               GetFileCount(), scanStats.directories, scanStats.probes, scanStats.micros / 1000.0f);
+        removedFiles.clear();
+        SaveIndex();
+        redraw = true;
+    }
+    return redraw;
+}
+
+void FileManager::RecordLoadedModel(const std::string& path, const Mesh& mesh, u32 memoryBytes) {
+    int index = FindFile(path);
+    if (index < 0) {
+        return;
     }
 
-    printf("Found %d STL file(s)\n", static_cast<int>(files.size()));
+    FileEntry& entry = files[index];
+    entry.triangleCount = static_cast<u32>(mesh.GetTriangleCount());
+    entry.minBounds = mesh.GetMinBounds();
+    entry.maxBounds = mesh.GetMaxBounds();
+    entry.memoryBytes = memoryBytes;
+    entry.flags |= FILE_INFO_LOADED;
+    indexDirty = true;
+}
 
-    // Sort files alphabetically
-    std::sort(files.begin(), files.end(),
-              [](const FileEntry& a, const FileEntry& b) {
-                  return a.name < b.name;
-              });
+bool FileManager::SaveIndex() {
+    // Mid-walk the list is about to change anyway
+    if (!indexDirty || walking || indexPath.empty() || !filesystemInitialized) {
+        return !indexDirty;
+    }
+
+    if (!FileIndex::Save(indexPath, files)) {
+        return false;
+    }
+    indexDirty = false;
+    return true;
 }
 
 void FileManager::RefreshFileList() {
@@ -64,24 +165,22 @@ const FileEntry* FileManager::GetFile(int index) const {
     return nullptr;
 }
 
+int FileManager::FindFile(const std::string& path) const {
+    auto it = fileIndices.find(path);
+    return it != fileIndices.end() ? static_cast<int>(it->second) : -1;
+}
+
 bool FileManager::IsValidSTLFile(const std::string& filepath) const {
     if (!IsSTLExtension(filepath)) {
         return false;
     }
 
-    FILE* file = fopen(filepath.c_str(), "rb");
-    if (!file) {
+    // Basic validation - check if file has reasonable size
+    struct stat statbuf;
+    if (stat(filepath.c_str(), &statbuf) != 0 || !S_ISREG(statbuf.st_mode)) {
         return false;
     }
-
-    // Basic validation - check if file has reasonable size
-    fseek(file, 0, SEEK_END);
-    long fileSize = ftell(file);
-    fclose(file);
-
-    // STL files should be at least 84 bytes (80 header + 4 count)
-    // and not unreasonably large
-    return (fileSize >= 84 && fileSize <= 100 * 1024 * 1024); // Max 100MB
+    return IsValidSTLSize(statbuf.st_size);
 }
 
 long FileManager::GetFileSize(const std::string& filepath) const {
@@ -107,46 +206,220 @@ bool FileManager::FileExists(const std::string& filepath) const {
     return (access(filepath.c_str(), F_OK) == 0);
 }
 
-void FileManager::ScanDirectory(const std::string& path) {
-    DIR* dir = opendir(path.c_str());
+void FileManager::BeginWalk() {
+    pendingDirectories.clear();
+    for (size_t i = scanRoots.size(); i > 0; i--) {
+        PendingDirectory root = { scanRoots[i - 1], "", 0 };
+        pendingDirectories.push_back(root);
+    }
+    seenPaths.clear();
+    foundFiles.clear();
+    removedFiles.clear();
+    scanStats = ScanStats();
+    walking = true;
+    probeCursor = 0;
+}
+
+bool FileManager::WalkStep() {
+    if (pendingDirectories.empty()) {
+        return FinishWalk();
+    }
+
+    PendingDirectory directory = pendingDirectories.back();
+    pendingDirectories.pop_back();
+    ScanDirectory(directory);
+    return false;
+}
+
+bool FileManager::FinishWalk() {
+    // Check current directory for bitcoin.stl (fallback)
+    struct stat statbuf;
+    scanStats.statCalls++;
+    if (stat("bitcoin.stl", &statbuf) == 0 && S_ISREG(statbuf.st_mode)) {
+        VisitFile("bitcoin.stl", "bitcoin.stl", statbuf.st_size, static_cast<u32>(statbuf.st_mtime));
+    }
+
+    // Files not seen again are gone; new ones join the list
+    bool changed = !foundFiles.empty();
+    std::vector<FileEntry> kept;
+    kept.reserve(files.size() + foundFiles.size());
+    for (FileEntry& entry : files) {
+        if (seenPaths.count(entry.path)) {
+            kept.push_back(entry);
+        } else {
+            removedFiles.push_back(entry);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        kept.insert(kept.end(), foundFiles.begin(), foundFiles.end());
+        files.swap(kept);
+
+        // Sort files alphabetically; names include their folder, so files
+        // in the same folder stay together
+        std::sort(files.begin(), files.end(),
+                  [](const FileEntry& a, const FileEntry& b) {
+                      return a.name < b.name;
+                  });
+        RebuildFileIndices();
+        indexDirty = true;
+    }
+
+    foundFiles.clear();
+    seenPaths.clear();
+    walking = false;
+    probeCursor = 0;
+
+    if (scanStats.skippedDepth > 0) {
+        printf("  %u folder(s) deeper than %d levels not scanned\n", scanStats.skippedDepth, MAX_SCAN_DEPTH);
+    }
+    return changed;
+}
+
+void FileManager::ScanDirectory(const PendingDirectory& directory) {
+    DIR* dir = opendir(directory.path.c_str());
     if (!dir) {
         return; // Directory doesn't exist or can't be opened
     }
+    scanStats.directories++;
 
     struct dirent* entry;
     while ((entry = readdir(dir)) != nullptr) {
         std::string filename = entry->d_name;
+        scanStats.entries++;
 
         // Skip hidden files and directories
         if (filename[0] == '.') {
             continue;
         }
 
-        if (IsSTLExtension(filename)) {
-            std::string fullPath = path + filename;
-            if (IsValidSTLFile(fullPath)) {
-                AddFile(filename, fullPath);
+        bool stlName = IsSTLExtension(filename);
+        bool isDirectory = false;
+        bool known = false;
+#ifdef DT_DIR
+        // Where the entry type comes with the name, other files and folders
+        // need no stat at all
+        if (entry->d_type != DT_UNKNOWN) {
+            isDirectory = (entry->d_type == DT_DIR);
+            known = true;
+            if (!isDirectory && !stlName) {
+                continue;
             }
         }
+#endif
+
+        // The one stat of this entry: its type if the name did not say, and
+        // an STL file's size and modification time
+        std::string fullPath = directory.path + filename;
+        struct stat statbuf;
+        if (!known || stlName) {
+            scanStats.statCalls++;
+            if (stat(fullPath.c_str(), &statbuf) != 0) {
+                continue;
+            }
+            isDirectory = S_ISDIR(statbuf.st_mode);
+        }
+
+        if (isDirectory) {
+            if (directory.depth < MAX_SCAN_DEPTH) {
+                PendingDirectory child = { fullPath + "/", directory.relativePath + filename + "/",
+                                           directory.depth + 1 };
+                pendingDirectories.push_back(child);
+            } else {
+                scanStats.skippedDepth++;
+            }
+        } else if (stlName && IsValidSTLSize(statbuf.st_size)) {
+            VisitFile(directory.relativePath + filename, fullPath, statbuf.st_size,
+                      static_cast<u32>(statbuf.st_mtime));
+        }
     }
 
     closedir(dir);
 }
 
-bool FileManager::IsSTLExtension(const std::string& filename) const {
-    std::string ext = GetFileExtension(filename);
-    return (ext == "stl");
+void FileManager::VisitFile(const std::string& name, const std::string& path, long size, u32 modifiedTime) {
+    // The same file reached twice, such as a root listed twice, is kept once
+    if (!seenPaths.insert(path).second) {
+        return;
+    }
+
+    auto it = fileIndices.find(path);
+    if (it == fileIndices.end()) {
+        foundFiles.push_back(FileEntry(name, path, size, modifiedTime));
+        return;
+    }
+
+    // A changed file keeps its place in the list but is probed again
+    FileEntry& entry = files[it->second];
+    if (entry.size != size || entry.modifiedTime != modifiedTime) {
+        entry.size = size;
+        entry.modifiedTime = modifiedTime;
+        entry.ClearInfo();
+        indexDirty = true;
+    }
 }
 
-void FileManager::AddFile(const std::string& name, const std::string& path) {
-    // Check if file already exists in list
-    for (const auto& file : files) {
-        if (file.path == path) {
-            return; // Already added
+void FileManager::ProbeFile(FileEntry& entry) {
+    scanStats.probes++;
+    entry.flags |= FILE_INFO_PROBED;
+    indexDirty = true;
+
+    FILE* file = fopen(entry.path.c_str(), "rb");
+    if (!file) {
+        return;
+    }
+
+    // The header, then the file's last bytes; a binary STL's triangle
+    // count is in the header and must account for the whole file
+    u8 header[84];
+    u8 tail[HASH_TAIL_BYTES];
+    u32 tailLength = 0;
+    bool success = fread(header, 1, sizeof(header), file) == sizeof(header);
+    if (success && entry.size > static_cast<long>(sizeof(header))) {
+        long remaining = entry.size - static_cast<long>(sizeof(header));
+        tailLength = remaining < static_cast<long>(HASH_TAIL_BYTES) ? static_cast<u32>(remaining) : HASH_TAIL_BYTES;
+        success = fseek(file, -static_cast<long>(tailLength), SEEK_END) == 0 &&
+                  fread(tail, 1, tailLength, file) == tailLength;
+    }
+    fclose(file);
+    if (!success) {
+        return;
+    }
+
+    u32 size = static_cast<u32>(entry.size);
+    u32 hash = HashBytes(2166136261u, header, sizeof(header));
+    hash = HashBytes(hash, tail, tailLength);
+    entry.contentHash = HashBytes(hash, reinterpret_cast<const u8*>(&size), sizeof(size));
+
+    u32 count = header[80] | (header[81] << 8) | (header[82] << 16) | (static_cast<u32>(header[83]) << 24);
+    if (84 + static_cast<u64>(count) * 50 == static_cast<u64>(entry.size)) {
+        entry.flags |= FILE_INFO_BINARY;
+        entry.triangleCount = count;
+    }
+
+    // A file that moved or was renamed keeps what its last load measured
+    for (const FileEntry& removed : removedFiles) {
+        if ((removed.flags & FILE_INFO_LOADED) && removed.size == entry.size &&
+            removed.contentHash == entry.contentHash) {
+            entry.triangleCount = removed.triangleCount;
+            entry.memoryBytes = removed.memoryBytes;
+            entry.minBounds = removed.minBounds;
+            entry.maxBounds = removed.maxBounds;
+            entry.flags |= FILE_INFO_LOADED;
+            break;
         }
     }
+}
+
+void FileManager::RebuildFileIndices() {
+    fileIndices.clear();
+    for (size_t i = 0; i < files.size(); i++) {
+        fileIndices[files[i].path] = static_cast<u32>(i);
+    }
+}
 
-    long size = GetFileSize(path);
-    files.emplace_back(name, path, size);
-    printf("  Found: %s (%ld bytes)\n", name.c_str(), size);
+bool FileManager::IsSTLExtension(const std::string& filename) const {
+    std::string ext = GetFileExtension(filename);
+    return (ext == "stl");
 }
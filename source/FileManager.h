@@ -3,6 +3,21 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "Platform.h"
+#include "Vector3.h"
+
+class Mesh;
+
+/**
+ * What is known about a file beyond its size and modification time
+ */
+enum FileInfoFlags {
+    FILE_INFO_PROBED = 1 << 0,  // Header read: format, binary triangle count, content hash
+    FILE_INFO_BINARY = 1 << 1,
+    FILE_INFO_LOADED = 1 << 2   // Loaded once: triangle count, bounds and memory use are exact
+};
 
 /**
  * Structure to hold file information
@@ -11,28 +26,99 @@ struct FileEntry {
     std::string name;
     std::string path;
     long size;
+    u32 modifiedTime;
+
+    u32 flags;              // FileInfoFlags
+    u32 triangleCount;      // 0 while unknown (ASCII files until loaded)
+    u32 memoryBytes;        // Mesh arena use after the last load, 0 if never loaded
+    u32 contentHash;        // Of the header, the last bytes and the size
+    Vector3 minBounds;      // Valid once loaded
+    Vector3 maxBounds;
+
+    FileEntry() : size(0), modifiedTime(0) { ClearInfo(); }
+    FileEntry(const std::string& n, const std::string& p, long s = 0, u32 mtime = 0)
+        : name(n), path(p), size(s), modifiedTime(mtime) { ClearInfo(); }
+
+    void ClearInfo() {
+        flags = 0;
+        triangleCount = 0;
+        memoryBytes = 0;
+        contentHash = 0;
+        minBounds = Vector3();
+        maxBounds = Vector3();
+    }
+
+    // Measured if loaded before, otherwise estimated from the triangle
+    // count; 0 if that is unknown too
+    u32 GetMemoryBytes() const;
+};
+
+/**
+ * Counters of the last scan
+ */
+struct ScanStats {
+    u32 directories;    // Opened, roots included
+    u32 entries;        // Directory entries read
+    u32 statCalls;      // At most one per entry
+    u32 skippedDepth;   // Directories below MAX_SCAN_DEPTH left unread
+    u32 probes;         // Files whose header was read
+    u32 micros;         // Spent walking and probing, over however many steps
+
+    ScanStats() : directories(0), entries(0), statCalls(0), skippedDepth(0), probes(0), micros(0) {}
 
-    FileEntry() : size(0) {}
-    FileEntry(const std::string& n, const std::string& p, long s = 0)
-        : name(n), path(p), size(s) {}
+    f32 GetEntriesPerSecond() const { return micros > 0 ? entries / (micros / 1000000.0f) : 0.0f; }
 };
 
 /**
- * File management class for handling STL file discovery and validation
+ * File management class for handling STL file discovery and validation.
+ * Scans walk each root and its subfolders once, up to MAX_SCAN_DEPTH
+ * levels down, and stat each entry at most once; names are paths relative
+ * to the root.
+ *
+ * The file list and what is known about each file are kept in a
+ * FileIndex on the first root. When it can be read at startup the menu
+ * shows it straight away, and UpdateIndex rechecks the media a folder at
+ * a time in idle menu frames: unchanged files cost a stat, new and changed
+ * ones have their header probed, and the list is only reordered once the
+ * walk is done.
  */
 class FileManager {
 public:
+    static const int MAX_SCAN_DEPTH = 4;
+    static const long MIN_STL_SIZE = 84;                   // 80 byte header and triangle count
+    static const long MAX_STL_SIZE = 100 * 1024 * 1024;
+    static const char* const INDEX_FILE_NAME;
+
     FileManager();
     ~FileManager();
 
+    // Mount the media and read the index, or scan if there is none
     bool Initialize();
     void ScanForSTLFiles();
     void RefreshFileList();
 
+    // Directories scanned, each ending in '/'; sd:/ and usb:/ by default
+    void SetScanRoots(const std::vector<std::string>& roots) { scanRoots = roots; }
+    const ScanStats& GetScanStats() const { return scanStats; }
+
+    // Recheck the media and probe new files for up to budgetMicros. True
+    // when the menu should be redrawn: the list changed, or the index
+    // just became up to date.
+    bool UpdateIndex(u32 budgetMicros);
+    bool IsIndexUpToDate() const { return !walking && probeCursor >= files.size(); }
+    bool WasIndexLoaded() const { return indexLoaded; }
+
+    // Record what loading a file revealed
+    void RecordLoadedModel(const std::string& path, const Mesh& mesh, u32 memoryBytes);
+
+    // Write the index if anything in it changed
+    bool SaveIndex();
+
     // File access
     const std::vector<FileEntry>& GetFiles() const { return files; }
     int GetFileCount() const { return static_cast<int>(files.size()); }
     const FileEntry* GetFile(int index) const;
+    int FindFile(const std::string& path) const;
 
     // File validation
     bool IsValidSTLFile(const std::string& filepath) const;
@@ -43,12 +129,44 @@ public:
     bool FileExists(const std::string& filepath) const;
 
 private:
+    /**
+     * Folder waiting to be read by the walk in progress
+     */
+    struct PendingDirectory {
+        std::string path;
+        std::string relativePath;
+        int depth;
+    };
+
     std::vector<FileEntry> files;
+    std::unordered_map<std::string, u32> fileIndices;   // Path to position in files
+    std::vector<std::string> scanRoots;
+    std::string indexPath;
+    ScanStats scanStats;
     bool filesystemInitialized;
 
-    void ScanDirectory(const std::string& path);
+    // Walk state: files seen so far, files not in the list yet, and
+    // files that disappeared, kept until probing so moved files keep
+    // what was known about them
+    std::vector<PendingDirectory> pendingDirectories;
+    std::unordered_set<std::string> seenPaths;
+    std::vector<FileEntry> foundFiles;
+    std::vector<FileEntry> removedFiles;
+    bool walking;
+    u32 probeCursor;
+    bool indexLoaded;
+    bool indexDirty;
+
+    void BeginWalk();
+    bool WalkStep();        // True when the walk finished and changed the list
+    bool FinishWalk();
+    void ScanDirectory(const PendingDirectory& directory);
+    void VisitFile(const std::string& name, const std::string& path, long size, u32 modifiedTime);
+    void ProbeFile(FileEntry& entry);
+    void RebuildFileIndices();
+
     bool IsSTLExtension(const std::string& filename) const;
-    void AddFile(const std::string& name, const std::string& path);
+    static bool IsValidSTLSize(long size) { return size >= MIN_STL_SIZE && size <= MAX_STL_SIZE; }
 };
 
 #endif // FILE_MANAGER_H
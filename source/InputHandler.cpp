@@ -31,6 +31,8 @@ void InputHandler::Update() {
     currentState.rightPressed = (pressed & PAD_BUTTON_RIGHT) != 0;
     currentState.aPressed = (pressed & PAD_BUTTON_A) != 0;
     currentState.bPressed = (pressed & PAD_BUTTON_B) != 0;
+    currentState.xPressed = (pressed & PAD_BUTTON_X) != 0;
+    currentState.yPressed = (pressed & PAD_BUTTON_Y) != 0;
     currentState.startPressed = (pressed & PAD_BUTTON_START) != 0;
     currentState.zPressed = (pressed & PAD_TRIGGER_Z) != 0;
     currentState.lTriggerHeld = (held & PAD_TRIGGER_L) != 0;
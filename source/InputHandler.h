@@ -14,6 +14,8 @@ struct InputState {
     bool rightPressed;
     bool aPressed;
     bool bPressed;
+    bool xPressed;
+    bool yPressed;
     bool startPressed;
     bool zPressed;
     bool lTriggerHeld;
@@ -29,7 +31,7 @@ struct InputState {
 
     void Clear() {
         upPressed = downPressed = leftPressed = rightPressed = false;
-        aPressed = bPressed = startPressed = zPressed = false;
+        aPressed = bPressed = xPressed = yPressed = startPressed = zPressed = false;
         lTriggerHeld = rTriggerHeld = false;
         stickX = stickY = cStickX = cStickY = 0;
     }
@@ -0,0 +1,48 @@
+#include "Log.h"
+#include <cstdarg>
+#include <cstdio>
+
+LogBuffer* Log::capture = nullptr;
+Thread::Id Log::mainThread;
+
+void LogBuffer::Clear() {
+    text[0] = '\0';
+    length = 0;
+    droppedMessages = 0;
+}
+
+void LogBuffer::Flush() {
+    fputs(text, stdout);
+    if (droppedMessages > 0) {
+        printf("(%u more message(s) did not fit in the log buffer)\n", droppedMessages);
+    }
+    Clear();
+}
+
+void Log::Print(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (!capture || Thread::IsCurrent(mainThread)) {
+        vprintf(format, args);
+    } else {
+        // Only whole messages are kept, so a full buffer never ends mid-line
+        u32 space = LogBuffer::CAPACITY - capture->length;
+        int written = vsnprintf(capture->text + capture->length, space, format, args);
+        if (written >= 0 && static_cast<u32>(written) < space) {
+            capture->length += static_cast<u32>(written);
+        } else {
+            capture->text[capture->length] = '\0';
+            capture->droppedMessages++;
+        }
+    }
+    va_end(args);
+}
+
+void Log::BeginCapture(LogBuffer* buffer) {
+    mainThread = Thread::GetCurrentId();
+    capture = buffer;
+}
+
+void Log::EndCapture() {
+    capture = nullptr;
+}
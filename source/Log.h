@@ -0,0 +1,52 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include "Platform.h"
+#include "Thread.h"
+
+/**
+ * Fixed buffer for the messages of a background job, kept until the main
+ * thread prints them. Messages that do not fit are counted, not kept.
+ */
+class LogBuffer {
+public:
+    LogBuffer() { Clear(); }
+
+    void Clear();
+
+    // Print the messages on the console and empty the buffer
+    void Flush();
+
+    const char* GetText() const { return text; }
+    u32 GetLength() const { return length; }
+
+private:
+    friend class Log;
+
+    static const u32 CAPACITY = 8 * 1024;
+
+    char text[CAPACITY];
+    u32 length;
+    u32 droppedMessages;
+};
+
+/**
+ * Console messages of the loading and processing passes. While a capture
+ * is active, messages from any thread other than the one that began it go
+ * to the capture buffer instead, so a background job neither writes over
+ * the main thread's screen nor calls printf alongside it. Begin and end
+ * the capture on the main thread while no job is running.
+ */
+class Log {
+public:
+    static void Print(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+    static void BeginCapture(LogBuffer* buffer);
+    static void EndCapture();
+
+private:
+    static LogBuffer* capture;
+    static Thread::Id mainThread;
+};
+
+#endif // LOG_H
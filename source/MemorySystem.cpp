@@ -0,0 +1,52 @@
+#include "MemorySystem.h"
+#include <cstdio>
+
+Arena MemorySystem::meshArena;
+Arena MemorySystem::scratchArena;
+Arena MemorySystem::systemArena;
+
+bool MemorySystem::Initialize(u32 frameBufferBytes) {
+    if (!systemArena.Initialize("system", SYSTEM_ARENA_SIZE) ||
+        !scratchArena.Initialize("scratch", SCRATCH_ARENA_SIZE)) {
+        return false;
+    }
+
+#ifdef HOST_BUILD
+    u32 meshSize = MESH_ARENA_SIZE;
+    (void)frameBufferBytes;
+#else
+    // The mesh arena takes all of MEM1 that the heap has not claimed yet,
+    // minus the frame buffers still to come and a reserve for general
+    // allocations
+    u32 available = static_cast<u32>(static_cast<u8*>(SYS_GetArena1Hi()) -
+                                     static_cast<u8*>(SYS_GetArena1Lo()));
+    u32 reserve = frameBufferBytes + GENERAL_HEAP_RESERVE;
+    if (available <= reserve) {
+        printf("ERROR: Not enough memory for the mesh arena (%u KB free)\n", available / 1024);
+        return false;
+    }
+    u32 meshSize = available - reserve;
+#endif
+
+    if (!meshArena.Initialize("mesh", meshSize)) {
+        return false;
+    }
+
+    PrintReport();
+    return true;
+}
+
+void MemorySystem::Shutdown() {
+    meshArena.Shutdown();
+    scratchArena.Shutdown();
+    systemArena.Shutdown();
+}
+
+void MemorySystem::PrintReport() {
+    const Arena* arenas[] = { &meshArena, &scratchArena, &systemArena };
+    for (const Arena* arena : arenas) {
+        printf("Arena %-8s %6u / %6u KB used, high water %6u KB, %u failed\n",
+               arena->GetName(), arena->GetUsed() / 1024, arena->GetCapacity() / 1024,
+               arena->GetHighWaterMark() / 1024, arena->GetFailedAllocations());
+    }
+}
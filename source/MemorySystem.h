@@ -0,0 +1,39 @@
+#ifndef MEMORY_SYSTEM_H
+#define MEMORY_SYSTEM_H
+
+#include "Arena.h"
+
+/**
+ * Carves the heap into fixed arenas once at startup:
+ *  - mesh:    geometry of the loaded model, reset wholesale on Mesh::Clear
+ *  - scratch: temporary buffers of processing passes, rewound after each
+ *  - system:  long-lived buffers such as the GX FIFO
+ * Whatever is left stays with the general heap for strings and libraries.
+ */
+class MemorySystem {
+public:
+    // frameBufferBytes is kept back for the frame buffers the renderer
+    // allocates from the heap after the arenas are carved out
+    static bool Initialize(u32 frameBufferBytes = 0);
+    static void Shutdown();
+
+    static Arena& GetMeshArena() { return meshArena; }
+    static Arena& GetScratchArena() { return scratchArena; }
+    static Arena& GetSystemArena() { return systemArena; }
+
+    static void PrintReport();
+
+private:
+    static Arena meshArena;
+    static Arena scratchArena;
+    static Arena systemArena;
+
+    static const u32 SCRATCH_ARENA_SIZE = 4 * 1024 * 1024;
+    static const u32 SYSTEM_ARENA_SIZE = 512 * 1024;
+    static const u32 GENERAL_HEAP_RESERVE = 2 * 1024 * 1024;
+#ifdef HOST_BUILD
+    static const u32 MESH_ARENA_SIZE = 256 * 1024 * 1024;
+#endif
+};
+
+#endif // MEMORY_SYSTEM_H
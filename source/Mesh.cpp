@@ -3,8 +3,309 @@
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include "MemorySystem.h"
+#include "VertexCacheOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Log.h"
 
-Mesh::Mesh() : triangles(nullptr), triangleCount(0) {
+// Binary STL layout: 80 byte header, u32 facet count, then 50 byte facet records
+static const u32 STL_HEADER_SIZE = 84;
+static const u32 STL_FACET_SIZE = 50;
+
+// File data is pulled in large blocks so libfat can transfer whole sectors.
+// The read destination sits after a small carry area that holds the partial
+// facet left over from the previous block, keeping it 32-byte aligned.
+static const u32 READ_CHUNK_SIZE = 64 * 1024;
+static const u32 READ_CARRY_SIZE = 64;
+static u8 readBuffer[READ_CARRY_SIZE + READ_CHUNK_SIZE] __attribute__((aligned(32)));
+
+static inline u32 ReadLE32(const u8* bytes) {
+    return static_cast<u32>(bytes[0]) | (static_cast<u32>(bytes[1]) << 8) |
+           (static_cast<u32>(bytes[2]) << 16) | (static_cast<u32>(bytes[3]) << 24);
+}
+
+static inline void ReadLEVector(const u8* bytes, Vector3& out) {
+    union { u32 i; f32 f; } converter;
+    converter.i = ReadLE32(bytes);
+    out.x = converter.f;
+    converter.i = ReadLE32(bytes + 4);
+    out.y = converter.f;
+    converter.i = ReadLE32(bytes + 8);
+    out.z = converter.f;
+}
+
+/**
+ * Per-facet work fused into decoding: grows the bounding box and replaces
+ * missing or inconsistent file normals with the geometric normal while the
+ * facet is still in cache
+ */
+struct FacetAccumulator {
+    Vector3 minBounds;
+    Vector3 maxBounds;
+    u32 normalsRecomputed;
+    u32 degenerateCount;
+
+    FacetAccumulator() : minBounds(1e9f, 1e9f, 1e9f), maxBounds(-1e9f, -1e9f, -1e9f),
+                         normalsRecomputed(0), degenerateCount(0) {}
+
+    inline void Process(Triangle& tri) {
+        for (int j = 0; j < 3; j++) {
+            const Vector3& v = tri.vertices[j];
+            if (v.x < minBounds.x) minBounds.x = v.x;
+            if (v.x > maxBounds.x) maxBounds.x = v.x;
+            if (v.y < minBounds.y) minBounds.y = v.y;
+            if (v.y > maxBounds.y) maxBounds.y = v.y;
+            if (v.z < minBounds.z) minBounds.z = v.z;
+            if (v.z > maxBounds.z) maxBounds.z = v.z;
+        }
+
+        const Vector3& a = tri.vertices[0];
+        const Vector3& b = tri.vertices[1];
+        const Vector3& c = tri.vertices[2];
+        f32 e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+        f32 e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+        f32 nx = e1y * e2z - e1z * e2y;
+        f32 ny = e1z * e2x - e1x * e2z;
+        f32 nz = e1x * e2y - e1y * e2x;
+        f32 lengthSq = nx * nx + ny * ny + nz * nz;
+
+        // Zero area relative to the edge lengths: no usable geometric normal
+        f32 edgeScale = (e1x * e1x + e1y * e1y + e1z * e1z) * (e2x * e2x + e2y * e2y + e2z * e2z);
+        if (!(lengthSq > edgeScale * 1e-12f)) {
+            degenerateCount++;
+            return;
+        }
+
+        // Keep the file normal only if it is unit length and agrees with the
+        // winding; otherwise use the cross product
+        Vector3& n = tri.normal;
+        f32 fileLengthSq = n.x * n.x + n.y * n.y + n.z * n.z;
+        f32 agreement = n.x * nx + n.y * ny + n.z * nz;
+        if (fileLengthSq > 0.81f && fileLengthSq < 1.21f &&
+            agreement * agreement > 0.25f * lengthSq * fileLengthSq && agreement > 0.0f) {
+            return;
+        }
+
+        f32 invLength = 1.0f / sqrtf(lengthSq);
+        n.x = nx * invLength;
+        n.y = ny * invLength;
+        n.z = nz * invLength;
+        normalsRecomputed++;
+    }
+};
+
+// Decode consecutive 50-byte facet records (little-endian) into triangles
+static void DecodeFacets(const u8* src, Triangle* dst, u32 count, FacetAccumulator& accumulator) {
+    for (u32 i = 0; i < count; i++) {
+        ReadLEVector(src, dst->normal);
+        ReadLEVector(src + 12, dst->vertices[0]);
+        ReadLEVector(src + 24, dst->vertices[1]);
+        ReadLEVector(src + 36, dst->vertices[2]);
+        // Bytes 48-49 are the attribute byte count, ignored
+        accumulator.Process(*dst);
+        src += STL_FACET_SIZE;
+        dst++;
+    }
+}
+
+// ASCII tokens are kept contiguous in the read buffer; anything longer than
+// this (e.g. a long solid name) may be split, which the parser tolerates
+static const u32 ASCII_MAX_TOKEN = 256;
+static const int MAX_TRIANGLES = 1000000;
+
+/**
+ * Whitespace tokenizer that streams an ASCII STL through readBuffer
+ */
+class AsciiTokenizer {
+public:
+    explicit AsciiTokenizer(FILE* f) : file(f), pos(0), end(0), totalRead(0), eof(false) {}
+
+    u32 GetBytesConsumed() const { return totalRead - (end - pos); }
+
+    // Returns false at end of file
+    bool Next(const char*& token, u32& length) {
+        for (;;) {
+            if (end - pos < ASCII_MAX_TOKEN && !eof) {
+                Refill();
+            }
+
+            while (pos < end && IsSpace(readBuffer[pos])) {
+                pos++;
+            }
+
+            if (pos == end) {
+                if (eof) return false;
+                continue;
+            }
+
+            u32 start = pos;
+            while (pos < end && !IsSpace(readBuffer[pos])) {
+                pos++;
+            }
+
+            token = reinterpret_cast<const char*>(readBuffer + start);
+            length = pos - start;
+            return true;
+        }
+    }
+
+private:
+    FILE* file;
+    u32 pos;
+    u32 end;
+    u32 totalRead;
+    bool eof;
+
+    static bool IsSpace(u8 c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+    }
+
+    void Refill() {
+        u32 remaining = end - pos;
+        memmove(readBuffer, readBuffer + pos, remaining);
+        pos = 0;
+        end = remaining;
+
+        size_t bytes = fread(readBuffer + end, 1, sizeof(readBuffer) - end, file);
+        end += static_cast<u32>(bytes);
+        totalRead += static_cast<u32>(bytes);
+        if (bytes == 0) {
+            eof = true;
+        }
+    }
+};
+
+static inline bool TokenIs(const char* token, u32 length, const char* keyword, u32 keywordLength) {
+    return length == keywordLength && memcmp(token, keyword, keywordLength) == 0;
+}
+
+/**
+ * Locale-independent float parser for STL number tokens
+ * ([+-]digits[.digits][(e|E)[+-]digits]); returns false on malformed input
+ */
+static bool ParseFloat(const char* token, u32 length, f32& value) {
+    static const double powersOf10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* p = token;
+    const char* end = token + length;
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    // Leading zeros leave the mantissa at zero and are not counted against
+    // its 19 digits, so 0.000001234... keeps full precision
+    u64 mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    bool sawDigit = false;
+
+    while (p < end && *p >= '0' && *p <= '9') {
+        sawDigit = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += (mantissa != 0);
+        } else {
+            exponent++;
+        }
+        p++;
+    }
+
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            sawDigit = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += (mantissa != 0);
+                exponent--;
+            }
+            p++;
+        }
+    }
+
+    if (!sawDigit) {
+        return false;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = (*p == '-');
+            p++;
+        }
+        if (p == end) {
+            return false;
+        }
+
+        int explicitExponent = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (explicitExponent < 1000) {
+                explicitExponent = explicitExponent * 10 + (*p - '0');
+            }
+            p++;
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+
+    if (p != end) {
+        return false;
+    }
+
+    double result = static_cast<double>(mantissa);
+    while (exponent > 22) {
+        result *= 1e22;
+        exponent -= 22;
+    }
+    while (exponent < -22) {
+        result /= 1e22;
+        exponent += 22;
+    }
+    result = (exponent >= 0) ? result * powersOf10[exponent] : result / powersOf10[-exponent];
+
+    value = static_cast<f32>(negative ? -result : result);
+    return true;
+}
+
+bool Mesh::ReportProgress(u32 bytesProcessed, u32 trianglesProcessed) {
+    if (!loadProgress) {
+        return true;
+    }
+
+    loadProgress->bytesProcessed = bytesProcessed;
+    loadProgress->trianglesProcessed = trianglesProcessed;
+
+    if (loadProgress->cancelRequested) {
+        Log::Print("Load cancelled\n");
+        return false;
+    }
+    return true;
+}
+
+f32 MeshLoadStats::GetMegabytesPerSecond() const {
+    if (loadMicros == 0) return 0.0f;
+    return (static_cast<f32>(bytesRead) / (1024.0f * 1024.0f)) /
+           (static_cast<f32>(loadMicros) / 1000000.0f);
+}
+
+f32 MeshLoadStats::GetTrianglesPerSecond() const {
+    if (loadMicros == 0) return 0.0f;
+    return static_cast<f32>(triangleCount) / (static_cast<f32>(loadMicros) / 1000000.0f);
+}
+
+Mesh::Mesh(Arena* meshArena) : arena(meshArena), triangles(nullptr), triangleCount(0), faceNormals(nullptr),
+               vertices(nullptr), vertexCount(0), indices(nullptr), shortIndices(false), renderPositions(nullptr),
+               renderNormals(nullptr), renderCurvatures(nullptr), renderVertexCount(0),
+               renderIndices(nullptr), lodCount(0), surfaceOrientation(0), quantizedPositions(nullptr),
+               quantizedNormals(nullptr), positionFracBits(0),
+               positionQuantizationError(0.0f), normalQuantizationError(0.0f),
+               loadProgress(nullptr), revision(0) {
     minBounds = Vector3(1e9f, 1e9f, 1e9f);
     maxBounds = Vector3(-1e9f, -1e9f, -1e9f);
 }
@@ -14,23 +315,76 @@ Mesh::~Mesh() {
 }
 
 void Mesh::Clear() {
-    if (triangles) {
-        free(triangles);
-        triangles = nullptr;
+    // Every geometry buffer lives in the mesh arena and is released at once
+    if (arena) {
+        arena->Reset();
     }
+
+    triangles = nullptr;
     triangleCount = 0;
+    faceNormals = nullptr;
+
+    vertices = nullptr;
+    indices = nullptr;
+    vertexCount = 0;
+    shortIndices = false;
+
+    renderPositions = nullptr;
+    renderNormals = nullptr;
+    renderCurvatures = nullptr;
+    renderVertexCount = 0;
+    renderIndices = nullptr;
+    strips.Clear();
+    clusters.Clear();
+    ClearLods();
+    surfaceOrientation = 0;
+
+    quantizedPositions = nullptr;
+    quantizedNormals = nullptr;
+    positionFracBits = 0;
+    positionQuantizationError = 0.0f;
+    normalQuantizationError = 0.0f;
+
     minBounds = Vector3(1e9f, 1e9f, 1e9f);
     maxBounds = Vector3(-1e9f, -1e9f, -1e9f);
+
+    MarkModified();
+}
+
+void Mesh::ClearLods() {
+    for (int i = 0; i < MAX_LODS; i++) {
+        lods[i].strips.Clear();
+        lods[i].clusters.Clear();
+        lods[i].error = 0.0f;
+    }
+    lodCount = 0;
+}
+
+void Mesh::MarkModified() {
+    // Revisions are unique across all meshes
+    static u32 nextRevision = 1;
+    revision = nextRevision++;
+}
+
+void* Mesh::AllocateGeometry(u32 size, const char* what) {
+    void* block = arena ? arena->Allocate(size) : nullptr;
+    if (!block) {
+        Log::Print("ERROR: %s need %u KB but the mesh arena has %u KB free\n",
+               what, size / 1024, arena ? arena->GetRemaining() / 1024 : 0);
+    }
+    return block;
 }
 
 bool Mesh::LoadFromSTL(const char* filename) {
-    printf("Loading STL file: %s\n", filename);
+    Log::Print("Loading STL file: %s\n", filename);
 
     Clear();
+    loadStats.Clear();
+    u64 startTime = gettime();
 
     FILE* file = fopen(filename, "rb");
     if (!file) {
-        printf("ERROR: Cannot open file: %s\n", filename);
+        Log::Print("ERROR: Cannot open file: %s\n", filename);
         return false;
     }
 
@@ -38,28 +392,41 @@ bool Mesh::LoadFromSTL(const char* filename) {
     fseek(file, 0, SEEK_END);
     long fileSize = ftell(file);
     fseek(file, 0, SEEK_SET);
-    printf("File size: %ld bytes\n", fileSize);
+    Log::Print("File size: %ld bytes\n", fileSize);
+
+    if (loadProgress) {
+        loadProgress->bytesTotal = static_cast<u32>(fileSize);
+    }
 
     bool success = false;
     if (IsBinarySTL(file)) {
-        printf("Detected format: BINARY\n");
+        Log::Print("Detected format: BINARY\n");
+        loadStats.binary = true;
         success = LoadBinarySTL(file);
     } else {
-        printf("Detected format: ASCII\n");
+        Log::Print("Detected format: ASCII\n");
         success = LoadASCIISTL(file);
     }
 
     fclose(file);
 
     if (success) {
-        CalculateBounds();
-        printf("STL loaded successfully! Triangles: %d\n", triangleCount);
+        loadStats.bytesRead = fileSize;
+        loadStats.triangleCount = triangleCount;
+        loadStats.loadMicros = diff_usec(startTime, gettime());
+
+        Log::Print("STL loaded successfully! Triangles: %d\n", triangleCount);
+        Log::Print("Load time (%s): %.1f ms (%.2f MB/s, %.0f triangles/s)\n",
+               loadStats.binary ? "binary" : "ASCII", loadStats.loadMicros / 1000.0f, loadStats.GetMegabytesPerSecond(),
+               loadStats.GetTrianglesPerSecond());
+        Log::Print("Normals recomputed: %u, degenerate facets: %u\n",
+               loadStats.normalsRecomputed, loadStats.degenerateTriangles);
 
         Vector3 center = GetCenter();
         f32 maxSize = GetMaxSize();
-        printf("Model bounds: X(%.2f to %.2f) Y(%.2f to %.2f) Z(%.2f to %.2f)\n",
+        Log::Print("Model bounds: X(%.2f to %.2f) Y(%.2f to %.2f) Z(%.2f to %.2f)\n",
                minBounds.x, maxBounds.x, minBounds.y, maxBounds.y, minBounds.z, maxBounds.z);
-        printf("Model center: (%.2f, %.2f, %.2f), Max size: %.2f\n",
+        Log::Print("Model center: (%.2f, %.2f, %.2f), Max size: %.2f\n",
                center.x, center.y, center.z, maxSize);
     }
 
@@ -103,101 +470,940 @@ bool Mesh::IsBinarySTL(FILE* file) {
 }
 
 bool Mesh::LoadBinarySTL(FILE* file) {
-    fseek(file, 80, SEEK_SET); // Skip header
+    fseek(file, 0, SEEK_SET);
 
-    // Read triangle count
-    unsigned char countBytes[4];
-    if (fread(countBytes, 1, 4, file) != 4) {
-        printf("ERROR: Failed to read triangle count\n");
+    u8* chunk = readBuffer + READ_CARRY_SIZE;
+    size_t bytesInChunk = fread(chunk, 1, READ_CHUNK_SIZE, file);
+    if (bytesInChunk < STL_HEADER_SIZE) {
+        Log::Print("ERROR: Failed to read triangle count\n");
         return false;
     }
 
-    unsigned int count = countBytes[0] | (countBytes[1] << 8) |
-                        (countBytes[2] << 16) | (countBytes[3] << 24);
+    u32 count = ReadLE32(chunk + 80);
 
-    if (count == 0 || count > 1000000) {
-        printf("ERROR: Invalid triangle count: %u\n", count);
+    if (count == 0 || count > MAX_TRIANGLES) {
+        Log::Print("ERROR: Invalid triangle count: %u\n", count);
         return false;
     }
 
+    // The whole model must fit before any of it is decoded
+    triangles = static_cast<Triangle*>(AllocateGeometry(count * sizeof(Triangle), "Triangles"));
+    if (!triangles) {
+        return false;
+    }
     triangleCount = static_cast<int>(count);
-    triangles = static_cast<Triangle*>(malloc(triangleCount * sizeof(Triangle)));
 
+    // Decode whole facets from each block, carrying any partial record over
+    // into the next read
+    const u8* cursor = chunk + STL_HEADER_SIZE;
+    size_t available = bytesInChunk - STL_HEADER_SIZE;
+    u32 decoded = 0;
+    FacetAccumulator accumulator;
+
+    while (decoded < count) {
+        u32 facets = static_cast<u32>(available / STL_FACET_SIZE);
+        if (facets > count - decoded) {
+            facets = count - decoded;
+        }
+
+        DecodeFacets(cursor, triangles + decoded, facets, accumulator);
+        decoded += facets;
+        cursor += facets * STL_FACET_SIZE;
+        available -= facets * STL_FACET_SIZE;
+
+        if (!ReportProgress(STL_HEADER_SIZE + decoded * STL_FACET_SIZE, decoded)) {
+            Clear();
+            return false;
+        }
+
+        if (decoded == count) {
+            break;
+        }
+
+        u8* carry = chunk - available;
+        memmove(carry, cursor, available);
+
+        bytesInChunk = fread(chunk, 1, READ_CHUNK_SIZE, file);
+        if (bytesInChunk == 0) {
+            Log::Print("ERROR: Unexpected end of file at triangle %u of %u\n", decoded, count);
+            Clear();
+            return false;
+        }
+
+        cursor = carry;
+        available += bytesInChunk;
+    }
+
+    ApplyFacetStats(accumulator);
+    return true;
+}
+
+bool Mesh::LoadASCIISTL(FILE* file) {
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    // A typical ASCII facet takes around 250 bytes; start from that estimate
+    // and grow geometrically (in place, as the newest arena block) if the
+    // file is denser
+    int arenaLimit = arena ? static_cast<int>(arena->GetRemaining() / sizeof(Triangle)) : 0;
+    int capacity = static_cast<int>(fileSize / 250);
+    if (capacity < 256) capacity = 256;
+    if (capacity > MAX_TRIANGLES) capacity = MAX_TRIANGLES;
+    if (capacity > arenaLimit) capacity = arenaLimit;
+
+    triangles = static_cast<Triangle*>(AllocateGeometry(capacity * sizeof(Triangle), "Triangles"));
     if (!triangles) {
-        printf("ERROR: Failed to allocate memory for triangles\n");
         return false;
     }
 
-    // Read triangles
+    AsciiTokenizer tokenizer(file);
+    const char* token;
+    u32 length;
+
+    Triangle current;
+    int vertexIndex = 0;
+    bool inFacet = false;
+    FacetAccumulator accumulator;
+
+    while (tokenizer.Next(token, length)) {
+        if (TokenIs(token, length, "facet", 5)) {
+            inFacet = true;
+            vertexIndex = 0;
+            current.normal = Vector3();
+
+            // "facet normal nx ny nz"
+            if (!tokenizer.Next(token, length) || !TokenIs(token, length, "normal", 6)) {
+                Log::Print("ERROR: Expected 'normal' in facet %d\n", triangleCount);
+                Clear();
+                return false;
+            }
+
+            f32* components[3] = { &current.normal.x, &current.normal.y, &current.normal.z };
+            for (int i = 0; i < 3; i++) {
+                if (!tokenizer.Next(token, length) || !ParseFloat(token, length, *components[i])) {
+                    Log::Print("ERROR: Invalid normal in facet %d\n", triangleCount);
+                    Clear();
+                    return false;
+                }
+            }
+        } else if (TokenIs(token, length, "vertex", 6)) {
+            if (!inFacet || vertexIndex >= 3) {
+                Log::Print("ERROR: Unexpected vertex in facet %d\n", triangleCount);
+                Clear();
+                return false;
+            }
+
+            Vector3& vertex = current.vertices[vertexIndex++];
+            f32* components[3] = { &vertex.x, &vertex.y, &vertex.z };
+            for (int i = 0; i < 3; i++) {
+                if (!tokenizer.Next(token, length) || !ParseFloat(token, length, *components[i])) {
+                    Log::Print("ERROR: Invalid vertex in facet %d\n", triangleCount);
+                    Clear();
+                    return false;
+                }
+            }
+        } else if (TokenIs(token, length, "endfacet", 8)) {
+            if (!inFacet || vertexIndex != 3) {
+                Log::Print("ERROR: Incomplete facet %d\n", triangleCount);
+                Clear();
+                return false;
+            }
+            inFacet = false;
+
+            if (triangleCount == capacity) {
+                if (capacity == MAX_TRIANGLES) {
+                    Log::Print("ERROR: Too many triangles (max %d)\n", MAX_TRIANGLES);
+                    Clear();
+                    return false;
+                }
+
+                int newCapacity = capacity + capacity / 2;
+                if (newCapacity > MAX_TRIANGLES) newCapacity = MAX_TRIANGLES;
+                if (newCapacity > arenaLimit) newCapacity = arenaLimit;
+
+                if (newCapacity == capacity ||
+                    !arena->Resize(triangles, newCapacity * sizeof(Triangle))) {
+                    Log::Print("ERROR: Mesh arena full after %d triangles (%u KB)\n",
+                           triangleCount, arena->GetCapacity() / 1024);
+                    Clear();
+                    return false;
+                }
+                capacity = newCapacity;
+            }
+
+            accumulator.Process(current);
+            triangles[triangleCount++] = current;
+
+            if ((triangleCount & 1023) == 0 &&
+                !ReportProgress(tokenizer.GetBytesConsumed(), static_cast<u32>(triangleCount))) {
+                Clear();
+                return false;
+            }
+        }
+        // "solid <name>", "outer loop", "endloop" and "endsolid" carry no geometry
+    }
+
+    if (triangleCount == 0) {
+        Log::Print("ERROR: No facets found in ASCII STL\n");
+        Clear();
+        return false;
+    }
+
+    ApplyFacetStats(accumulator);
+
+    // Return the unused tail of the estimate to the arena
+    arena->Resize(triangles, triangleCount * sizeof(Triangle));
+
+    return true;
+}
+
+static inline u32 HashCell(s32 x, s32 y, s32 z) {
+    return (static_cast<u32>(x) * 73856093u) ^ (static_cast<u32>(y) * 19349663u) ^
+           (static_cast<u32>(z) * 83492791u);
+}
+
+// With a zero epsilon only identical positions weld, so the raw float bits
+// serve as the cell (adding 0.0f folds -0.0 into +0.0). Otherwise cells count
+// up from the bounds' minimum, clamped so a tiny epsilon on a huge model (or
+// a NaN corner) never casts out of range; the +/-1 neighbor offsets still fit.
+static inline s32 CellCoord(f32 value, f32 origin, f32 invCellSize, bool exact) {
+    if (exact) {
+        union { f32 f; s32 i; } converter;
+        converter.f = value + 0.0f;
+        return converter.i;
+    }
+    const f32 MAX_CELL = 1073741824.0f;
+    f32 cell = floorf((value - origin) * invCellSize);
+    if (!(cell > 0.0f)) {
+        return 0;
+    }
+    if (cell > MAX_CELL) {
+        return static_cast<s32>(MAX_CELL);
+    }
+    return static_cast<s32>(cell);
+}
+
+bool Mesh::Weld(f32 epsilon) {
+    // Welding reads the soup, which a previous weld has already released
+    if (!triangles || triangleCount == 0) {
+        return false;
+    }
+
+    u64 startTime = gettime();
+    const u32 cornerCount = static_cast<u32>(triangleCount) * 3;
+
+    // Spatial hash: cells are epsilon wide, so any match lies in one of the
+    // 27 cells around a corner. Each bucket heads a chain of unique vertices.
+    u32 bucketCount = 1;
+    while (bucketCount < static_cast<u32>(triangleCount)) {
+        bucketCount <<= 1;
+    }
+    const u32 bucketMask = bucketCount - 1;
+    const u32 EMPTY = 0xffffffff;
+
+    // Hash tables and the corner remap are temporary and grow with the
+    // model, past what the fixed scratch arena holds, so they come from the
+    // back of the mesh arena. The vertex array is sized for the worst case
+    // and trimmed in place once the count is known.
+    u32 backMarker = arena->GetBackMarker();
+    u32 tableBytes = (bucketCount + 2 * cornerCount) * sizeof(u32);
+    u32* buckets = static_cast<u32*>(arena->AllocateBack(bucketCount * sizeof(u32)));
+    u32* chain = static_cast<u32*>(arena->AllocateBack(cornerCount * sizeof(u32)));
+    u32* remap = static_cast<u32*>(arena->AllocateBack(cornerCount * sizeof(u32)));
+    if (!buckets || !chain || !remap) {
+        arena->ResetBackToMarker(backMarker);
+        Log::Print("ERROR: Vertex welding needs %u KB but the mesh arena has %u KB free\n",
+               tableBytes / 1024, arena->GetRemaining() / 1024);
+        return false;
+    }
+
+    Vector3* welded = static_cast<Vector3*>(AllocateGeometry(cornerCount * sizeof(Vector3), "Welded vertices"));
+    if (!welded) {
+        arena->ResetBackToMarker(backMarker);
+        return false;
+    }
+
+    memset(buckets, 0xff, bucketCount * sizeof(u32));
+
+    const bool exact = !(epsilon > 0.0f);
+    const f32 invCellSize = exact ? 0.0f : 1.0f / epsilon;
+    const f32 epsilonSq = epsilon * epsilon;
+    const int searchRadius = exact ? 0 : 1;
+    u32 uniqueCount = 0;
+
+    for (u32 corner = 0; corner < cornerCount; corner++) {
+        const Vector3& v = triangles[corner / 3].vertices[corner % 3];
+        s32 cx = CellCoord(v.x, minBounds.x, invCellSize, exact);
+        s32 cy = CellCoord(v.y, minBounds.y, invCellSize, exact);
+        s32 cz = CellCoord(v.z, minBounds.z, invCellSize, exact);
+
+        u32 match = EMPTY;
+        for (int dx = -searchRadius; dx <= searchRadius && match == EMPTY; dx++) {
+            for (int dy = -searchRadius; dy <= searchRadius && match == EMPTY; dy++) {
+                for (int dz = -searchRadius; dz <= searchRadius && match == EMPTY; dz++) {
+                    u32 bucket = HashCell(cx + dx, cy + dy, cz + dz) & bucketMask;
+
+                    for (u32 candidate = buckets[bucket]; candidate != EMPTY; candidate = chain[candidate]) {
+                        const Vector3& w = welded[candidate];
+                        f32 ex = w.x - v.x;
+                        f32 ey = w.y - v.y;
+                        f32 ez = w.z - v.z;
+                        if (ex * ex + ey * ey + ez * ez <= epsilonSq) {
+                            match = candidate;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (match == EMPTY) {
+            u32 bucket = HashCell(cx, cy, cz) & bucketMask;
+            match = uniqueCount++;
+            welded[match] = v;
+            chain[match] = buckets[bucket];
+            buckets[bucket] = match;
+        }
+
+        remap[corner] = match;
+    }
+
+    // Trim the vertex array and store indices as u16 where they fit
+    arena->Resize(welded, uniqueCount * sizeof(Vector3));
+
+    bool useShortIndices = (uniqueCount <= 0x10000);
+    void* indexBuffer = AllocateGeometry(cornerCount * (useShortIndices ? sizeof(u16) : sizeof(u32)), "Indices");
+    if (!indexBuffer) {
+        arena->ResetBackToMarker(backMarker);
+        return false;
+    }
+
+    if (useShortIndices) {
+        u16* narrow = static_cast<u16*>(indexBuffer);
+        for (u32 i = 0; i < cornerCount; i++) {
+            narrow[i] = static_cast<u16>(remap[i]);
+        }
+    } else {
+        memcpy(indexBuffer, remap, cornerCount * sizeof(u32));
+    }
+    arena->ResetBackToMarker(backMarker);
+
+    // Nothing reads the soup's corners any more. Its facet normals are
+    // packed into its front, and the welded arrays moved down behind them,
+    // so the soup's memory goes back to the arena.
+    Vector3* normals = reinterpret_cast<Vector3*>(triangles);
     for (int i = 0; i < triangleCount; i++) {
-        Triangle* tri = &triangles[i];
+        Vector3 normal = triangles[i].normal;
+        normals[i] = normal;
+    }
 
-        // Read normal (3 floats, little-endian)
-        if (!ReadFloat(file, tri->normal.x) ||
-            !ReadFloat(file, tri->normal.y) ||
-            !ReadFloat(file, tri->normal.z)) {
-            printf("ERROR: Failed to read normal for triangle %d\n", i);
-            return false;
+    u32 soupBytes = static_cast<u32>(triangleCount) * sizeof(Triangle);
+    u32 normalBytes = static_cast<u32>(triangleCount) * sizeof(Vector3);
+    u32 vertexBytes = uniqueCount * sizeof(Vector3);
+    u32 indexBytes = cornerCount * (useShortIndices ? sizeof(u16) : sizeof(u32));
+
+    arena->ResetToMarker(arena->GetMarker(triangles));
+    faceNormals = static_cast<Vector3*>(arena->Allocate(normalBytes));
+    vertices = static_cast<Vector3*>(arena->Allocate(vertexBytes));
+    memmove(vertices, welded, vertexBytes);
+    indices = arena->Allocate(indexBytes);
+    memmove(indices, indexBuffer, indexBytes);
+    triangles = nullptr;
+
+    vertexCount = static_cast<int>(uniqueCount);
+    shortIndices = useShortIndices;
+
+    Log::Print("Welded %u corners into %d vertices (%s indices) in %.1f ms\n",
+           cornerCount, vertexCount, shortIndices ? "u16" : "u32",
+           diff_usec(startTime, gettime()) / 1000.0f);
+    Log::Print("Indexed geometry: %u KB with facet normals, replacing %u KB of triangle soup\n",
+           (normalBytes + vertexBytes + indexBytes) / 1024, soupBytes / 1024);
+
+    MarkModified();
+    return true;
+}
+
+// Angle between the faces around a vertex, from the sum of their unit
+// normals: 0 where they agree, 1 at 90 degrees or more
+static f32 NormalSpread(const Vector3& normalSum, u32 faceCount) {
+    if (faceCount == 0) return 0.0f;
+    f32 agreement = sqrtf(normalSum.x * normalSum.x + normalSum.y * normalSum.y +
+                          normalSum.z * normalSum.z) / static_cast<f32>(faceCount);
+    if (agreement > 1.0f) agreement = 1.0f;
+    f32 spread = acosf(agreement) / (static_cast<f32>(M_PI) * 0.5f);
+    return spread > 1.0f ? 1.0f : spread;
+}
+
+static u8 EncodeCurvature(f32 curvature) {
+    return static_cast<u8>(curvature * 255.0f + 0.5f);
+}
+
+bool Mesh::ComputeVertexCurvature(f32* curvature) const {
+    if (!IsIndexed()) {
+        return false;
+    }
+
+    Arena& scratch = MemorySystem::GetScratchArena();
+    u32 scratchMarker = scratch.GetMarker();
+    Vector3* sums = static_cast<Vector3*>(scratch.Allocate(vertexCount * sizeof(Vector3)));
+    u32* counts = static_cast<u32*>(scratch.Allocate(vertexCount * sizeof(u32)));
+    if (!sums || !counts) {
+        Log::Print("ERROR: Curvature needs more than %u KB of scratch memory\n", scratch.GetCapacity() / 1024);
+        scratch.ResetToMarker(scratchMarker);
+        return false;
+    }
+
+    for (int v = 0; v < vertexCount; v++) {
+        sums[v] = Vector3();
+        counts[v] = 0;
+    }
+
+    const u32 cornerCount = static_cast<u32>(triangleCount) * 3;
+    for (u32 c = 0; c < cornerCount; c++) {
+        u32 v = GetIndex(c);
+        const Vector3& normal = faceNormals[c / 3];
+        sums[v].x += normal.x;
+        sums[v].y += normal.y;
+        sums[v].z += normal.z;
+        counts[v]++;
+    }
+
+    for (int v = 0; v < vertexCount; v++) {
+        curvature[v] = NormalSpread(sums[v], counts[v]);
+    }
+
+    scratch.ResetToMarker(scratchMarker);
+    return true;
+}
+
+bool Mesh::BuildRenderGeometry(f32 creaseAngleDegrees) {
+    if (!IsIndexed()) {
+        Log::Print("ERROR: Render geometry needs a welded mesh\n");
+        return false;
+    }
+
+    renderPositions = nullptr;
+    renderNormals = nullptr;
+    renderCurvatures = nullptr;
+    renderVertexCount = 0;
+    renderIndices = nullptr;
+    strips.Clear();
+    clusters.Clear();
+    ClearLods();
+    quantizedPositions = nullptr;
+    quantizedNormals = nullptr;
+
+    u64 startTime = gettime();
+    const u32 cornerCount = static_cast<u32>(triangleCount) * 3;
+    const u32 EMPTY = 0xffffffff;
+
+    // Corners grouped by welded vertex; temporary
+    Arena& scratch = MemorySystem::GetScratchArena();
+    u32 scratchMarker = scratch.GetMarker();
+    u32* cornerStart = static_cast<u32*>(scratch.Allocate((vertexCount + 1) * sizeof(u32)));
+    u32* corners = static_cast<u32*>(scratch.Allocate(cornerCount * sizeof(u32)));
+    u8* groupCurvature = static_cast<u8*>(scratch.Allocate(cornerCount));
+    if (!cornerStart || !corners || !groupCurvature) {
+        Log::Print("ERROR: Render geometry needs more than %u KB of scratch memory\n",
+               scratch.GetCapacity() / 1024);
+        scratch.ResetToMarker(scratchMarker);
+        return false;
+    }
+
+    u32* cornerVertex = static_cast<u32*>(AllocateGeometry(cornerCount * sizeof(u32), "Render indices"));
+    if (!cornerVertex) {
+        scratch.ResetToMarker(scratchMarker);
+        return false;
+    }
+
+    memset(cornerStart, 0, (vertexCount + 1) * sizeof(u32));
+    for (u32 c = 0; c < cornerCount; c++) {
+        cornerStart[GetIndex(c) + 1]++;
+    }
+    for (int v = 0; v < vertexCount; v++) {
+        cornerStart[v + 1] += cornerStart[v];
+    }
+    for (u32 c = 0; c < cornerCount; c++) {
+        corners[cornerStart[GetIndex(c)]++] = c;
+    }
+    for (int v = vertexCount; v > 0; v--) {
+        cornerStart[v] = cornerStart[v - 1];
+    }
+    cornerStart[0] = 0;
+
+    memset(cornerVertex, 0xff, cornerCount * sizeof(u32));
+    const f32 creaseCos = cosf(creaseAngleDegrees * static_cast<f32>(M_PI) / 180.0f);
+    u32 splitCount = 0;
+
+    // Around each welded vertex, the first unassigned face seeds a group that
+    // takes every face within the crease angle of it; each group becomes one
+    // render vertex. All groups share the curvature of the welded vertex.
+    for (int v = 0; v < vertexCount; v++) {
+        Vector3 normalSum;
+        for (u32 i = cornerStart[v]; i < cornerStart[v + 1]; i++) {
+            const Vector3& normal = faceNormals[corners[i] / 3];
+            normalSum.x += normal.x;
+            normalSum.y += normal.y;
+            normalSum.z += normal.z;
         }
+        u8 curvature = EncodeCurvature(NormalSpread(normalSum, cornerStart[v + 1] - cornerStart[v]));
 
-        // Read vertices (9 floats total)
-        for (int j = 0; j < 3; j++) {
-            if (!ReadFloat(file, tri->vertices[j].x) ||
-                !ReadFloat(file, tri->vertices[j].y) ||
-                !ReadFloat(file, tri->vertices[j].z)) {
-                printf("ERROR: Failed to read vertex %d for triangle %d\n", j, i);
-                return false;
+        for (u32 i = cornerStart[v]; i < cornerStart[v + 1]; i++) {
+            if (cornerVertex[corners[i]] != EMPTY) continue;
+
+            const Vector3& seed = faceNormals[corners[i] / 3];
+            u32 group = splitCount++;
+            groupCurvature[group] = curvature;
+
+            // A degenerate facet's zero normal is within no angle of itself
+            cornerVertex[corners[i]] = group;
+            for (u32 j = i + 1; j < cornerStart[v + 1]; j++) {
+                u32 corner = corners[j];
+                if (cornerVertex[corner] != EMPTY) continue;
+
+                const Vector3& normal = faceNormals[corner / 3];
+                if (normal.x * seed.x + normal.y * seed.y + normal.z * seed.z >= creaseCos) {
+                    cornerVertex[corner] = group;
+                }
             }
         }
+    }
+
+    Vector3* positions = static_cast<Vector3*>(AllocateGeometry(splitCount * sizeof(Vector3), "Render positions"));
+    Vector3* normals = positions ? static_cast<Vector3*>(
+        AllocateGeometry(splitCount * sizeof(Vector3), "Render normals")) : nullptr;
+    u8* curvatures = normals ? static_cast<u8*>(AllocateGeometry(splitCount, "Render curvature")) : nullptr;
+    if (!curvatures) {
+        scratch.ResetToMarker(scratchMarker);
+        return false;
+    }
+    memcpy(curvatures, groupCurvature, splitCount);
+    scratch.ResetToMarker(scratchMarker);
+    for (u32 g = 0; g < splitCount; g++) {
+        normals[g] = Vector3();
+    }
+
+    // Area-weighted normal sums; a group whose faces all have zero area
+    // takes the normal of one of them
+    for (u32 c = 0; c < cornerCount; c++) {
+        u32 first = c - c % 3;
+        const Vector3& a = vertices[GetIndex(first)];
+        const Vector3& b = vertices[GetIndex(first + 1)];
+        const Vector3& d = vertices[GetIndex(first + 2)];
+        f32 e1x = b.x - a.x;
+        f32 e1y = b.y - a.y;
+        f32 e1z = b.z - a.z;
+        f32 e2x = d.x - a.x;
+        f32 e2y = d.y - a.y;
+        f32 e2z = d.z - a.z;
+        f32 cx = e1y * e2z - e1z * e2y;
+        f32 cy = e1z * e2x - e1x * e2z;
+        f32 cz = e1x * e2y - e1y * e2x;
+        f32 area = sqrtf(cx * cx + cy * cy + cz * cz);
+
+        const Vector3& faceNormal = faceNormals[c / 3];
+        u32 group = cornerVertex[c];
+        positions[group] = vertices[GetIndex(c)];
+        normals[group].x += faceNormal.x * area;
+        normals[group].y += faceNormal.y * area;
+        normals[group].z += faceNormal.z * area;
+    }
+    for (u32 g = 0; g < splitCount; g++) {
+        Vector3& n = normals[g];
+        f32 length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+        n = length > 1e-12f ? Vector3(n.x / length, n.y / length, n.z / length) : Vector3();
+    }
+    for (u32 c = 0; c < cornerCount; c++) {
+        Vector3& n = normals[cornerVertex[c]];
+        if (n.x == 0.0f && n.y == 0.0f && n.z == 0.0f) {
+            n = faceNormals[c / 3];
+        }
+    }
+
+    renderPositions = positions;
+    renderNormals = normals;
+    renderCurvatures = curvatures;
+    renderVertexCount = static_cast<int>(splitCount);
+    renderIndices = cornerVertex;
+
+    Log::Print("Render geometry: %d vertices from %d welded (%.0f degree creases) in %.1f ms\n",
+           renderVertexCount, vertexCount, creaseAngleDegrees,
+           diff_usec(startTime, gettime()) / 1000.0f);
+
+    MarkModified();
+    return true;
+}
+
+bool Mesh::OptimizeVertexCache(u32 cacheSize) {
+    if (!HasRenderGeometry()) {
+        Log::Print("ERROR: Vertex cache optimization needs render geometry\n");
+        return false;
+    }
+
+    u64 startTime = gettime();
+    const u32 cornerCount = static_cast<u32>(triangleCount) * 3;
+    const u32 count = static_cast<u32>(renderVertexCount);
+    f32 acmrBefore = VertexCacheOptimizer::ComputeACMR(renderIndices, cornerCount, triangleCount, cacheSize);
 
-        // Skip attribute byte count (2 bytes)
-        fseek(file, 2, SEEK_CUR);
+    Arena& scratch = MemorySystem::GetScratchArena();
+    if (!VertexCacheOptimizer::OptimizeTriangles(renderIndices, triangleCount, count, cacheSize, scratch)) {
+        return false;
+    }
+
+    // Renumbering is optional: the triangle order alone is already valid
+    u32 scratchMarker = scratch.GetMarker();
+    u32* remap = static_cast<u32*>(scratch.Allocate(count * sizeof(u32)));
+    Vector3* reordered = static_cast<Vector3*>(scratch.Allocate(count * sizeof(Vector3)));
+    if (remap && reordered) {
+        VertexCacheOptimizer::BuildFetchOrder(renderIndices, cornerCount, count, remap);
+
+        for (u32 v = 0; v < count; v++) reordered[remap[v]] = renderPositions[v];
+        memcpy(renderPositions, reordered, count * sizeof(Vector3));
+        for (u32 v = 0; v < count; v++) reordered[remap[v]] = renderNormals[v];
+        memcpy(renderNormals, reordered, count * sizeof(Vector3));
+
+        u8* reorderedBytes = reinterpret_cast<u8*>(reordered);
+        for (u32 v = 0; v < count; v++) reorderedBytes[remap[v]] = renderCurvatures[v];
+        memcpy(renderCurvatures, reorderedBytes, count);
+    } else {
+        Log::Print("Vertex reordering skipped: needs more than %u KB of scratch memory\n",
+               scratch.GetCapacity() / 1024);
     }
+    scratch.ResetToMarker(scratchMarker);
 
+    // Clusters, strips, levels and quantized vertices built from the old
+    // order no longer match
+    strips.Clear();
+    clusters.Clear();
+    ClearLods();
+    quantizedPositions = nullptr;
+    quantizedNormals = nullptr;
+
+    f32 acmrAfter = VertexCacheOptimizer::ComputeACMR(renderIndices, cornerCount, triangleCount, cacheSize);
+    Log::Print("Vertex cache (%u entries): ACMR %.3f -> %.3f in %.1f ms\n", cacheSize,
+           acmrBefore, acmrAfter, diff_usec(startTime, gettime()) / 1000.0f);
+
+    MarkModified();
     return true;
 }
 
-bool Mesh::ReadFloat(FILE* file, f32& value) {
-    unsigned char bytes[4];
-    if (fread(bytes, 1, 4, file) != 4) {
+bool Mesh::BuildClusters() {
+    if (!HasRenderGeometry()) {
+        Log::Print("ERROR: Clustering needs render geometry\n");
+        return false;
+    }
+
+    // Strips and levels are built over the cluster order
+    strips.Clear();
+    ClearLods();
+
+    u64 startTime = gettime();
+    surfaceOrientation = ComputeSurfaceOrientation();
+    if (!ClusterCuller::Build(renderPositions, renderIndices, static_cast<u32>(triangleCount), surfaceOrientation,
+                              *arena, MemorySystem::GetScratchArena(), clusters)) {
         return false;
     }
 
-    // Convert little-endian bytes to float
-    union { f32 f; unsigned int i; } converter;
-    converter.i = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-    value = converter.f;
+    Log::Print("Clustered %d triangles into %u clusters (%u hierarchy nodes, %s) in %.1f ms\n",
+           triangleCount, clusters.clusterCount, clusters.nodeCount,
+           surfaceOrientation != 0 ? "closed, back faces culled" : "open, no back face culling",
+           diff_usec(startTime, gettime()) / 1000.0f);
 
+    MarkModified();
     return true;
 }
 
-bool Mesh::LoadASCIISTL(FILE* file) {
-    // For now, focus on binary STL support as it's more reliable
-    // ASCII STL parsing can be added later if needed
-    printf("ASCII STL format not yet implemented\n");
-    return false;
+s32 Mesh::ComputeSurfaceOrientation() const {
+    if (!IsIndexed()) {
+        return 0;
+    }
+
+    // Closed when every welded edge is matched by the same edge running
+    // the other way in a neighboring triangle
+    const u32 cornerCount = static_cast<u32>(triangleCount) * 3;
+    const u32 count = static_cast<u32>(vertexCount);
+    Arena& scratch = MemorySystem::GetScratchArena();
+    u32 scratchMarker = scratch.GetMarker();
+    u32* faceStart = static_cast<u32*>(scratch.Allocate((count + 1) * sizeof(u32)));
+    u32* faceList = static_cast<u32*>(scratch.Allocate(cornerCount * sizeof(u32)));
+    if (!faceStart || !faceList) {
+        Log::Print("Back face culling disabled: edge check needs more than %u KB of scratch memory\n",
+               scratch.GetCapacity() / 1024);
+        scratch.ResetToMarker(scratchMarker);
+        return 0;
+    }
+
+    memset(faceStart, 0, (count + 1) * sizeof(u32));
+    for (u32 i = 0; i < cornerCount; i++) {
+        faceStart[GetIndex(i) + 1]++;
+    }
+    for (u32 v = 0; v < count; v++) {
+        faceStart[v + 1] += faceStart[v];
+    }
+    for (u32 i = 0; i < cornerCount; i++) {
+        faceList[faceStart[GetIndex(i)]++] = i / 3;
+    }
+    for (u32 v = count; v > 0; v--) {
+        faceStart[v] = faceStart[v - 1];
+    }
+    faceStart[0] = 0;
+
+    bool closed = true;
+    for (u32 i = 0; i < cornerCount && closed; i++) {
+        u32 from = GetIndex(i);
+        u32 to = GetIndex(i - i % 3 + (i + 1) % 3);
+
+        bool matched = false;
+        for (u32 f = faceStart[to]; f < faceStart[to + 1] && !matched; f++) {
+            u32 face = faceList[f];
+            for (int k = 0; k < 3; k++) {
+                matched = matched || (GetIndex(face * 3 + k) == to && GetIndex(face * 3 + (k + 1) % 3) == from);
+            }
+        }
+        closed = matched;
+    }
+    scratch.ResetToMarker(scratchMarker);
+    if (!closed) {
+        return 0;
+    }
+
+    // The enclosed volume is positive when the triangles wind outwards
+    Vector3 center = GetCenter();
+    f32 volume = 0.0f;
+    for (int t = 0; t < triangleCount; t++) {
+        const Vector3& a = vertices[GetIndex(t * 3)];
+        const Vector3& b = vertices[GetIndex(t * 3 + 1)];
+        const Vector3& c = vertices[GetIndex(t * 3 + 2)];
+        f32 ax = a.x - center.x, ay = a.y - center.y, az = a.z - center.z;
+        f32 bx = b.x - center.x, by = b.y - center.y, bz = b.z - center.z;
+        f32 cx = c.x - center.x, cy = c.y - center.y, cz = c.z - center.z;
+        volume += ax * (by * cz - bz * cy) + ay * (bz * cx - bx * cz) + az * (bx * cy - by * cx);
+    }
+    return volume >= 0.0f ? 1 : -1;
 }
 
-void Mesh::CalculateBounds() {
-    if (!triangles || triangleCount == 0) {
-        return;
+bool Mesh::BuildStrips() {
+    if (!HasRenderGeometry()) {
+        Log::Print("ERROR: Stripification needs render geometry\n");
+        return false;
     }
 
-    minBounds = Vector3(1e9f, 1e9f, 1e9f);
-    maxBounds = Vector3(-1e9f, -1e9f, -1e9f);
+    u64 startTime = gettime();
+    Arena& scratch = MemorySystem::GetScratchArena();
+    if (!HasClusters()) {
+        if (!Stripifier::Build(renderIndices, static_cast<u32>(triangleCount), *arena, scratch, strips)) {
+            return false;
+        }
+    } else {
+        // Strips stay inside their cluster so clusters can be skipped whole
+        u32 scratchMarker = scratch.GetMarker();
+        u32* rangeStarts = static_cast<u32*>(scratch.Allocate((clusters.clusterCount + 1) * sizeof(u32)));
+        u32* primitiveStarts = static_cast<u32*>(scratch.Allocate((clusters.clusterCount + 1) * sizeof(u32)));
+        if (!rangeStarts || !primitiveStarts) {
+            Log::Print("ERROR: Stripification needs more than %u KB of scratch memory\n", scratch.GetCapacity() / 1024);
+            scratch.ResetToMarker(scratchMarker);
+            return false;
+        }
 
-    for (int i = 0; i < triangleCount; i++) {
-        for (int j = 0; j < 3; j++) {
-            const Vector3& vertex = triangles[i].vertices[j];
+        for (u32 c = 0; c < clusters.clusterCount; c++) {
+            rangeStarts[c] = clusters.clusters[c].firstTriangle;
+        }
+        rangeStarts[clusters.clusterCount] = static_cast<u32>(triangleCount);
+
+        // The stripifier releases its own scratch above ours
+        bool built = Stripifier::Build(renderIndices, static_cast<u32>(triangleCount), rangeStarts,
+                                       clusters.clusterCount, *arena, scratch, strips, primitiveStarts);
+        if (built) {
+            for (u32 c = 0; c < clusters.clusterCount; c++) {
+                clusters.clusters[c].firstPrimitive = primitiveStarts[c];
+                clusters.clusters[c].primitiveCount = primitiveStarts[c + 1] - primitiveStarts[c];
+            }
+        }
+        scratch.ResetToMarker(scratchMarker);
+        if (!built) {
+            return false;
+        }
+    }
+
+    Log::Print("Stripified %d triangles: %u strips, %u fans, %u loose in %.1f ms\n",
+           triangleCount, strips.stripCount, strips.fanCount, strips.looseTriangleCount,
+           diff_usec(startTime, gettime()) / 1000.0f);
+    Log::Print("Average strip length %.1f triangles, %.2f vertices per triangle, ACMR %.3f\n",
+           strips.GetAverageStripLength(), strips.GetVerticesPerTriangle(),
+           VertexCacheOptimizer::ComputeACMR(strips.indices, strips.indexCount, strips.triangleCount,
+                                             VertexCacheOptimizer::DEFAULT_CACHE_SIZE));
+
+    MarkModified();
+    return true;
+}
+
+bool Mesh::BuildLods() {
+    if (!HasRenderGeometry()) {
+        Log::Print("ERROR: Level of detail generation needs render geometry\n");
+        return false;
+    }
+
+    ClearLods();
+
+    // Each level halves the triangle count of the one before
+    u32 targets[MAX_LODS];
+    u32 target = static_cast<u32>(triangleCount);
+    for (int i = 0; i < MAX_LODS; i++) {
+        target /= 2;
+        targets[i] = target;
+    }
+
+    u64 startTime = gettime();
+    SimplifiedLevel levels[MAX_LODS];
+    int levelCount = MeshSimplifier::BuildLevels(renderPositions, renderNormals,
+                                                 static_cast<u32>(renderVertexCount),
+                                                 renderIndices, static_cast<u32>(triangleCount),
+                                                 targets, MAX_LODS, *arena, levels);
+    u32 simplifyMicros = diff_usec(startTime, gettime());
+
+    Arena& scratch = MemorySystem::GetScratchArena();
+    for (int i = 0; i < levelCount; i++) {
+        // Collapses scatter the triangle order, so reorder each level for
+        // the vertex cache; a failure leaves a valid, slower level
+        VertexCacheOptimizer::OptimizeTriangles(levels[i].indices, levels[i].triangleCount,
+                                                static_cast<u32>(renderVertexCount),
+                                                VertexCacheOptimizer::DEFAULT_CACHE_SIZE, scratch);
+
+        // One independent-triangle primitive per cluster, or for the whole
+        // level if it could not be clustered
+        MeshLod& lod = lods[lodCount];
+        ClusterCuller::Build(renderPositions, levels[i].indices, levels[i].triangleCount,
+                             surfaceOrientation, *arena, scratch, lod.clusters);
+        u32 primitiveCount = lod.clusters.clusterCount > 0 ? lod.clusters.clusterCount : 1;
+        StripPrimitive* primitives = static_cast<StripPrimitive*>(
+            AllocateGeometry(primitiveCount * sizeof(StripPrimitive), "Level of detail primitives"));
+        if (!primitives) {
+            lod.clusters.Clear();
+            break;
+        }
+
+        for (u32 p = 0; p < primitiveCount; p++) {
+            primitives[p].type = STRIP_PRIMITIVE_TRIANGLES;
+            primitives[p].firstIndex = 0;
+            primitives[p].indexCount = levels[i].triangleCount * 3;
+        }
+        for (u32 c = 0; c < lod.clusters.clusterCount; c++) {
+            MeshCluster& cluster = lod.clusters.clusters[c];
+            cluster.firstPrimitive = c;
+            cluster.primitiveCount = 1;
+            primitives[c].firstIndex = cluster.firstTriangle * 3;
+            primitives[c].indexCount = cluster.triangleCount * 3;
+        }
+
+        lodCount++;
+        lod.strips.indices = levels[i].indices;
+        lod.strips.indexCount = levels[i].triangleCount * 3;
+        lod.strips.primitives = primitives;
+        lod.strips.primitiveCount = primitiveCount;
+        lod.strips.triangleCount = levels[i].triangleCount;
+        lod.strips.looseTriangleCount = levels[i].triangleCount;
+        lod.error = levels[i].error;
+    }
+
+    Log::Print("Built %d levels of detail in %.1f ms\n", lodCount, simplifyMicros / 1000.0f);
+    for (int i = 0; i < lodCount; i++) {
+        Log::Print("  LOD %d: %u triangles, error %.4f, ACMR %.3f\n", i + 1, lods[i].strips.triangleCount,
+               lods[i].error,
+               VertexCacheOptimizer::ComputeACMR(lods[i].strips.indices, lods[i].strips.indexCount,
+                                                 lods[i].strips.triangleCount,
+                                                 VertexCacheOptimizer::DEFAULT_CACHE_SIZE));
+    }
+
+    MarkModified();
+    return lodCount > 0;
+}
+
+static inline s16 QuantizeComponent(f32 value, f32 scale, s32 minValue, s32 maxValue) {
+    f32 scaled = value * scale;
+    s32 q = static_cast<s32>(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+    if (q < minValue) q = minValue;
+    if (q > maxValue) q = maxValue;
+    return static_cast<s16>(q);
+}
+
+bool Mesh::Quantize() {
+    quantizedPositions = nullptr;
+    quantizedNormals = nullptr;
+    if (!HasRenderGeometry()) {
+        return false;
+    }
 
-            if (vertex.x < minBounds.x) minBounds.x = vertex.x;
-            if (vertex.x > maxBounds.x) maxBounds.x = vertex.x;
-            if (vertex.y < minBounds.y) minBounds.y = vertex.y;
-            if (vertex.y > maxBounds.y) maxBounds.y = vertex.y;
-            if (vertex.z < minBounds.z) minBounds.z = vertex.z;
-            if (vertex.z > maxBounds.z) maxBounds.z = vertex.z;
+    // Pick the most fractional bits that keep the half extent within s16
+    Vector3 center = GetCenter();
+    f32 halfExtent = GetMaxSize() * 0.5f;
+    if (halfExtent > 32767.0f) {
+        Log::Print("ERROR: Model too large to quantize (%.1f units)\n", GetMaxSize());
+        return false;
+    }
+
+    u8 fracBits = 0;
+    while (fracBits < 15 && halfExtent * static_cast<f32>(1 << (fracBits + 1)) <= 32767.0f) {
+        fracBits++;
+    }
+
+    const u32 count = static_cast<u32>(renderVertexCount);
+    s16* positions = static_cast<s16*>(AllocateGeometry(count * 3 * sizeof(s16), "Quantized positions"));
+    s8* normals = positions ? static_cast<s8*>(AllocateGeometry(count * 3 * sizeof(s8), "Quantized normals"))
+                            : nullptr;
+    if (!normals) {
+        return false;
+    }
+
+    const f32 positionScale = static_cast<f32>(1 << fracBits);
+    const f32 invPositionScale = 1.0f / positionScale;
+    const f32 normalScale = static_cast<f32>(1 << NORMAL_FRAC_BITS);
+    const f32 invNormalScale = 1.0f / normalScale;
+    f32 maxPositionErrorSq = 0.0f;
+    f32 maxNormalError = 0.0f;
+
+    for (u32 v = 0; v < count; v++) {
+        const Vector3& position = renderPositions[v];
+        const f32 local[3] = { position.x - center.x, position.y - center.y, position.z - center.z };
+        const f32 normal[3] = { renderNormals[v].x, renderNormals[v].y, renderNormals[v].z };
+        s16* outPosition = positions + v * 3;
+        s8* outNormal = normals + v * 3;
+
+        f32 errorSq = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            outPosition[k] = QuantizeComponent(local[k], positionScale, -32768, 32767);
+            f32 error = outPosition[k] * invPositionScale - local[k];
+            errorSq += error * error;
+
+            outNormal[k] = static_cast<s8>(QuantizeComponent(normal[k], normalScale, -128, 127));
+            error = fabsf(outNormal[k] * invNormalScale - normal[k]);
+            if (error > maxNormalError) maxNormalError = error;
         }
+        if (errorSq > maxPositionErrorSq) maxPositionErrorSq = errorSq;
     }
+
+    quantizedPositions = positions;
+    quantizedNormals = normals;
+    positionFracBits = fracBits;
+    positionQuantizationError = sqrtf(maxPositionErrorSq);
+    normalQuantizationError = maxNormalError;
+
+    Log::Print("Quantized %u render vertices: s16 positions with %u frac bits, s8 normals (%u KB vs %u KB as floats)\n",
+           count, positionFracBits, count * 9 / 1024, count * 2 * static_cast<u32>(sizeof(Vector3)) / 1024);
+    Log::Print("Worst-case error: position %.5f units (1/%.0f of size), normal %.4f\n",
+           positionQuantizationError,
+           positionQuantizationError > 0.0f ? GetMaxSize() / positionQuantizationError : 0.0f,
+           normalQuantizationError);
+
+    MarkModified();
+    return true;
+}
+
+void Mesh::ApplyFacetStats(const FacetAccumulator& accumulator) {
+    minBounds = accumulator.minBounds;
+    maxBounds = accumulator.maxBounds;
+    loadStats.normalsRecomputed = accumulator.normalsRecomputed;
+    loadStats.degenerateTriangles = accumulator.degenerateCount;
 }
 
 Vector3 Mesh::GetCenter() const {
@@ -1,18 +1,14 @@
 #ifndef MESH_H
 #define MESH_H
 
-#include <gccore.h>
+#include "Platform.h"
 #include <cstdio>
+#include "Arena.h"
+#include "Vector3.h"
+#include "Stripifier.h"
+#include "ClusterCuller.h"
 
-/**
- * 3D Vector structure
- */
-struct Vector3 {
-    f32 x, y, z;
-
-    Vector3() : x(0), y(0), z(0) {}
-    Vector3(f32 x_, f32 y_, f32 z_) : x(x_), y(y_), z(z_) {}
-};
+struct FacetAccumulator;
 
 /**
  * Triangle structure representing a face in the mesh
@@ -24,20 +20,177 @@ struct Triangle {
     Triangle() {}
 };
 
+/**
+ * Timing and throughput figures for the most recent STL load
+ */
+struct MeshLoadStats {
+    long bytesRead;
+    int triangleCount;
+    u32 loadMicros;
+    bool binary;
+
+    // Facet validation performed during decoding
+    u32 normalsRecomputed;
+    u32 degenerateTriangles;
+
+    MeshLoadStats() { Clear(); }
+
+    void Clear() {
+        bytesRead = 0;
+        triangleCount = 0;
+        loadMicros = 0;
+        binary = false;
+        normalsRecomputed = 0;
+        degenerateTriangles = 0;
+    }
+
+    f32 GetMegabytesPerSecond() const;
+    f32 GetTrianglesPerSecond() const;
+};
+
+/**
+ * Progress counters shared with a background load. The loading thread
+ * writes them; the main loop polls them and may request cancellation.
+ */
+struct MeshLoadProgress {
+    vu32 bytesProcessed;
+    vu32 bytesTotal;
+    vu32 trianglesProcessed;
+    volatile bool cancelRequested;
+
+    MeshLoadProgress() { Reset(); }
+
+    void Reset() {
+        bytesProcessed = 0;
+        bytesTotal = 0;
+        trianglesProcessed = 0;
+        cancelRequested = false;
+    }
+};
+
+/**
+ * Simplified level of detail over the render vertices. Its triangles are
+ * kept as one independent-triangle run per cluster so the renderer can
+ * draw and cull it through the same path as the full-detail strips.
+ */
+struct MeshLod {
+    StripSet strips;
+    ClusterSet clusters;
+    f32 error;          // Largest deviation from the full mesh, in model units
+
+    MeshLod() : error(0.0f) {}
+};
+
 /**
  * Mesh class for handling 3D geometry data
  */
 class Mesh {
 public:
-    Mesh();
+    // All geometry is allocated from the given arena, which the mesh owns
+    // exclusively and resets on Clear
+    explicit Mesh(Arena* meshArena);
     ~Mesh();
 
     bool LoadFromSTL(const char* filename);
     void Clear();
 
-    // Getters
+    // Optional progress reporting and cancellation for loads (may be null)
+    void SetLoadProgress(MeshLoadProgress* progress) { loadProgress = progress; }
+
+    // Merge vertices closer than epsilon into a shared, indexed vertex array
+    bool Weld(f32 epsilon);
+
+    // Split welded vertices along creases sharper than the given angle and
+    // give each piece a smoothed normal (requires Weld)
+    bool BuildRenderGeometry(f32 creaseAngleDegrees);
+
+    // Reorder the render geometry for the post-transform vertex cache, then
+    // renumber its vertices in order of first use
+    bool OptimizeVertexCache(u32 cacheSize);
+
+    // Group the render geometry into clusters with bounding spheres and
+    // normal cones for culling; run before BuildStrips so that no strip
+    // crosses a cluster
+    bool BuildClusters();
+
+    // Cover the render geometry with triangle strips and fans
+    bool BuildStrips();
+
+    // Simplify the render geometry into progressively coarser levels of
+    // detail (requires BuildRenderGeometry)
+    bool BuildLods();
+
+    // Build the fixed-point copy of the render vertices used for GX_S16/GX_S8
+    // submission (requires BuildRenderGeometry; run after OptimizeVertexCache,
+    // which renumbers the vertices)
+    bool Quantize();
+
+    // Triangle soup as loaded; a successful Weld releases it and keeps only
+    // the facet normals, so read facets through GetFaceNormal and GetCorner
     const Triangle* GetTriangles() const { return triangles; }
     int GetTriangleCount() const { return triangleCount; }
+    const Vector3& GetFaceNormal(int i) const { return triangles ? triangles[i].normal : faceNormals[i]; }
+    const Vector3& GetCorner(int i, int corner) const {
+        return triangles ? triangles[i].vertices[corner] : vertices[GetIndex(i * 3 + corner)];
+    }
+
+    // Indexed representation (available after Weld)
+    bool IsIndexed() const { return vertices != nullptr && indices != nullptr; }
+    const Vector3* GetVertices() const { return vertices; }
+    int GetVertexCount() const { return vertexCount; }
+    bool HasShortIndices() const { return shortIndices; }
+    const u16* GetIndices16() const { return shortIndices ? static_cast<const u16*>(indices) : nullptr; }
+    const u32* GetIndices32() const { return shortIndices ? nullptr : static_cast<const u32*>(indices); }
+    u32 GetIndex(int i) const {
+        return shortIndices ? static_cast<const u16*>(indices)[i] : static_cast<const u32*>(indices)[i];
+    }
+
+    // Render geometry (available after BuildRenderGeometry): each render
+    // vertex is a welded position plus a normal averaged only over the faces
+    // meeting it within the crease angle, and the curvature of the welded
+    // vertex (0-255, see ComputeVertexCurvature). Positions and normals are separate
+    // 32-byte aligned arrays so they can back GX vertex arrays directly.
+    // Indices are three u32 per triangle; after OptimizeVertexCache their
+    // order no longer matches the facets.
+    bool HasRenderGeometry() const { return renderPositions != nullptr; }
+    const Vector3* GetRenderPositions() const { return renderPositions; }
+    const Vector3* GetRenderNormals() const { return renderNormals; }
+    const u8* GetRenderCurvatures() const { return renderCurvatures; }
+    int GetRenderVertexCount() const { return renderVertexCount; }
+    const u32* GetRenderIndices() const { return renderIndices; }
+
+    // Strips over the render geometry (available after BuildStrips)
+    bool HasStrips() const { return strips.primitives != nullptr; }
+    const StripSet& GetStrips() const { return strips; }
+
+    // Clusters of the full-detail strips (available after BuildClusters
+    // and BuildStrips)
+    bool HasClusters() const { return clusters.clusterCount > 0; }
+    const ClusterSet& GetClusters() const { return clusters; }
+
+    // Levels of detail from finest to coarsest (available after BuildLods);
+    // all of them index the render vertices
+    static const int MAX_LODS = 4;
+    int GetLodCount() const { return lodCount; }
+    const MeshLod& GetLod(int level) const { return lods[level]; }
+
+    // Spread of the face normals around each welded vertex, 0 where the
+    // faces are coplanar to 1 at 90 degrees or more (requires Weld)
+    bool ComputeVertexCurvature(f32* curvature) const;
+
+    // Quantized render vertices (available after Quantize): three s16
+    // position components relative to the mesh center with
+    // GetPositionFracBits() fractional bits, and three s8 normal components
+    // with the hardware's fixed 6, in 32-byte aligned arrays that can back
+    // GX vertex arrays directly
+    bool IsQuantized() const { return quantizedPositions != nullptr; }
+    const s16* GetQuantizedPositions() const { return quantizedPositions; }
+    const s8* GetQuantizedNormals() const { return quantizedNormals; }
+    u8 GetPositionFracBits() const { return positionFracBits; }
+    f32 GetPositionQuantizationError() const { return positionQuantizationError; }
+    f32 GetNormalQuantizationError() const { return normalQuantizationError; }
+
+    static const u8 NORMAL_FRAC_BITS = 6;
 
     // Bounding box information
     Vector3 GetMinBounds() const { return minBounds; }
@@ -45,21 +198,74 @@ public:
     Vector3 GetCenter() const;
     f32 GetMaxSize() const;
 
-    bool IsValid() const { return triangles != nullptr && triangleCount > 0; }
+    bool IsValid() const { return (triangles != nullptr || faceNormals != nullptr) && triangleCount > 0; }
+
+    // Changes whenever the geometry does, so derived render data can be rebuilt
+    u32 GetRevision() const { return revision; }
+
+    // Arena holding the geometry at its front; renderers may place per-mesh
+    // data at its back, which is released together with the mesh
+    Arena* GetArena() const { return arena; }
+
+    // Load benchmark
+    const MeshLoadStats& GetLoadStats() const { return loadStats; }
 
 private:
+    friend class MeshCache;
+    friend class MeshCacheWriter;
+
+    Arena* arena;
     Triangle* triangles;
     int triangleCount;
 
+    // Facet normals, which outlive the soup once it is welded
+    Vector3* faceNormals;
+
+    // Welded vertices and three indices per triangle (u16 or u32)
+    Vector3* vertices;
+    int vertexCount;
+    void* indices;
+    bool shortIndices;
+
+    // Crease-split vertices with smoothed normals, and their strips
+    Vector3* renderPositions;
+    Vector3* renderNormals;
+    u8* renderCurvatures;
+    int renderVertexCount;
+    u32* renderIndices;
+    StripSet strips;
+    ClusterSet clusters;
+    MeshLod lods[MAX_LODS];
+    int lodCount;
+
+    // +1 if the surface is closed and wound outwards, -1 if closed and
+    // wound inwards, 0 if open; only closed surfaces can hide back faces
+    s32 surfaceOrientation;
+
+    // Fixed-point copy of the render vertices
+    s16* quantizedPositions;
+    s8* quantizedNormals;
+    u8 positionFracBits;
+    f32 positionQuantizationError;
+    f32 normalQuantizationError;
+
     // Bounding box
     Vector3 minBounds;
     Vector3 maxBounds;
 
-    void CalculateBounds();
+    MeshLoadStats loadStats;
+    MeshLoadProgress* loadProgress;
+    u32 revision;
+
+    void ApplyFacetStats(const FacetAccumulator& accumulator);
+    void* AllocateGeometry(u32 size, const char* what);
+    void ClearLods();
+    s32 ComputeSurfaceOrientation() const;
+    void MarkModified();
     bool LoadBinarySTL(FILE* file);
     bool LoadASCIISTL(FILE* file);
     bool IsBinarySTL(FILE* file);
-    bool ReadFloat(FILE* file, f32& value);
+    bool ReportProgress(u32 bytesProcessed, u32 trianglesProcessed);
 };
 
 #endif // MESH_H
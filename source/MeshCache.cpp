@@ -0,0 +1,475 @@
+#include "MeshCache.h"
+#include "Log.h"
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static u32 AlignSection(u32 size) {
+    return (size + MeshCache::SECTION_ALIGNMENT - 1) & ~(MeshCache::SECTION_ALIGNMENT - 1);
+}
+
+static bool ReadSection(FILE* file, void* buffer, u32 size) {
+    if (fread(buffer, 1, size, file) != size) {
+        return false;
+    }
+    u32 padding = AlignSection(size) - size;
+    return padding == 0 || fseek(file, padding, SEEK_CUR) == 0;
+}
+
+// Counts a level can have for a mesh of triangleCount triangles; checked
+// before any size is computed from them
+static bool IsValidLevelCounts(const MeshCacheLevel& level, u32 triangleCount) {
+    return level.triangleCount > 0 && level.triangleCount <= triangleCount &&
+           level.indexCount <= level.triangleCount * 3 &&
+           level.primitiveCount > 0 && level.primitiveCount <= level.triangleCount &&
+           level.clusterCount <= level.triangleCount && level.nodeCount <= level.clusterCount * 2;
+}
+
+// Every range of a level must stay inside the arrays the renderer walks
+static bool IsValidLevel(const StripSet& strips, const ClusterSet& clusters, u32 vertexCount) {
+    for (u32 i = 0; i < strips.indexCount; i++) {
+        if (strips.indices[i] >= vertexCount) return false;
+    }
+    for (u32 i = 0; i < strips.primitiveCount; i++) {
+        const StripPrimitive& primitive = strips.primitives[i];
+        if (primitive.type > STRIP_PRIMITIVE_FAN || primitive.indexCount < 3 ||
+            primitive.firstIndex > strips.indexCount || primitive.indexCount > strips.indexCount - primitive.firstIndex) {
+            return false;
+        }
+    }
+    for (u32 i = 0; i < clusters.clusterCount; i++) {
+        const MeshCluster& cluster = clusters.clusters[i];
+        if (cluster.firstPrimitive > strips.primitiveCount ||
+            cluster.primitiveCount > strips.primitiveCount - cluster.firstPrimitive ||
+            cluster.firstTriangle > strips.triangleCount ||
+            cluster.triangleCount > strips.triangleCount - cluster.firstTriangle) {
+            return false;
+        }
+    }
+
+    // The hierarchy must partition the clusters: the root covers all of
+    // them and each node's children split its range in order, so culling
+    // lists every cluster at most once
+    if (clusters.nodeCount == 0) {
+        return true;
+    }
+    const ClusterNode& root = clusters.nodes[0];
+    if (root.firstCluster != 0 || root.clusterCount != clusters.clusterCount || root.skip != clusters.nodeCount) {
+        return false;
+    }
+    for (u32 i = 0; i < clusters.nodeCount; i++) {
+        const ClusterNode& node = clusters.nodes[i];
+        if (node.skip <= i || node.skip > clusters.nodeCount) {
+            return false;
+        }
+
+        // A node's own range was checked against its parent's first
+        u32 end = node.firstCluster + node.clusterCount;
+        u32 expected = node.firstCluster;
+        for (u32 child = i + 1; child < node.skip; child = clusters.nodes[child].skip) {
+            const ClusterNode& next = clusters.nodes[child];
+            if (next.firstCluster != expected || next.clusterCount > end - expected ||
+                next.skip <= child || next.skip > node.skip) {
+                return false;
+            }
+            expected += next.clusterCount;
+        }
+        if (node.skip > i + 1 && expected != end) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath) {
+    size_t dotPos = sourcePath.find_last_of('.');
+    size_t slashPos = sourcePath.find_last_of('/');
+    if (dotPos != std::string::npos && (slashPos == std::string::npos || dotPos > slashPos)) {
+        return sourcePath.substr(0, dotPos) + ".gcm";
+    }
+    return sourcePath + ".gcm";
+}
+
+bool MeshCache::Load(const std::string& sourcePath, Mesh& mesh) {
+    struct stat sourceStat;
+    if (stat(sourcePath.c_str(), &sourceStat) != 0) {
+        return false;
+    }
+
+    std::string cachePath = GetCachePath(sourcePath);
+    FILE* file = fopen(cachePath.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    u64 startTime = gettime();
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    MeshCacheHeader header;
+    if (fread(&header, 1, sizeof(header), file) != sizeof(header) ||
+        header.magic != MAGIC || header.version != VERSION) {
+        Log::Print("Ignoring invalid mesh cache: %s\n", cachePath.c_str());
+        fclose(file);
+        return false;
+    }
+
+    if (header.sourceSize != static_cast<u32>(sourceStat.st_size) ||
+        header.sourceModifiedTime != static_cast<u32>(sourceStat.st_mtime)) {
+        Log::Print("Mesh cache is stale: %s\n", cachePath.c_str());
+        fclose(file);
+        return false;
+    }
+
+    // Counts are bounded before any size is computed from them; a weld
+    // never makes more vertices than corners
+    bool welded = (header.indexSize != 0);
+    if (header.triangleCount == 0 || header.triangleCount > 1000000 ||
+        (welded && header.indexSize != 2 && header.indexSize != 4) ||
+        (welded && (header.vertexCount == 0 || header.vertexCount > header.triangleCount * 3)) ||
+        (!welded && header.vertexCount != 0)) {
+        Log::Print("Ignoring invalid mesh cache: %s\n", cachePath.c_str());
+        fclose(file);
+        return false;
+    }
+
+    mesh.Clear();
+    mesh.loadStats.Clear();
+
+    u32 triangleBytes = header.triangleCount * sizeof(Triangle);
+    u32 normalBytes = header.triangleCount * sizeof(Vector3);
+    u32 vertexBytes = header.vertexCount * sizeof(Vector3);
+    u32 indexBytes = header.triangleCount * 3 * header.indexSize;
+    if (mesh.loadProgress) {
+        mesh.loadProgress->bytesTotal = static_cast<u32>(fileSize);
+    }
+
+    // Sections are read straight into the mesh's final buffers
+    if (!welded) {
+        mesh.triangles = static_cast<Triangle*>(mesh.AllocateGeometry(triangleBytes, "Triangles"));
+        if (!mesh.triangles || !ReadSection(file, mesh.triangles, triangleBytes)) {
+            Log::Print("ERROR: Failed to read mesh cache triangles\n");
+            mesh.Clear();
+            fclose(file);
+            return false;
+        }
+    } else {
+        mesh.faceNormals = static_cast<Vector3*>(mesh.AllocateGeometry(normalBytes, "Facet normals"));
+        if (!mesh.faceNormals || !ReadSection(file, mesh.faceNormals, normalBytes)) {
+            Log::Print("ERROR: Failed to read mesh cache facet normals\n");
+            mesh.Clear();
+            fclose(file);
+            return false;
+        }
+    }
+    mesh.triangleCount = static_cast<int>(header.triangleCount);
+
+    if (!mesh.ReportProgress(static_cast<u32>(ftell(file)), header.triangleCount)) {
+        mesh.Clear();
+        fclose(file);
+        return false;
+    }
+
+    if (welded) {
+        mesh.vertices = static_cast<Vector3*>(mesh.AllocateGeometry(vertexBytes, "Vertices"));
+        mesh.indices = mesh.AllocateGeometry(indexBytes, "Indices");
+
+        if (!mesh.vertices || !mesh.indices ||
+            !ReadSection(file, mesh.vertices, vertexBytes) ||
+            !ReadSection(file, mesh.indices, indexBytes)) {
+            Log::Print("ERROR: Failed to read mesh cache vertices\n");
+            mesh.Clear();
+            fclose(file);
+            return false;
+        }
+        mesh.vertexCount = static_cast<int>(header.vertexCount);
+        mesh.shortIndices = (header.indexSize == 2);
+
+        // Every later pass indexes the vertex array without checking
+        u32 cornerCount = header.triangleCount * 3;
+        for (u32 c = 0; c < cornerCount; c++) {
+            if (mesh.GetIndex(static_cast<int>(c)) >= header.vertexCount) {
+                Log::Print("Ignoring invalid mesh cache: %s\n", cachePath.c_str());
+                mesh.Clear();
+                fclose(file);
+                return false;
+            }
+        }
+
+        if ((header.flags & FLAG_RENDER_DATA) && !LoadRenderData(file, header, mesh)) {
+            Log::Print("Ignoring invalid mesh cache: %s\n", cachePath.c_str());
+            mesh.Clear();
+            fclose(file);
+            return false;
+        }
+    }
+
+    long cacheSize = ftell(file);
+    fclose(file);
+
+    mesh.minBounds = header.minBounds;
+    mesh.maxBounds = header.maxBounds;
+
+    mesh.loadStats.bytesRead = cacheSize;
+    mesh.loadStats.triangleCount = mesh.triangleCount;
+    mesh.loadStats.loadMicros = diff_usec(startTime, gettime());
+    mesh.loadStats.binary = true;
+
+    Log::Print("Loaded mesh cache: %s\n", cachePath.c_str());
+    Log::Print("Load time (cache): %.1f ms (%.2f MB/s, %.0f triangles/s)\n",
+           mesh.loadStats.loadMicros / 1000.0f, mesh.loadStats.GetMegabytesPerSecond(),
+           mesh.loadStats.GetTrianglesPerSecond());
+    return true;
+}
+
+bool MeshCache::Save(const std::string& sourcePath, const Mesh& mesh) {
+    MeshCacheWriter writer;
+    bool success = writer.Begin(sourcePath, mesh);
+    while (success && writer.IsActive()) {
+        success = writer.WriteStep(0xffffffff);
+    }
+    return success;
+}
+
+void* MeshCache::ReadArray(FILE* file, Mesh& mesh, u32 size, const char* what) {
+    void* data = mesh.AllocateGeometry(size, what);
+    return (data && ReadSection(file, data, size)) ? data : nullptr;
+}
+
+bool MeshCache::LoadRenderData(FILE* file, const MeshCacheHeader& header, Mesh& mesh) {
+    MeshCacheRenderHeader render;
+    if (!ReadSection(file, &render, sizeof(render))) {
+        return false;
+    }
+
+    const u32 count = render.renderVertexCount;
+    if (count == 0 || count > header.triangleCount * 3 || render.lodCount > Mesh::MAX_LODS ||
+        render.surfaceOrientation < -1 || render.surfaceOrientation > 1 ||
+        render.levels[0].triangleCount != header.triangleCount) {
+        return false;
+    }
+    for (u32 i = 0; i <= render.lodCount; i++) {
+        if (!IsValidLevelCounts(render.levels[i], header.triangleCount)) {
+            return false;
+        }
+    }
+
+    mesh.renderPositions = static_cast<Vector3*>(ReadArray(file, mesh, count * sizeof(Vector3), "Render positions"));
+    mesh.renderNormals = mesh.renderPositions ? static_cast<Vector3*>(
+        ReadArray(file, mesh, count * sizeof(Vector3), "Render normals")) : nullptr;
+    mesh.renderCurvatures = mesh.renderNormals ? static_cast<u8*>(
+        ReadArray(file, mesh, count, "Render curvature")) : nullptr;
+    mesh.renderIndices = mesh.renderCurvatures ? static_cast<u32*>(
+        ReadArray(file, mesh, header.triangleCount * 3 * sizeof(u32), "Render indices")) : nullptr;
+    if (!mesh.renderIndices) {
+        return false;
+    }
+    mesh.renderVertexCount = static_cast<int>(count);
+    mesh.surfaceOrientation = render.surfaceOrientation;
+
+    for (u32 c = 0; c < header.triangleCount * 3; c++) {
+        if (mesh.renderIndices[c] >= count) return false;
+    }
+
+    // Level 0 is the full-detail strips, the rest the levels of detail
+    for (u32 i = 0; i <= render.lodCount; i++) {
+        const MeshCacheLevel& level = render.levels[i];
+        StripSet& strips = (i == 0) ? mesh.strips : mesh.lods[i - 1].strips;
+        ClusterSet& clusters = (i == 0) ? mesh.clusters : mesh.lods[i - 1].clusters;
+
+        strips.indices = static_cast<u32*>(ReadArray(file, mesh, level.indexCount * sizeof(u32), "Strip indices"));
+        strips.primitives = strips.indices ? static_cast<StripPrimitive*>(
+            ReadArray(file, mesh, level.primitiveCount * sizeof(StripPrimitive), "Strip primitives")) : nullptr;
+        if (!strips.primitives) {
+            return false;
+        }
+        strips.indexCount = level.indexCount;
+        strips.primitiveCount = level.primitiveCount;
+        strips.triangleCount = level.triangleCount;
+        strips.stripCount = level.stripCount;
+        strips.fanCount = level.fanCount;
+        strips.looseTriangleCount = level.looseTriangleCount;
+
+        if (level.clusterCount > 0) {
+            clusters.clusters = static_cast<MeshCluster*>(
+                ReadArray(file, mesh, level.clusterCount * sizeof(MeshCluster), "Clusters"));
+            clusters.nodes = clusters.clusters ? static_cast<ClusterNode*>(
+                ReadArray(file, mesh, level.nodeCount * sizeof(ClusterNode), "Cluster nodes")) : nullptr;
+            if (!clusters.nodes) {
+                return false;
+            }
+            clusters.clusterCount = level.clusterCount;
+            clusters.nodeCount = level.nodeCount;
+        }
+
+        if (!IsValidLevel(strips, clusters, count)) {
+            return false;
+        }
+        if (i > 0) {
+            mesh.lods[i - 1].error = level.error;
+            mesh.lodCount = static_cast<int>(i);
+        }
+    }
+    return true;
+}
+
+MeshCacheWriter::MeshCacheWriter() : file(nullptr), sectionCount(0), sectionIndex(0), sectionOffset(0),
+                                     bytesWritten(0) {
+}
+
+MeshCacheWriter::~MeshCacheWriter() {
+    Abort();
+}
+
+bool MeshCacheWriter::Begin(const std::string& sourcePath, const Mesh& mesh) {
+    Abort();
+    if (!mesh.IsValid()) {
+        return false;
+    }
+
+    struct stat sourceStat;
+    if (stat(sourcePath.c_str(), &sourceStat) != 0) {
+        return false;
+    }
+
+    header = MeshCacheHeader();
+    header.version = MeshCache::VERSION;
+    header.sourceSize = static_cast<u32>(sourceStat.st_size);
+    header.sourceModifiedTime = static_cast<u32>(sourceStat.st_mtime);
+    header.triangleCount = static_cast<u32>(mesh.triangleCount);
+    header.vertexCount = mesh.IsIndexed() ? static_cast<u32>(mesh.vertexCount) : 0;
+    header.indexSize = mesh.IsIndexed() ? (mesh.shortIndices ? 2 : 4) : 0;
+    header.flags = (mesh.HasRenderGeometry() && mesh.HasStrips()) ? MeshCache::FLAG_RENDER_DATA : 0;
+    header.minBounds = mesh.minBounds;
+    header.maxBounds = mesh.maxBounds;
+
+    // The magic is written last, so a cache cut short is ignored
+    sectionCount = 0;
+    AddSection(&header, sizeof(header));
+    if (header.indexSize != 0) {
+        AddSection(mesh.faceNormals, header.triangleCount * sizeof(Vector3));
+        AddSection(mesh.vertices, header.vertexCount * sizeof(Vector3));
+        AddSection(mesh.indices, header.triangleCount * 3 * header.indexSize);
+    } else {
+        AddSection(mesh.triangles, header.triangleCount * sizeof(Triangle));
+    }
+    if (header.flags & MeshCache::FLAG_RENDER_DATA) {
+        AddRenderSections(mesh);
+    }
+
+    cachePath = MeshCache::GetCachePath(sourcePath);
+    file = fopen(cachePath.c_str(), "wb");
+    if (!file) {
+        Log::Print("Cannot write mesh cache: %s\n", cachePath.c_str());
+        return false;
+    }
+    sectionIndex = 0;
+    sectionOffset = 0;
+    bytesWritten = 0;
+    return true;
+}
+
+void MeshCacheWriter::AddRenderSections(const Mesh& mesh) {
+    render = MeshCacheRenderHeader();
+    render.renderVertexCount = static_cast<u32>(mesh.renderVertexCount);
+    render.surfaceOrientation = mesh.surfaceOrientation;
+    render.lodCount = static_cast<u32>(mesh.lodCount);
+    for (u32 i = 0; i <= render.lodCount; i++) {
+        const StripSet& strips = (i == 0) ? mesh.strips : mesh.lods[i - 1].strips;
+        const ClusterSet& clusters = (i == 0) ? mesh.clusters : mesh.lods[i - 1].clusters;
+        MeshCacheLevel& level = render.levels[i];
+        level.indexCount = strips.indexCount;
+        level.primitiveCount = strips.primitiveCount;
+        level.triangleCount = strips.triangleCount;
+        level.stripCount = strips.stripCount;
+        level.fanCount = strips.fanCount;
+        level.looseTriangleCount = strips.looseTriangleCount;
+        level.clusterCount = clusters.clusterCount;
+        level.nodeCount = clusters.nodeCount;
+        level.error = (i == 0) ? 0.0f : mesh.lods[i - 1].error;
+    }
+
+    const u32 count = render.renderVertexCount;
+    AddSection(&render, sizeof(render));
+    AddSection(mesh.renderPositions, count * sizeof(Vector3));
+    AddSection(mesh.renderNormals, count * sizeof(Vector3));
+    AddSection(mesh.renderCurvatures, count);
+    AddSection(mesh.renderIndices, mesh.triangleCount * 3 * sizeof(u32));
+
+    for (u32 i = 0; i <= render.lodCount; i++) {
+        const StripSet& strips = (i == 0) ? mesh.strips : mesh.lods[i - 1].strips;
+        const ClusterSet& clusters = (i == 0) ? mesh.clusters : mesh.lods[i - 1].clusters;
+        AddSection(strips.indices, strips.indexCount * sizeof(u32));
+        AddSection(strips.primitives, strips.primitiveCount * sizeof(StripPrimitive));
+        if (clusters.clusterCount != 0) {
+            AddSection(clusters.clusters, clusters.clusterCount * sizeof(MeshCluster));
+            AddSection(clusters.nodes, clusters.nodeCount * sizeof(ClusterNode));
+        }
+    }
+}
+
+void MeshCacheWriter::AddSection(const void* data, u32 size) {
+    sections[sectionCount].data = static_cast<const u8*>(data);
+    sections[sectionCount].size = size;
+    sectionCount++;
+}
+
+bool MeshCacheWriter::WriteStep(u32 maxBytes) {
+    static const u8 zeros[MeshCache::SECTION_ALIGNMENT] = {0};
+
+    if (!file) {
+        return false;
+    }
+
+    // Section data, then the padding to the next section
+    bool success = true;
+    while (success && maxBytes > 0 && sectionIndex < sectionCount) {
+        const Section& section = sections[sectionIndex];
+        if (sectionOffset < section.size) {
+            u32 size = section.size - sectionOffset;
+            if (size > maxBytes) size = maxBytes;
+            success = fwrite(section.data + sectionOffset, 1, size, file) == size;
+            sectionOffset += size;
+            bytesWritten += size;
+            maxBytes -= size;
+        } else {
+            u32 padding = AlignSection(section.size) - section.size;
+            success = padding == 0 || fwrite(zeros, 1, padding, file) == padding;
+            bytesWritten += padding;
+            sectionIndex++;
+            sectionOffset = 0;
+        }
+    }
+    if (success && sectionIndex < sectionCount) {
+        return true;
+    }
+
+    if (success) {
+        header.magic = MeshCache::MAGIC;
+        success = fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, 1, sizeof(header), file) == sizeof(header);
+    }
+    if (fclose(file) != 0) {
+        success = false;
+    }
+    file = nullptr;
+
+    if (!success) {
+        Log::Print("ERROR: Failed to write mesh cache: %s\n", cachePath.c_str());
+        remove(cachePath.c_str());
+        return false;
+    }
+
+    Log::Print("Wrote mesh cache: %s (%u KB)\n", cachePath.c_str(), bytesWritten / 1024);
+    return true;
+}
+
+void MeshCacheWriter::Abort() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+        remove(cachePath.c_str());
+        Log::Print("Abandoned mesh cache: %s\n", cachePath.c_str());
+    }
+}
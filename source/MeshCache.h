@@ -0,0 +1,139 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "Platform.h"
+#include <cstdio>
+#include <string>
+#include "Mesh.h"
+
+/**
+ * On-disk header of a preprocessed mesh cache (.gcm) file. A welded mesh
+ * is followed by its facet normals, vertices and indices, anything else by
+ * its triangle soup; each section starts on a 32-byte boundary.
+ */
+struct MeshCacheHeader {
+    u32 magic;
+    u32 version;
+    u32 sourceSize;
+    u32 sourceModifiedTime;
+    u32 triangleCount;
+    u32 vertexCount;
+    u32 indexSize;      // 0 for a triangle soup, otherwise 2 or 4 for a welded mesh
+    u32 flags;          // MeshCache::FLAG_*
+    Vector3 minBounds;
+    Vector3 maxBounds;
+    u32 reserved[2];
+};
+
+static_assert(sizeof(MeshCacheHeader) == 64, "MeshCacheHeader must stay 64 bytes");
+
+/**
+ * Counts of one level's strips and clusters in a mesh cache
+ */
+struct MeshCacheLevel {
+    u32 indexCount;
+    u32 primitiveCount;
+    u32 triangleCount;
+    u32 stripCount;
+    u32 fanCount;
+    u32 looseTriangleCount;
+    u32 clusterCount;
+    u32 nodeCount;
+    f32 error;
+    u32 reserved[3];
+};
+
+/**
+ * Render data of a welded mesh, stored after its welded arrays when
+ * FLAG_RENDER_DATA is set. It is followed by the render positions,
+ * normals, curvatures and indices in vertex cache order, then by the strip
+ * indices, primitives, clusters and cluster nodes of each level from full
+ * detail down.
+ */
+struct MeshCacheRenderHeader {
+    u32 renderVertexCount;
+    s32 surfaceOrientation;
+    u32 lodCount;
+    u32 reserved;
+    MeshCacheLevel levels[Mesh::MAX_LODS + 1];
+};
+
+static_assert(sizeof(MeshCacheRenderHeader) == 256, "MeshCacheRenderHeader must stay 256 bytes");
+
+/**
+ * Sidecar cache holding already decoded, native-endian mesh geometry so
+ * repeat loads of a model skip STL parsing entirely. Once a model has been
+ * stripified the cache also holds everything derived from its welded form
+ * except the quantized vertices, which are cheap to rebuild.
+ */
+class MeshCache {
+public:
+    static std::string GetCachePath(const std::string& sourcePath);
+
+    // Load a cache that matches the source file's size and modification time
+    static bool Load(const std::string& sourcePath, Mesh& mesh);
+    // Write the cache in one go; see MeshCacheWriter for an incremental write
+    static bool Save(const std::string& sourcePath, const Mesh& mesh);
+
+    static const u32 MAGIC = 0x47434D31; // 'GCM1'
+    static const u32 VERSION = 3;
+    static const u32 SECTION_ALIGNMENT = 32;
+    static const u32 FLAG_RENDER_DATA = 1;
+
+private:
+    static void* ReadArray(FILE* file, Mesh& mesh, u32 size, const char* what);
+    static bool LoadRenderData(FILE* file, const MeshCacheHeader& header, Mesh& mesh);
+};
+
+/**
+ * Writes a mesh cache a bounded number of bytes at a time, so a
+ * multi-megabyte sidecar can be spread over idle frames. The mesh must not
+ * change until the write completes or is aborted. The header's magic is
+ * written last, so a cache that was cut short is never loaded.
+ */
+class MeshCacheWriter {
+public:
+    MeshCacheWriter();
+    ~MeshCacheWriter();
+
+    // Open the cache file and lay out the mesh's sections
+    bool Begin(const std::string& sourcePath, const Mesh& mesh);
+
+    // Write up to maxBytes, completing the file once every section is out.
+    // Returns false if writing failed, which removes the file.
+    bool WriteStep(u32 maxBytes);
+
+    // Stop a write in progress and remove the partial file
+    void Abort();
+
+    bool IsActive() const { return file != nullptr; }
+
+private:
+    struct Section {
+        const u8* data;
+        u32 size;
+    };
+
+    // Header, welded arrays or soup, then the render header, four render
+    // arrays and up to four arrays for each level
+    static const int MAX_SECTIONS = 9 + (Mesh::MAX_LODS + 1) * 4;
+
+    FILE* file;
+    std::string cachePath;
+    MeshCacheHeader header;
+    MeshCacheRenderHeader render;
+    Section sections[MAX_SECTIONS];
+    int sectionCount;
+    int sectionIndex;
+    u32 sectionOffset;
+    u32 bytesWritten;
+
+    void AddRenderSections(const Mesh& mesh);
+    void AddSection(const void* data, u32 size);
+
+    // Non-copyable
+    MeshCacheWriter(const MeshCacheWriter&);
+    MeshCacheWriter& operator=(const MeshCacheWriter&);
+};
+
+#endif // MESH_CACHE_H
@@ -0,0 +1,171 @@
+#include "MeshLoadJob.h"
+#include "MeshCache.h"
+#include "MemorySystem.h"
+#include "VertexCacheOptimizer.h"
+#include <cstdio>
+
+// Vertices closer than this fraction of the model size are welded together
+static const f32 WELD_TOLERANCE = 1e-5f;
+
+// Faces meeting at a sharper angle than this keep separate vertex normals
+static const f32 CREASE_ANGLE = 30.0f;
+
+// Bytes of the cache sidecar written per deferred step
+static const u32 CACHE_WRITE_CHUNK = 64 * 1024;
+
+MeshLoadJob::MeshLoadJob() : mesh(nullptr), phase(PHASE_IDLE), succeeded(false),
+                             cachePending(false) {
+}
+
+MeshLoadJob::~MeshLoadJob() {
+    Cancel();
+    Finish();
+}
+
+bool MeshLoadJob::Start(const std::string& filePath, Mesh* targetMesh) {
+    if (IsRunning() || !targetMesh) {
+        return false;
+    }
+
+    // The sidecar of the previous model reads the mesh about to be replaced
+    cacheWriter.Abort();
+
+    path = filePath;
+    mesh = targetMesh;
+    progress.Reset();
+    succeeded = false;
+    cachePending = false;
+    phase = PHASE_READING;
+
+    mesh->SetLoadProgress(&progress);
+    log.Clear();
+    Log::BeginCapture(&log);
+    if (!thread.Start(ThreadEntry, this)) {
+        Log::EndCapture();
+        printf("ERROR: Failed to start loader thread\n");
+        mesh->SetLoadProgress(nullptr);
+        phase = PHASE_IDLE;
+        return false;
+    }
+    return true;
+}
+
+void MeshLoadJob::Cancel() {
+    if (IsRunning()) {
+        progress.cancelRequested = true;
+    }
+}
+
+bool MeshLoadJob::Finish() {
+    if (!IsRunning()) {
+        return false;
+    }
+
+    thread.Join();
+    Log::EndCapture();
+    log.Flush();
+    MemorySystem::PrintReport();
+
+    mesh->SetLoadProgress(nullptr);
+    phase = PHASE_IDLE;
+    if (!succeeded) {
+        cachePending = false;
+    }
+    return succeeded;
+}
+
+bool MeshLoadJob::RunDeferredStep() {
+    if (IsRunning()) {
+        return false;
+    }
+
+    if (cachePending) {
+        cachePending = false;
+        return cacheWriter.Begin(path, *mesh);
+    }
+    if (cacheWriter.IsActive()) {
+        cacheWriter.WriteStep(CACHE_WRITE_CHUNK);
+        return true;
+    }
+    return false;
+}
+
+void MeshLoadJob::FlushDeferredWork() {
+    if (IsRunning()) {
+        return;
+    }
+
+    while (RunDeferredStep()) {
+    }
+}
+
+const char* MeshLoadJob::GetPhaseName() const {
+    switch (phase) {
+        case PHASE_READING:  return "Reading";
+        case PHASE_WELDING:  return "Welding vertices";
+        case PHASE_STRIPPING: return "Building strips";
+        case PHASE_SIMPLIFYING: return "Building levels of detail";
+        case PHASE_FINISHED: return "Done";
+        default:             return "Idle";
+    }
+}
+
+void* MeshLoadJob::ThreadEntry(void* arg) {
+    static_cast<MeshLoadJob*>(arg)->Execute();
+    return nullptr;
+}
+
+void MeshLoadJob::Execute() {
+    // Prefer the preprocessed sidecar; parse and weld the STL otherwise
+    bool loaded = MeshCache::Load(path, *mesh);
+    if (!loaded && !progress.cancelRequested && mesh->LoadFromSTL(path.c_str())) {
+        // Optional: a failed weld leaves the triangle array usable
+        phase = PHASE_WELDING;
+        mesh->Weld(mesh->GetMaxSize() * WELD_TOLERANCE);
+
+        // Written once the model is on screen, with everything the passes
+        // below have built
+        cachePending = true;
+        loaded = true;
+    }
+
+    if (loaded && progress.cancelRequested) {
+        mesh->Clear();
+        loaded = false;
+    }
+
+    if (loaded) {
+        // Optional: strips need the welded connectivity. A cache written
+        // after a previous load already holds them.
+        if (mesh->IsIndexed() && !mesh->HasStrips()) {
+            phase = PHASE_STRIPPING;
+            if (mesh->BuildRenderGeometry(CREASE_ANGLE)) {
+                mesh->OptimizeVertexCache(VertexCacheOptimizer::DEFAULT_CACHE_SIZE);
+                mesh->BuildClusters();
+                mesh->BuildStrips();
+            }
+        }
+
+        // Optional: levels of detail over the render vertices, built here
+        // rather than on the main thread so the first frames never stall,
+        // unless the cache held them
+        if (mesh->HasRenderGeometry() && mesh->GetLodCount() == 0 && !progress.cancelRequested) {
+            phase = PHASE_SIMPLIFYING;
+            mesh->BuildLods();
+        }
+
+        // Submit s16/s8 vertices when the model fits; floats otherwise
+        if (mesh->HasRenderGeometry()) {
+            mesh->Quantize();
+        }
+
+        // The passes above do not poll for cancellation, so check again
+        if (progress.cancelRequested) {
+            mesh->Clear();
+            loaded = false;
+        }
+    }
+
+    succeeded = loaded;
+    phase = PHASE_FINISHED;
+}
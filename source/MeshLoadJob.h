@@ -0,0 +1,71 @@
+#ifndef MESH_LOAD_JOB_H
+#define MESH_LOAD_JOB_H
+
+#include <string>
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "Log.h"
+#include "Thread.h"
+
+/**
+ * Loads and preprocesses a mesh on a background thread so the main loop
+ * can keep drawing progress and accept cancellation. The thread prints
+ * nothing itself: its messages are captured and printed by Finish, along
+ * with the arena report. Writing the cache sidecar, which the first frame
+ * does not need, is left for the main thread to run a chunk at a time
+ * while the viewer or the menu is idle.
+ */
+class MeshLoadJob {
+public:
+    enum Phase {
+        PHASE_IDLE = 0,
+        PHASE_READING,
+        PHASE_WELDING,
+        PHASE_STRIPPING,
+        PHASE_SIMPLIFYING,
+        PHASE_FINISHED
+    };
+
+    MeshLoadJob();
+    ~MeshLoadJob();
+
+    // Begin loading into mesh; the mesh must not be used until Finish()
+    bool Start(const std::string& path, Mesh* mesh);
+    void Cancel();
+
+    bool IsRunning() const { return thread.IsStarted(); }
+    bool IsFinished() const { return phase == PHASE_FINISHED; }
+
+    // Join the worker thread, print its messages and return whether the
+    // mesh loaded
+    bool Finish();
+
+    const MeshLoadProgress& GetProgress() const { return progress; }
+    Phase GetPhase() const { return phase; }
+    const char* GetPhaseName() const;
+    bool WasCancelled() const { return progress.cancelRequested; }
+
+    // Deferred work of the last successful load, run one bounded step at a
+    // time on the main thread. RunDeferredStep returns false if nothing was
+    // left. FlushDeferredWork finishes it at once, for shutdown; starting
+    // the next load abandons what is left.
+    bool HasDeferredWork() const { return cachePending || cacheWriter.IsActive(); }
+    bool RunDeferredStep();
+    void FlushDeferredWork();
+
+private:
+    Thread thread;
+    std::string path;
+    Mesh* mesh;
+    MeshLoadProgress progress;
+    LogBuffer log;
+    volatile Phase phase;
+    bool succeeded;
+    bool cachePending;
+    MeshCacheWriter cacheWriter;
+
+    static void* ThreadEntry(void* arg);
+    void Execute();
+};
+
+#endif // MESH_LOAD_JOB_H
@@ -0,0 +1,523 @@
+#include "MeshSimplifier.h"
+#include "Mesh.h"
+#include "Log.h"
+#include <cstring>
+#include <cmath>
+
+namespace {
+
+const u32 EMPTY = 0xffffffff;
+const f32 NO_COLLAPSE = 1e30f;
+
+// Vertices with more neighbors than this are left in place until
+// collapses around them lower the count
+const int MAX_VALENCE = 64;
+
+enum VertexFlags {
+    VERTEX_LOCKED = 1,
+    VERTEX_REMOVED = 2
+};
+
+/**
+ * Symmetric 4x4 error quadric, upper triangle only
+ */
+struct Quadric {
+    f32 a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+
+    void Clear() {
+        a00 = a01 = a02 = a03 = a11 = a12 = a13 = a22 = a23 = a33 = 0.0f;
+    }
+
+    void AddPlane(f32 nx, f32 ny, f32 nz, f32 d) {
+        a00 += nx * nx; a01 += nx * ny; a02 += nx * nz; a03 += nx * d;
+        a11 += ny * ny; a12 += ny * nz; a13 += ny * d;
+        a22 += nz * nz; a23 += nz * d;
+        a33 += d * d;
+    }
+
+    void Add(const Quadric& q) {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+        a11 += q.a11; a12 += q.a12; a13 += q.a13;
+        a22 += q.a22; a23 += q.a23;
+        a33 += q.a33;
+    }
+
+    // Sum of squared distances from p to the accumulated planes
+    f32 Evaluate(const Vector3& p) const {
+        f32 error = a00 * p.x * p.x + 2.0f * a01 * p.x * p.y + 2.0f * a02 * p.x * p.z + 2.0f * a03 * p.x +
+                    a11 * p.y * p.y + 2.0f * a12 * p.y * p.z + 2.0f * a13 * p.y +
+                    a22 * p.z * p.z + 2.0f * a23 * p.z +
+                    a33;
+        return error > 0.0f ? error : 0.0f;
+    }
+};
+
+/**
+ * Working state of one simplification run. Render vertices sharing a
+ * position are simplified as one, identified by the first of them, so
+ * creases never open into cracks. Triangles are edited in place;
+ * each vertex keeps a singly linked list of the corners that reference it,
+ * and collapsing u into v splices u's list onto v's. Corners of removed
+ * triangles are skipped lazily.
+ */
+struct Simplifier {
+    const Vector3* positions;
+    const Vector3* normals;
+    const u32* indices;
+    u32 vertexCount;
+    u32 triangleCount;
+    Vector3 center;
+    f32 invScale;
+
+    u32* triangles;     // Working indices by position; removed ones start with EMPTY
+    u32* groupFirst;    // First render vertex at each vertex's position
+    u32* groupNext;     // Render vertices at the same position, linked from the first
+    u32* cornerHead;
+    u32* cornerTail;
+    u32* cornerNext;
+    Quadric* quadrics;
+    u8* flags;
+    u32* target;        // Best collapse target per vertex
+    f32* cost;
+    u32* heap;          // Min-heap of vertices by cost
+    u32* heapIndex;
+    u32 heapSize;
+
+    Vector3 Position(u32 v) const {
+        const Vector3& p = positions[v];
+        return Vector3((p.x - center.x) * invScale, (p.y - center.y) * invScale, (p.z - center.z) * invScale);
+    }
+
+    bool IsLive(u32 triangle) const {
+        return triangles[triangle * 3] != EMPTY;
+    }
+
+    // Distinct neighbors through live triangles; returns -1 past MAX_VALENCE
+    int GatherNeighbors(u32 v, u32* neighbors, u8* edgeUse) const {
+        int count = 0;
+        for (u32 c = cornerHead[v]; c != EMPTY; c = cornerNext[c]) {
+            u32 t = c / 3;
+            if (!IsLive(t) || triangles[c] != v) continue;
+
+            for (int k = 1; k <= 2; k++) {
+                u32 w = triangles[t * 3 + (c % 3 + k) % 3];
+                int i = 0;
+                while (i < count && neighbors[i] != w) i++;
+                if (i == count) {
+                    if (count == MAX_VALENCE) return -1;
+                    neighbors[count] = w;
+                    edgeUse[count] = 0;
+                    count++;
+                }
+                if (edgeUse[i] < 255) edgeUse[i]++;
+            }
+        }
+        return count;
+    }
+
+    // Moving u onto v must keep every surviving triangle facing the same way
+    bool PreservesOrientation(u32 u, u32 v) const {
+        Vector3 pv = Position(v);
+        for (u32 c = cornerHead[u]; c != EMPTY; c = cornerNext[c]) {
+            u32 t = c / 3;
+            if (!IsLive(t) || triangles[c] != u) continue;
+
+            u32 a = triangles[t * 3 + (c % 3 + 1) % 3];
+            u32 b = triangles[t * 3 + (c % 3 + 2) % 3];
+            if (a == v || b == v) continue;  // Removed by the collapse
+
+            Vector3 pu = Position(u);
+            Vector3 pa = Position(a);
+            Vector3 pb = Position(b);
+            Vector3 before = Cross(pa, pb, pu);
+            Vector3 after = Cross(pa, pb, pv);
+            if (before.x * after.x + before.y * after.y + before.z * after.z <= 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Normal of triangle (p, a, b), unnormalized
+    static Vector3 Cross(const Vector3& a, const Vector3& b, const Vector3& p) {
+        f32 e1x = a.x - p.x, e1y = a.y - p.y, e1z = a.z - p.z;
+        f32 e2x = b.x - p.x, e2y = b.y - p.y, e2z = b.z - p.z;
+        return Vector3(e1y * e2z - e1z * e2y, e1z * e2x - e1x * e2z, e1x * e2y - e1y * e2x);
+    }
+
+    // An interior edge may only collapse if its endpoints share exactly the
+    // two neighbors opposite it; more would pinch the surface. The first
+    // endpoint comes in as its gathered neighbors.
+    bool SatisfiesLinkCondition(u32 v, const u32* uNeighbors, int uCount) const {
+        u32 vNeighbors[MAX_VALENCE];
+        u8 vEdgeUse[MAX_VALENCE];
+        int vCount = GatherNeighbors(v, vNeighbors, vEdgeUse);
+        if (vCount < 0) return false;
+
+        int shared = 0;
+        for (int i = 0; i < uCount; i++) {
+            for (int j = 0; j < vCount; j++) {
+                if (uNeighbors[i] == vNeighbors[j]) shared++;
+            }
+        }
+        return shared == 2;
+    }
+
+    // Render vertex for a corner of a surviving triangle. If collapses moved
+    // the corner to another position, take the render vertex there whose
+    // normal is closest to the corner's original one.
+    u32 GetRenderVertex(u32 corner) const {
+        u32 original = indices[corner];
+        u32 position = triangles[corner];
+        if (groupFirst[original] == position) return original;
+
+        const Vector3& n = normals[original];
+        u32 best = position;
+        f32 bestAgreement = -2.0f;
+        for (u32 r = position; r != EMPTY; r = groupNext[r]) {
+            f32 agreement = n.x * normals[r].x + n.y * normals[r].y + n.z * normals[r].z;
+            if (agreement > bestAgreement) {
+                bestAgreement = agreement;
+                best = r;
+            }
+        }
+        return best;
+    }
+
+    // Rechecked before each collapse, as neighbors may have moved since u
+    // was scored
+    bool IsCollapseValid(u32 u, u32 v) const {
+        if (flags[v] & VERTEX_REMOVED) return false;
+
+        u32 neighbors[MAX_VALENCE];
+        u8 edgeUse[MAX_VALENCE];
+        int count = GatherNeighbors(u, neighbors, edgeUse);
+        return count >= 0 && PreservesOrientation(u, v) && SatisfiesLinkCondition(v, neighbors, count);
+    }
+
+    // Pick the cheapest valid neighbor to collapse u into
+    void EvaluateVertex(u32 u) {
+        target[u] = EMPTY;
+        cost[u] = NO_COLLAPSE;
+        if (flags[u] & (VERTEX_LOCKED | VERTEX_REMOVED)) return;
+
+        u32 neighbors[MAX_VALENCE];
+        u8 edgeUse[MAX_VALENCE];
+        int count = GatherNeighbors(u, neighbors, edgeUse);
+        if (count < 0) return;
+
+        // Boundary and non-manifold vertices stay put for good
+        bool interior = (count > 0);
+        for (int i = 0; i < count && interior; i++) {
+            interior = (edgeUse[i] == 2);
+        }
+        if (!interior) {
+            flags[u] |= VERTEX_LOCKED;
+            return;
+        }
+
+        Quadric q = quadrics[u];
+        for (int i = 0; i < count; i++) {
+            u32 v = neighbors[i];
+            Quadric combined = q;
+            combined.Add(quadrics[v]);
+            f32 error = combined.Evaluate(Position(v));
+            if (error >= cost[u]) continue;
+
+            if (PreservesOrientation(u, v) && SatisfiesLinkCondition(v, neighbors, count)) {
+                cost[u] = error;
+                target[u] = v;
+            }
+        }
+    }
+
+    void HeapSwap(u32 i, u32 j) {
+        u32 a = heap[i];
+        heap[i] = heap[j];
+        heap[j] = a;
+        heapIndex[heap[i]] = i;
+        heapIndex[heap[j]] = j;
+    }
+
+    void HeapUp(u32 i) {
+        while (i > 0 && cost[heap[(i - 1) / 2]] > cost[heap[i]]) {
+            HeapSwap(i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+    }
+
+    void HeapDown(u32 i) {
+        for (;;) {
+            u32 smallest = i;
+            u32 left = i * 2 + 1;
+            u32 right = left + 1;
+            if (left < heapSize && cost[heap[left]] < cost[heap[smallest]]) smallest = left;
+            if (right < heapSize && cost[heap[right]] < cost[heap[smallest]]) smallest = right;
+            if (smallest == i) return;
+            HeapSwap(i, smallest);
+            i = smallest;
+        }
+    }
+
+    void HeapRemove(u32 v) {
+        u32 i = heapIndex[v];
+        if (i == EMPTY) return;
+        heapSize--;
+        if (i != heapSize) {
+            HeapSwap(i, heapSize);
+            HeapUp(i);
+            HeapDown(i);
+        }
+        heapIndex[v] = EMPTY;
+    }
+
+    // Re-score a vertex and move it within, into or out of the heap
+    void UpdateVertex(u32 v) {
+        EvaluateVertex(v);
+        if (target[v] == EMPTY) {
+            HeapRemove(v);
+        } else if (heapIndex[v] == EMPTY) {
+            heap[heapSize] = v;
+            heapIndex[v] = heapSize++;
+            HeapUp(heapIndex[v]);
+        } else {
+            HeapUp(heapIndex[v]);
+            HeapDown(heapIndex[v]);
+        }
+    }
+
+    // Collapse u into v; returns the number of triangles removed
+    u32 Collapse(u32 u, u32 v) {
+        u32 removed = 0;
+        for (u32 c = cornerHead[u]; c != EMPTY; c = cornerNext[c]) {
+            u32 t = c / 3;
+            if (!IsLive(t) || triangles[c] != u) continue;
+
+            u32 a = triangles[t * 3 + (c % 3 + 1) % 3];
+            u32 b = triangles[t * 3 + (c % 3 + 2) % 3];
+            if (a == v || b == v) {
+                triangles[t * 3] = EMPTY;
+                removed++;
+            } else {
+                triangles[c] = v;
+            }
+        }
+
+        if (cornerHead[u] != EMPTY) {
+            if (cornerHead[v] == EMPTY) {
+                cornerHead[v] = cornerHead[u];
+            } else {
+                cornerNext[cornerTail[v]] = cornerHead[u];
+            }
+            cornerTail[v] = cornerTail[u];
+        }
+
+        quadrics[v].Add(quadrics[u]);
+        flags[u] |= VERTEX_REMOVED;
+        HeapRemove(u);
+
+        // Costs change around v: its quadric grew and its neighbors' best
+        // target may have been u
+        u32 neighbors[MAX_VALENCE];
+        u8 edgeUse[MAX_VALENCE];
+        int count = GatherNeighbors(v, neighbors, edgeUse);
+        UpdateVertex(v);
+        for (int i = 0; i < count; i++) {
+            UpdateVertex(neighbors[i]);
+        }
+        return removed;
+    }
+};
+
+} // namespace
+
+int MeshSimplifier::BuildLevels(const Vector3* positions, const Vector3* normals, u32 vertexCount,
+                                const u32* indices, u32 triangleCount,
+                                const u32* targetTriangles, int levelCount,
+                                Arena& arena, SimplifiedLevel* levels) {
+    if (!positions || !normals || !indices || triangleCount == 0 || levelCount <= 0) {
+        return 0;
+    }
+
+    const u32 cornerCount = triangleCount * 3;
+    u32 hashSize = 1;
+    while (hashSize < vertexCount * 2) hashSize <<= 1;
+    u32 outputCount = 0;
+    for (int i = 0; i < levelCount; i++) {
+        outputCount += targetTriangles[i] * 3;
+    }
+
+    // Working tables sit above the marker, followed by the level output;
+    // once done the output is moved down over them
+    u32 marker = arena.GetMarker();
+    Simplifier s;
+    s.triangles = static_cast<u32*>(arena.Allocate(cornerCount * sizeof(u32)));
+    s.cornerNext = static_cast<u32*>(arena.Allocate(cornerCount * sizeof(u32)));
+    s.cornerHead = static_cast<u32*>(arena.Allocate(vertexCount * sizeof(u32)));
+    s.cornerTail = static_cast<u32*>(arena.Allocate(vertexCount * sizeof(u32)));
+    s.quadrics = static_cast<Quadric*>(arena.Allocate(vertexCount * sizeof(Quadric)));
+    s.flags = static_cast<u8*>(arena.Allocate(vertexCount));
+    s.target = static_cast<u32*>(arena.Allocate(vertexCount * sizeof(u32)));
+    s.cost = static_cast<f32*>(arena.Allocate(vertexCount * sizeof(f32)));
+    s.heap = static_cast<u32*>(arena.Allocate(vertexCount * sizeof(u32)));
+    s.heapIndex = static_cast<u32*>(arena.Allocate(vertexCount * sizeof(u32)));
+    s.groupFirst = static_cast<u32*>(arena.Allocate(vertexCount * sizeof(u32)));
+    s.groupNext = static_cast<u32*>(arena.Allocate(vertexCount * sizeof(u32)));
+    u32* hashTable = static_cast<u32*>(arena.Allocate(hashSize * sizeof(u32)));
+    u32* output = static_cast<u32*>(arena.Allocate(outputCount * sizeof(u32)));
+    if (!output || !hashTable || !s.groupNext || !s.groupFirst ||
+        !s.heapIndex || !s.heap || !s.cost || !s.target || !s.flags ||
+        !s.quadrics || !s.cornerTail || !s.cornerHead || !s.cornerNext || !s.triangles) {
+        Log::Print("ERROR: Simplification needs more than the %u KB free in the mesh arena\n",
+               (arena.GetCapacity() - marker) / 1024);
+        arena.ResetToMarker(marker);
+        return 0;
+    }
+
+    // Work in coordinates normalized to the model size so errors are well
+    // conditioned in single precision
+    Vector3 minimum = positions[0];
+    Vector3 maximum = positions[0];
+    for (u32 v = 1; v < vertexCount; v++) {
+        const Vector3& p = positions[v];
+        if (p.x < minimum.x) minimum.x = p.x;
+        if (p.y < minimum.y) minimum.y = p.y;
+        if (p.z < minimum.z) minimum.z = p.z;
+        if (p.x > maximum.x) maximum.x = p.x;
+        if (p.y > maximum.y) maximum.y = p.y;
+        if (p.z > maximum.z) maximum.z = p.z;
+    }
+    f32 extent = maximum.x - minimum.x;
+    if (maximum.y - minimum.y > extent) extent = maximum.y - minimum.y;
+    if (maximum.z - minimum.z > extent) extent = maximum.z - minimum.z;
+    if (extent <= 0.0f) extent = 1.0f;
+
+    s.positions = positions;
+    s.normals = normals;
+    s.indices = indices;
+    s.vertexCount = vertexCount;
+    s.triangleCount = triangleCount;
+    s.center = Vector3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f,
+                       (minimum.z + maximum.z) * 0.5f);
+    s.invScale = 1.0f / extent;
+    s.heapSize = 0;
+
+    // Render vertices were split from welded ones, so a position shared
+    // by several of them matches exactly
+    memset(hashTable, 0xff, hashSize * sizeof(u32));
+    for (u32 v = 0; v < vertexCount; v++) {
+        u32 bits[3];
+        memcpy(bits, &positions[v], sizeof(bits));
+        u32 slot = ((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u)) & (hashSize - 1);
+        while (hashTable[slot] != EMPTY && memcmp(&positions[hashTable[slot]], &positions[v], sizeof(Vector3)) != 0) {
+            slot = (slot + 1) & (hashSize - 1);
+        }
+
+        s.groupNext[v] = EMPTY;
+        if (hashTable[slot] == EMPTY) {
+            hashTable[slot] = v;
+            s.groupFirst[v] = v;
+        } else {
+            // Keep the list in vertex order behind the first member
+            u32 first = hashTable[slot];
+            u32 last = first;
+            while (s.groupNext[last] != EMPTY) last = s.groupNext[last];
+            s.groupNext[last] = v;
+            s.groupFirst[v] = first;
+        }
+    }
+
+    for (u32 c = 0; c < cornerCount; c++) {
+        s.triangles[c] = s.groupFirst[indices[c]];
+    }
+    memset(s.cornerHead, 0xff, vertexCount * sizeof(u32));
+    memset(s.flags, 0, vertexCount);
+    memset(s.heapIndex, 0xff, vertexCount * sizeof(u32));
+    for (u32 v = 0; v < vertexCount; v++) {
+        s.quadrics[v].Clear();
+    }
+
+    // Corner lists and one plane per triangle on each of its vertices
+    for (u32 c = 0; c < cornerCount; c++) {
+        u32 v = s.triangles[c];
+        s.cornerNext[c] = EMPTY;
+        if (s.cornerHead[v] == EMPTY) {
+            s.cornerHead[v] = c;
+        } else {
+            s.cornerNext[s.cornerTail[v]] = c;
+        }
+        s.cornerTail[v] = c;
+    }
+
+    u32 liveTriangles = 0;
+    for (u32 t = 0; t < triangleCount; t++) {
+        const u32* tri = s.triangles + t * 3;
+        if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+            s.triangles[t * 3] = EMPTY;
+            continue;
+        }
+        liveTriangles++;
+
+        Vector3 p0 = s.Position(tri[0]);
+        Vector3 n = Simplifier::Cross(s.Position(tri[1]), s.Position(tri[2]), p0);
+        f32 length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+        if (length <= 0.0f) continue;
+
+        n.x /= length;
+        n.y /= length;
+        n.z /= length;
+        f32 d = -(n.x * p0.x + n.y * p0.y + n.z * p0.z);
+        for (int k = 0; k < 3; k++) {
+            s.quadrics[tri[k]].AddPlane(n.x, n.y, n.z, d);
+        }
+    }
+
+    for (u32 v = 0; v < vertexCount; v++) {
+        s.UpdateVertex(v);
+    }
+
+    // Collapse the cheapest vertex until each target is met in turn
+    int produced = 0;
+    u32* cursor = output;
+    f32 worstCost = 0.0f;
+    while (produced < levelCount) {
+        if (liveTriangles <= targetTriangles[produced]) {
+            SimplifiedLevel& level = levels[produced++];
+            level.indices = cursor;
+            level.triangleCount = 0;
+            level.error = sqrtf(worstCost) * extent;
+            for (u32 t = 0; t < triangleCount; t++) {
+                if (!s.IsLive(t)) continue;
+                cursor[0] = s.GetRenderVertex(t * 3);
+                cursor[1] = s.GetRenderVertex(t * 3 + 1);
+                cursor[2] = s.GetRenderVertex(t * 3 + 2);
+                cursor += 3;
+                level.triangleCount++;
+            }
+            continue;
+        }
+
+        if (s.heapSize == 0) {
+            break;  // Everything left is locked or would fold over
+        }
+
+        u32 u = s.heap[0];
+        if (!s.IsCollapseValid(u, s.target[u])) {
+            s.UpdateVertex(u);
+            continue;
+        }
+        if (s.cost[u] > worstCost) worstCost = s.cost[u];
+        liveTriangles -= s.Collapse(u, s.target[u]);
+    }
+
+    // Release the working tables and move the levels down in their place
+    u32 used = static_cast<u32>(cursor - output);
+    arena.ResetToMarker(marker);
+    u32* compacted = static_cast<u32*>(arena.Allocate(used * sizeof(u32)));
+    memmove(compacted, output, used * sizeof(u32));
+    for (int i = 0; i < produced; i++) {
+        levels[i].indices = compacted + (levels[i].indices - output);
+    }
+
+    return produced;
+}
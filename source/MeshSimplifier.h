@@ -0,0 +1,38 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include "Platform.h"
+#include "Arena.h"
+#include "Vector3.h"
+
+/**
+ * One simplified level: a triangle list over the original vertices
+ */
+struct SimplifiedLevel {
+    u32* indices;
+    u32 triangleCount;
+    f32 error;          // Largest quadric error so far, as a distance in model units
+};
+
+/**
+ * Quadric error metric simplifier (Garland-Heckbert) using half-edge
+ * collapses, so every level indexes a subset of the input vertices and can
+ * share their vertex arrays. Vertices that share a position, such as render
+ * vertices split along a crease, collapse together, which keeps the levels
+ * free of cracks; open boundaries are never moved.
+ */
+class MeshSimplifier {
+public:
+    // Simplify towards each of levelCount decreasing triangle targets and
+    // snapshot the mesh as each is reached. Normals choose which vertex a
+    // moved corner takes where several share a position. Working tables are
+    // taken from the top of arena and released again; only the level
+    // indices remain. Returns the number of levels produced, which is
+    // smaller than levelCount if the mesh could not be reduced far enough.
+    static int BuildLevels(const Vector3* positions, const Vector3* normals, u32 vertexCount,
+                           const u32* indices, u32 triangleCount,
+                           const u32* targetTriangles, int levelCount,
+                           Arena& arena, SimplifiedLevel* levels);
+};
+
+#endif // MESH_SIMPLIFIER_H
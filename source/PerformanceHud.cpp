@@ -0,0 +1,303 @@
+#include "PerformanceHud.h"
+#include "Renderer.h"
+#include "MemorySystem.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+// 8x16 glyphs of the libogc console, one byte per row with the leftmost
+// pixel in the top bit
+extern "C" u8 console_font_8x16[];
+
+namespace {
+
+enum MetricSet {
+    METRICS_XF_RASTER = 0,
+    METRICS_GP_FIRST,           // Three GP counter pairs follow
+    METRICS_VERTEX_CACHE = METRICS_GP_FIRST + 3,
+    METRIC_SET_COUNT
+};
+
+struct GpMetricPair {
+    u32 perf0;
+    const char* name0;
+    u32 perf1;
+    const char* name1;
+};
+
+const GpMetricPair gpMetrics[3] = {
+    { GX_PERF0_TRIANGLES, "Setup tris", GX_PERF1_VERTICES, "CP verts" },
+    { GX_PERF0_TRIANGLES_CULLED, "Culled tris", GX_PERF1_FIFO_REQ, "FIFO reqs" },
+    { GX_PERF0_CLIP_VTX, "Clipped verts", GX_PERF1_CALL_REQ, "Call reqs" }
+};
+
+const u32 BACKGROUND_COLOR = 0x000000b0;
+const u32 HEADER_COLOR = 0xffd040ff;
+const u32 TEXT_COLOR = 0xffffffff;
+
+u32 Percent(u32 part, u32 whole) {
+    return whole ? static_cast<u32>(100.0f * part / whole + 0.5f) : 0;
+}
+
+} // namespace
+
+void RollingStat::Add(f32 value) {
+    samples[next] = value;
+    next = (next + 1) % CAPACITY;
+    if (count < CAPACITY) count++;
+}
+
+void RollingStat::Summarize(f32& minimum, f32& average, f32& p99) const {
+    minimum = average = p99 = 0.0f;
+    if (count == 0) return;
+
+    f32 sorted[CAPACITY];
+    memcpy(sorted, samples, count * sizeof(f32));
+    std::sort(sorted, sorted + count);
+
+    f32 sum = 0.0f;
+    for (u32 i = 0; i < count; i++) sum += sorted[i];
+
+    minimum = sorted[0];
+    average = sum / count;
+    p99 = sorted[(count * 99 + 99) / 100 - 1];
+}
+
+PerformanceHud::PerformanceHud() : visible(false), fontData(nullptr), metricSet(METRICS_XF_RASTER),
+                                   metricFrames(0), xfWaitIn(0), xfWaitOut(0), rasterBusy(0),
+                                   rasterClocks(0), cacheChecks(0), cacheMisses(0), cacheStalls(0),
+                                   vertices(0), triangles(0), batches(0), fifoBytes(0),
+                                   displayListBytes(0), clustersDrawn(0), clustersCulled(0) {
+    memset(gpCounts, 0, sizeof(gpCounts));
+}
+
+bool PerformanceHud::Initialize(Arena& arena) {
+    const u32 size = ATLAS_WIDTH * ATLAS_HEIGHT;
+    u8* data = static_cast<u8*>(arena.Allocate(size));
+    if (!data) {
+        printf("Performance HUD disabled: no room for its %u KB font texture\n", size / 1024);
+        return false;
+    }
+
+    // GX_TF_I8 is stored in 8x4 texel tiles; intensity doubles as alpha,
+    // so glyph pixels are opaque and the rest transparent
+    memset(data, 0, size);
+    for (int cell = 0; cell <= SOLID_CELL; cell++) {
+        const u8* glyph = console_font_8x16 + (cell + 32) * GLYPH_HEIGHT;
+        int originX = (cell % ATLAS_COLUMNS) * GLYPH_WIDTH;
+        int originY = (cell / ATLAS_COLUMNS) * GLYPH_HEIGHT;
+
+        for (int row = 0; row < GLYPH_HEIGHT; row++) {
+            u8 bits = (cell == SOLID_CELL) ? 0xff : glyph[row];
+            for (int column = 0; column < GLYPH_WIDTH; column++) {
+                if (!(bits & (0x80 >> column))) continue;
+
+                int x = originX + column;
+                int y = originY + row;
+                u32 tile = (y / 4) * (ATLAS_WIDTH / 8) + x / 8;
+                data[tile * 32 + (y % 4) * 8 + x % 8] = 0xff;
+            }
+        }
+    }
+    DCFlushRange(data, size);
+
+    GX_InitTexObj(&fontTexture, data, ATLAS_WIDTH, ATLAS_HEIGHT, GX_TF_I8, GX_CLAMP, GX_CLAMP, GX_FALSE);
+    GX_InitTexObjLOD(&fontTexture, GX_NEAR, GX_NEAR, 0.0f, 0.0f, 0.0f, GX_FALSE, GX_FALSE, GX_ANISO_1);
+    fontData = data;
+    return true;
+}
+
+void PerformanceHud::SetVisible(bool enable) {
+    visible = enable && IsAvailable();
+
+    // Frame times from before the HUD was shown are not representative
+    if (visible) {
+        cpuMillis.Clear();
+        gpuMillis.Clear();
+        waitMillis.Clear();
+        frameMillis.Clear();
+        metricFrames = 0;
+    }
+}
+
+int PerformanceHud::SelectMetrics() {
+    // Stay on each set for a while; switching restarts its counters
+    if (metricFrames > 0 && metricFrames < METRIC_FRAMES) {
+        metricFrames++;
+        return metricSet;
+    }
+    if (metricFrames > 0) {
+        metricSet = (metricSet + 1) % METRIC_SET_COUNT;
+    }
+    metricFrames = 1;
+
+    if (metricSet == METRICS_XF_RASTER) {
+        GX_SetGPMetric(GX_PERF0_NONE, GX_PERF1_NONE);
+        GX_InitXfRasMetric();
+    } else if (metricSet == METRICS_VERTEX_CACHE) {
+        GX_SetGPMetric(GX_PERF0_NONE, GX_PERF1_NONE);
+        GX_SetVCacheMetric(GX_VC_ALL);
+    } else {
+        const GpMetricPair& pair = gpMetrics[metricSet - METRICS_GP_FIRST];
+        GX_SetGPMetric(pair.perf0, pair.perf1);
+    }
+    return metricSet;
+}
+
+void PerformanceHud::ReadCounters(GpuCounterSample& sample) {
+    GX_ReadGPMetric(&sample.gp0, &sample.gp1);
+    GX_ReadXfRasMetric(&sample.xfWaitIn, &sample.xfWaitOut, &sample.rasterBusy, &sample.clocks);
+    GX_ReadVCacheMetric(&sample.cacheChecks, &sample.cacheMisses, &sample.cacheStalls);
+}
+
+void PerformanceHud::AddCounters(int set, const GpuCounterSample& before, const GpuCounterSample& after) {
+    // Unsigned differences stay correct across counter wrap-around
+    if (set == METRICS_XF_RASTER) {
+        xfWaitIn = after.xfWaitIn - before.xfWaitIn;
+        xfWaitOut = after.xfWaitOut - before.xfWaitOut;
+        rasterBusy = after.rasterBusy - before.rasterBusy;
+        rasterClocks = after.clocks - before.clocks;
+    } else if (set == METRICS_VERTEX_CACHE) {
+        cacheChecks = after.cacheChecks - before.cacheChecks;
+        cacheMisses = after.cacheMisses - before.cacheMisses;
+        cacheStalls = after.cacheStalls - before.cacheStalls;
+    } else if (set >= METRICS_GP_FIRST && set < METRICS_VERTEX_CACHE) {
+        gpCounts[set - METRICS_GP_FIRST][0] = after.gp0 - before.gp0;
+        gpCounts[set - METRICS_GP_FIRST][1] = after.gp1 - before.gp1;
+    }
+}
+
+void PerformanceHud::AddFrame(const RenderStats& stats) {
+    cpuMillis.Add(stats.cpuMicros / 1000.0f);
+    gpuMillis.Add(stats.gpuMicros / 1000.0f);
+    waitMillis.Add(stats.waitMicros / 1000.0f);
+    if (stats.frameMicros > 0) {
+        frameMillis.Add(stats.frameMicros / 1000.0f);
+    }
+
+    vertices = stats.vertices;
+    triangles = stats.triangles;
+    batches = stats.batches;
+    fifoBytes = stats.fifoBytes;
+    displayListBytes = stats.displayListBytes;
+    clustersDrawn = stats.clustersDrawn;
+    clustersCulled = stats.clustersCulled;
+}
+
+void PerformanceHud::Draw(const GXRModeObj* videoMode, int lodLevel, const char* fallback) {
+    if (!visible) return;
+
+    char lines[MAX_LINES][LINE_LENGTH];
+    int lineCount = 0;
+
+    snprintf(lines[lineCount++], LINE_LENGTH, "%-9s %7s %7s %7s", "ms", "min", "avg", "p99");
+    const RollingStat* times[] = { &cpuMillis, &gpuMillis, &waitMillis, &frameMillis };
+    const char* timeNames[] = { "CPU", "GPU", "Wait", "Frame" };
+    for (int i = 0; i < 4; i++) {
+        f32 minimum, average, p99;
+        times[i]->Summarize(minimum, average, p99);
+        snprintf(lines[lineCount++], LINE_LENGTH, "%-9s %7.2f %7.2f %7.2f", timeNames[i], minimum, average, p99);
+    }
+
+    snprintf(lines[lineCount++], LINE_LENGTH, "Verts %u  Tris %u", vertices, triangles);
+    snprintf(lines[lineCount++], LINE_LENGTH, "Batches %u  LOD %d", batches, lodLevel);
+    if (fallback) {
+        snprintf(lines[lineCount++], LINE_LENGTH, "Fallback: %s", fallback);
+    }
+    snprintf(lines[lineCount++], LINE_LENGTH, "FIFO %u KB  Lists %u KB", fifoBytes / 1024, displayListBytes / 1024);
+    snprintf(lines[lineCount++], LINE_LENGTH, "Clusters %u drawn %u culled", clustersDrawn, clustersCulled);
+    snprintf(lines[lineCount++], LINE_LENGTH, "XF wait in %u%% out %u%%",
+             Percent(xfWaitIn, rasterClocks), Percent(xfWaitOut, rasterClocks));
+    snprintf(lines[lineCount++], LINE_LENGTH, "Raster busy %u%% of %u clk",
+             Percent(rasterBusy, rasterClocks), rasterClocks);
+    snprintf(lines[lineCount++], LINE_LENGTH, "VCache %u chk %u%% miss %u stl",
+             cacheChecks, Percent(cacheMisses, cacheChecks), cacheStalls);
+    for (int i = 0; i < 3; i++) {
+        snprintf(lines[lineCount++], LINE_LENGTH, "%s %u  %s %u", gpMetrics[i].name0, gpCounts[i][0],
+                 gpMetrics[i].name1, gpCounts[i][1]);
+    }
+
+    Arena* arenas[] = { &MemorySystem::GetMeshArena(), &MemorySystem::GetScratchArena(),
+                        &MemorySystem::GetSystemArena() };
+    for (Arena* arena : arenas) {
+        snprintf(lines[lineCount++], LINE_LENGTH, "%-7s %6u/%6u KB", arena->GetName(),
+                 arena->GetUsed() / 1024, arena->GetCapacity() / 1024);
+    }
+
+    // One quad per visible character plus the backdrop
+    int widest = 0;
+    u32 quads = 1;
+    for (int i = 0; i < lineCount; i++) {
+        int length = static_cast<int>(strlen(lines[i]));
+        widest = std::max(widest, length);
+        for (int k = 0; k < length; k++) {
+            if (lines[i][k] != ' ') quads++;
+        }
+    }
+
+    // Pixel coordinates, top left origin, in front of the near plane
+    Mtx44 projection;
+    guOrtho(projection, 0.0f, videoMode->efbHeight, 0.0f, videoMode->fbWidth, 0.0f, 10.0f);
+    GX_LoadProjectionMtx(projection, GX_ORTHOGRAPHIC);
+    Mtx position;
+    guMtxIdentity(position);
+    guMtxTransApply(position, position, 0.0f, 0.0f, -5.0f);
+    GX_LoadPosMtxImm(position, GX_PNMTX1);
+    GX_SetCurrentMtx(GX_PNMTX1);
+
+    GX_ClearVtxDesc();
+    GX_SetVtxDesc(GX_VA_POS, GX_DIRECT);
+    GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
+    GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
+    GX_SetVtxAttrFmt(GX_VTXFMT2, GX_VA_POS, GX_POS_XY, GX_S16, 0);
+    GX_SetVtxAttrFmt(GX_VTXFMT2, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
+    GX_SetVtxAttrFmt(GX_VTXFMT2, GX_VA_TEX0, GX_TEX_ST, GX_F32, 0);
+
+    // Unlit vertex color times the glyph, blended over the scene
+    GX_SetNumChans(1);
+    GX_SetChanCtrl(GX_COLOR0A0, GX_DISABLE, GX_SRC_REG, GX_SRC_VTX, GX_LIGHTNULL, GX_DF_NONE, GX_AF_NONE);
+    GX_SetNumTexGens(1);
+    GX_SetTexCoordGen(GX_TEXCOORD0, GX_TG_MTX2x4, GX_TG_TEX0, GX_IDENTITY);
+    GX_LoadTexObj(&fontTexture, GX_TEXMAP0);
+    GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR0A0);
+    GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
+    GX_SetZMode(GX_FALSE, GX_ALWAYS, GX_FALSE);
+    GX_SetBlendMode(GX_BM_BLEND, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_CLEAR);
+
+    const s16 margin = 24;
+    const s16 padding = 6;
+    GX_Begin(GX_QUADS, GX_VTXFMT2, quads * 4);
+    EmitQuad(margin - padding, margin - padding, widest * GLYPH_WIDTH + 2 * padding,
+             lineCount * GLYPH_HEIGHT + 2 * padding, SOLID_CELL, BACKGROUND_COLOR);
+    for (int i = 0; i < lineCount; i++) {
+        u32 color = (i == 0) ? HEADER_COLOR : TEXT_COLOR;
+        for (int k = 0; lines[i][k] != '\0'; k++) {
+            u8 c = static_cast<u8>(lines[i][k]);
+            if (c == ' ') continue;
+            int cell = (c >= 32 && c < 128) ? c - 32 : '?' - 32;
+            EmitQuad(margin + k * GLYPH_WIDTH, margin + i * GLYPH_HEIGHT, GLYPH_WIDTH, GLYPH_HEIGHT,
+                     cell, color);
+        }
+    }
+    GX_End();
+}
+
+void PerformanceHud::EmitQuad(s16 x, s16 y, s16 width, s16 height, int cell, u32 color) {
+    f32 u0 = static_cast<f32>((cell % ATLAS_COLUMNS) * GLYPH_WIDTH) / ATLAS_WIDTH;
+    f32 v0 = static_cast<f32>((cell / ATLAS_COLUMNS) * GLYPH_HEIGHT) / ATLAS_HEIGHT;
+    f32 u1 = u0 + static_cast<f32>(GLYPH_WIDTH) / ATLAS_WIDTH;
+    f32 v1 = v0 + static_cast<f32>(GLYPH_HEIGHT) / ATLAS_HEIGHT;
+
+    GX_Position2s16(x, y);
+    GX_Color1u32(color);
+    GX_TexCoord2f32(u0, v0);
+    GX_Position2s16(x + width, y);
+    GX_Color1u32(color);
+    GX_TexCoord2f32(u1, v0);
+    GX_Position2s16(x + width, y + height);
+    GX_Color1u32(color);
+    GX_TexCoord2f32(u1, v1);
+    GX_Position2s16(x, y + height);
+    GX_Color1u32(color);
+    GX_TexCoord2f32(u0, v1);
+}
@@ -0,0 +1,132 @@
+#ifndef PERFORMANCE_HUD_H
+#define PERFORMANCE_HUD_H
+
+#include <gccore.h>
+#include "Arena.h"
+
+struct RenderStats;
+
+/**
+ * Last CAPACITY samples of one per-frame value
+ */
+class RollingStat {
+public:
+    static const u32 CAPACITY = 120;
+
+    RollingStat() { Clear(); }
+
+    void Clear() { count = 0; next = 0; }
+    void Add(f32 value);
+    u32 GetCount() const { return count; }
+
+    // Smallest, mean and 99th percentile of the samples held
+    void Summarize(f32& minimum, f32& average, f32& p99) const;
+
+private:
+    f32 samples[CAPACITY];
+    u32 count;
+    u32 next;
+};
+
+/**
+ * Running totals of the GPU performance counters, read at a frame's draw
+ * done token. Only the counters of the metric set selected for the frame
+ * are meaningful.
+ */
+struct GpuCounterSample {
+    u32 gp0;
+    u32 gp1;
+    u32 xfWaitIn;
+    u32 xfWaitOut;
+    u32 rasterBusy;
+    u32 clocks;
+    u32 cacheChecks;
+    u32 cacheMisses;
+    u32 cacheStalls;
+};
+
+/**
+ * Performance overlay drawn into the EFB with textured quads from a font
+ * atlas built at startup from the libogc console font, so the console
+ * framebuffer is never touched. Frame times are shown as rolling
+ * min/avg/p99; GPU counters as the latest frame measured.
+ *
+ * The GP metric selectors, the XF/raster counters and the vertex cache
+ * counters share hardware, so the HUD cycles through metric sets, one set
+ * per METRIC_FRAMES frames.
+ */
+class PerformanceHud {
+public:
+    PerformanceHud();
+
+    // Build the font texture in arena; the HUD stays hidden if that fails
+    bool Initialize(Arena& arena);
+
+    bool IsAvailable() const { return fontData != nullptr; }
+    bool IsVisible() const { return visible; }
+    void SetVisible(bool enable);
+
+    // Select the counters for the frame about to be submitted and return
+    // the metric set, which frames must share for their difference to count
+    int SelectMetrics();
+
+    // Safe from interrupt context: reads registers only
+    static void ReadCounters(GpuCounterSample& sample);
+
+    // Account one finished frame: its counters (the difference between two
+    // samples under the same metric set) and its stats
+    void AddCounters(int metricSet, const GpuCounterSample& before, const GpuCounterSample& after);
+    void AddFrame(const RenderStats& stats);
+
+    // Submit the overlay; changes projection, position matrix, vertex
+    // format, TEV, channel and blend state, which the caller restores.
+    // A fallback, when given, names the geometry drawn in place of strips.
+    void Draw(const GXRModeObj* videoMode, int lodLevel, const char* fallback);
+
+private:
+    bool visible;
+    u8* fontData;
+    GXTexObj fontTexture;
+
+    int metricSet;
+    u32 metricFrames;
+
+    RollingStat cpuMillis;
+    RollingStat gpuMillis;
+    RollingStat waitMillis;
+    RollingStat frameMillis;
+
+    // Latest frame measured by each metric set
+    u32 gpCounts[3][2];
+    u32 xfWaitIn;
+    u32 xfWaitOut;
+    u32 rasterBusy;
+    u32 rasterClocks;
+    u32 cacheChecks;
+    u32 cacheMisses;
+    u32 cacheStalls;
+
+    // Submission counts of the latest frame
+    u32 vertices;
+    u32 triangles;
+    u32 batches;
+    u32 fifoBytes;
+    u32 displayListBytes;
+    u32 clustersDrawn;
+    u32 clustersCulled;
+
+    static const u32 METRIC_FRAMES = 30;
+    static const int MAX_LINES = 20;
+    static const int LINE_LENGTH = 40;
+    static const int GLYPH_WIDTH = 8;
+    static const int GLYPH_HEIGHT = 16;
+    static const int ATLAS_COLUMNS = 16;
+    static const int ATLAS_ROWS = 7;        // 96 printable characters and a solid cell
+    static const int ATLAS_WIDTH = ATLAS_COLUMNS * GLYPH_WIDTH;
+    static const int ATLAS_HEIGHT = ATLAS_ROWS * GLYPH_HEIGHT;
+    static const int SOLID_CELL = 96;
+
+    void EmitQuad(s16 x, s16 y, s16 width, s16 height, int cell, u32 color);
+};
+
+#endif // PERFORMANCE_HUD_H
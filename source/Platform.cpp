@@ -0,0 +1,21 @@
+#include "Platform.h"
+
+#ifdef HOST_BUILD
+
+#include <time.h>
+
+u64 gettime() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<u64>(now.tv_sec) * 1000000000ull + static_cast<u64>(now.tv_nsec);
+}
+
+u32 diff_usec(u64 start, u64 end) {
+    return static_cast<u32>((end - start) / 1000);
+}
+
+u32 diff_msec(u64 start, u64 end) {
+    return static_cast<u32>((end - start) / 1000000);
+}
+
+#endif
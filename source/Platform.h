@@ -0,0 +1,44 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+/**
+ * The libogc types and timers used by the portable modules (loading,
+ * caching, geometry processing and file scanning). Console builds take them
+ * from libogc; host builds (HOST_BUILD) get equivalents so those modules
+ * compile natively for the benchmark in host/.
+ */
+#ifdef HOST_BUILD
+
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef float f32;
+typedef double f64;
+
+typedef volatile u8 vu8;
+typedef volatile u16 vu16;
+typedef volatile u32 vu32;
+typedef volatile s32 vs32;
+
+typedef f32 Mtx[3][4];
+
+// Monotonic time stamp, in nanoseconds on the host
+u64 gettime();
+u32 diff_usec(u64 start, u64 end);
+u32 diff_msec(u64 start, u64 end);
+
+#else
+
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#endif
+
+#endif // PLATFORM_H
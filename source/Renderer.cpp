@@ -1,8 +1,22 @@
 #include "Renderer.h"
+#include "ColorScheme.h"
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
-#include <malloc.h>
+#include "MemorySystem.h"
+
+// Position + normal + RGBA8 color, as submitted for one vertex
+static inline void EmitIndex16(u32 index) {
+    GX_Position1x16(static_cast<u16>(index));
+    GX_Normal1x16(static_cast<u16>(index));
+    GX_Color1x16(static_cast<u16>(index));
+}
+
+static inline void EmitIndex8(u32 index) {
+    GX_Position1x8(static_cast<u8>(index));
+    GX_Normal1x8(static_cast<u8>(index));
+    GX_Color1x8(static_cast<u8>(index));
+}
 
 // Static member initialization
 Renderer* Renderer::instance = nullptr;
@@ -13,22 +27,29 @@ const f32 Camera::MAX_DISTANCE = 200.0f;
 const f32 Camera::MAX_ROTATION_X = 1.5f;
 
 // Camera implementation
-Camera::Camera() : distance(100.0f), rotationX(0.0f), rotationY(0.0f) {
+Camera::Camera() : distance(100.0f), rotationX(0.0f), rotationY(0.0f), revision(1) {
 }
 
 void Camera::SetDistance(f32 dist) {
-    distance = dist;
-    if (distance < MIN_DISTANCE) distance = MIN_DISTANCE;
-    if (distance > MAX_DISTANCE) distance = MAX_DISTANCE;
+    if (dist < MIN_DISTANCE) dist = MIN_DISTANCE;
+    if (dist > MAX_DISTANCE) dist = MAX_DISTANCE;
+
+    if (dist != distance) {
+        distance = dist;
+        revision++;
+    }
 }
 
 void Camera::SetRotation(f32 rotX, f32 rotY) {
-    rotationX = rotX;
-    rotationY = rotY;
-
     // Constrain vertical rotation to prevent gimbal lock
-    if (rotationX > MAX_ROTATION_X) rotationX = MAX_ROTATION_X;
-    if (rotationX < -MAX_ROTATION_X) rotationX = -MAX_ROTATION_X;
+    if (rotX > MAX_ROTATION_X) rotX = MAX_ROTATION_X;
+    if (rotX < -MAX_ROTATION_X) rotX = -MAX_ROTATION_X;
+
+    if (rotX != rotationX || rotY != rotationY) {
+        rotationX = rotX;
+        rotationY = rotY;
+        revision++;
+    }
 }
 
 void Camera::AdjustDistance(f32 delta) {
@@ -39,12 +60,15 @@ void Camera::AdjustRotation(f32 deltaX, f32 deltaY) {
     SetRotation(rotationX + deltaX, rotationY + deltaY);
 }
 
+Vector3 Camera::GetPosition() const {
+    return Vector3(distance * sinf(rotationY) * cosf(rotationX),
+                   distance * sinf(rotationX),
+                   distance * cosf(rotationY) * cosf(rotationX));
+}
+
 void Camera::GetViewMatrix(Mtx view) const {
-    guVector camera = {
-        distance * sinf(rotationY) * cosf(rotationX),
-        distance * sinf(rotationX),
-        distance * cosf(rotationY) * cosf(rotationX)
-    };
+    Vector3 position = GetPosition();
+    guVector camera = { position.x, position.y, position.z };
     guVector up = {0.0F, 1.0F, 0.0F};
     guVector look = {0.0F, 0.0F, 0.0F};
 
@@ -52,7 +76,24 @@ void Camera::GetViewMatrix(Mtx view) const {
 }
 
 // LightingSystem implementation
-LightingSystem::LightingSystem() {
+const DirectionalLight LightingSystem::lights[LightingSystem::LIGHT_COUNT] = {
+    // Primary key light (warm white, from upper right)
+    { Vector3(0.8f, 0.6f, 1.0f), (GXColor){255, 240, 220, 255} },
+    // Fill light (cool blue, from upper left)
+    { Vector3(-0.6f, 0.4f, 0.8f), (GXColor){180, 200, 255, 255} },
+    // Rim light (bright white from behind, creates edge definition)
+    { Vector3(0.2f, -0.3f, -0.9f), (GXColor){255, 255, 255, 255} },
+    // Bounce light (soft blue-gray upward light simulating ground reflection)
+    { Vector3(0.0f, -1.0f, 0.2f), (GXColor){120, 140, 160, 255} }
+};
+
+// Enhanced ambient light for global illumination
+const GXColor LightingSystem::ambient = {80, 80, 100, 255};
+
+// Lights are placed this far along their direction so they act as directional
+static const f32 LIGHT_DISTANCE = 100000.0f;
+
+LightingSystem::LightingSystem() : baked(false) {
 }
 
 void LightingSystem::Initialize() {
@@ -60,59 +101,161 @@ void LightingSystem::Initialize() {
 }
 
 void LightingSystem::SetupLights() {
-    // Set up enhanced global illumination with multiple lights
     GX_SetNumChans(1);
+
+    if (baked) {
+        // Vertex colors already contain the lighting
+        GX_SetChanCtrl(GX_COLOR0A0, GX_DISABLE, GX_SRC_REG, GX_SRC_VTX,
+                       GX_LIGHTNULL, GX_DF_NONE, GX_AF_NONE);
+        return;
+    }
+
+    // Set up enhanced global illumination with multiple lights
     GX_SetChanCtrl(GX_COLOR0A0, GX_ENABLE, GX_SRC_REG, GX_SRC_VTX,
                    GX_LIGHT0 | GX_LIGHT1 | GX_LIGHT2 | GX_LIGHT3, GX_DF_CLAMP, GX_AF_NONE);
+    GX_SetChanAmbColor(GX_COLOR0A0, ambient);
 
-    // Enhanced ambient light for global illumination
-    GX_SetChanAmbColor(GX_COLOR0A0, (GXColor){80, 80, 100, 255});
+    for (int i = 0; i < LIGHT_COUNT; i++) {
+        LoadLight(lights[i], GX_LIGHT0 << i);
+    }
+}
 
-    SetupKeyLight();
-    SetupFillLight();
-    SetupRimLight();
-    SetupBounceLight();
+void LightingSystem::SetBaked(bool enable) {
+    baked = enable;
+    SetupLights();
 }
 
-void LightingSystem::SetupKeyLight() {
-    // Primary key light (warm, from upper right)
-    GXLightObj keyLight;
-    guVector keyDir = {0.8f, 0.6f, 1.0f};
-    GX_InitLightDir(&keyLight, keyDir.x, keyDir.y, keyDir.z);
-    GX_InitLightColor(&keyLight, (GXColor){255, 240, 220, 255}); // Warm white
-    GX_LoadLightObj(&keyLight, GX_LIGHT0);
+void LightingSystem::LoadLight(const DirectionalLight& light, u8 id) {
+    const Vector3& dir = light.direction;
+    f32 length = sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+
+    GXLightObj lightObj;
+    GX_InitLightPos(&lightObj, dir.x / length * LIGHT_DISTANCE, dir.y / length * LIGHT_DISTANCE,
+                    dir.z / length * LIGHT_DISTANCE);
+    GX_InitLightDir(&lightObj, dir.x, dir.y, dir.z);
+    GX_InitLightColor(&lightObj, light.color);
+    GX_LoadLightObj(&lightObj, id);
 }
 
-void LightingSystem::SetupFillLight() {
-    // Fill light (cooler, from upper left)
-    GXLightObj fillLight;
-    guVector fillDir = {-0.6f, 0.4f, 0.8f};
-    GX_InitLightDir(&fillLight, fillDir.x, fillDir.y, fillDir.z);
-    GX_InitLightColor(&fillLight, (GXColor){180, 200, 255, 255}); // Cool blue
-    GX_LoadLightObj(&fillLight, GX_LIGHT1);
+u32 LightingSystem::ApplyLighting(u32 material, const Vector3& normal) {
+    // Light directions normalized once, colors scaled to 0-1
+    static f32 unitDirections[LIGHT_COUNT][3];
+    static bool prepared = false;
+    if (!prepared) {
+        for (int i = 0; i < LIGHT_COUNT; i++) {
+            const Vector3& dir = lights[i].direction;
+            f32 invLength = 1.0f / sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+            unitDirections[i][0] = dir.x * invLength;
+            unitDirections[i][1] = dir.y * invLength;
+            unitDirections[i][2] = dir.z * invLength;
+        }
+        prepared = true;
+    }
+
+    const f32 inv255 = 1.0f / 255.0f;
+    f32 r = ambient.r * inv255;
+    f32 g = ambient.g * inv255;
+    f32 b = ambient.b * inv255;
+
+    for (int i = 0; i < LIGHT_COUNT; i++) {
+        f32 diffuse = normal.x * unitDirections[i][0] + normal.y * unitDirections[i][1] +
+                      normal.z * unitDirections[i][2];
+        if (diffuse > 0.0f) {
+            r += lights[i].color.r * inv255 * diffuse;
+            g += lights[i].color.g * inv255 * diffuse;
+            b += lights[i].color.b * inv255 * diffuse;
+        }
+    }
+
+    if (r > 1.0f) r = 1.0f;
+    if (g > 1.0f) g = 1.0f;
+    if (b > 1.0f) b = 1.0f;
+
+    u32 outR = static_cast<u32>(((material >> 24) & 0xff) * r + 0.5f);
+    u32 outG = static_cast<u32>(((material >> 16) & 0xff) * g + 0.5f);
+    u32 outB = static_cast<u32>(((material >> 8) & 0xff) * b + 0.5f);
+    return (outR << 24) | (outG << 16) | (outB << 8) | (material & 0xff);
 }
 
-void LightingSystem::SetupRimLight() {
-    // Rim light (from behind, creates edge definition)
-    GXLightObj rimLight;
-    guVector rimDir = {0.2f, -0.3f, -0.9f};
-    GX_InitLightDir(&rimLight, rimDir.x, rimDir.y, rimDir.z);
-    GX_InitLightColor(&rimLight, (GXColor){255, 255, 255, 255}); // Bright white
-    GX_LoadLightObj(&rimLight, GX_LIGHT2);
+void LightingSystem::EvaluateReference(u32 material, const Vector3& normal, f64 out[3]) {
+    f64 n[3] = { normal.x, normal.y, normal.z };
+    f64 nLength = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (nLength > 0.0) {
+        n[0] /= nLength;
+        n[1] /= nLength;
+        n[2] /= nLength;
+    }
+
+    f64 lit[3] = { ambient.r / 255.0, ambient.g / 255.0, ambient.b / 255.0 };
+    for (int i = 0; i < LIGHT_COUNT; i++) {
+        const Vector3& dir = lights[i].direction;
+        f64 l[3] = { dir.x, dir.y, dir.z };
+        f64 lLength = sqrt(l[0] * l[0] + l[1] * l[1] + l[2] * l[2]);
+        f64 diffuse = (n[0] * l[0] + n[1] * l[1] + n[2] * l[2]) / lLength;
+        if (diffuse <= 0.0) continue;
+
+        lit[0] += lights[i].color.r / 255.0 * diffuse;
+        lit[1] += lights[i].color.g / 255.0 * diffuse;
+        lit[2] += lights[i].color.b / 255.0 * diffuse;
+    }
+
+    for (int c = 0; c < 3; c++) {
+        f64 clamped = lit[c] > 1.0 ? 1.0 : lit[c];
+        out[c] = ((material >> (24 - c * 8)) & 0xff) * clamped;
+    }
 }
 
-void LightingSystem::SetupBounceLight() {
-    // Bounce light (soft upward light simulating ground reflection)
-    GXLightObj bounceLight;
-    guVector bounceDir = {0.0f, -1.0f, 0.2f};
-    GX_InitLightDir(&bounceLight, bounceDir.x, bounceDir.y, bounceDir.z);
-    GX_InitLightColor(&bounceLight, (GXColor){120, 140, 160, 255}); // Soft blue-gray
-    GX_LoadLightObj(&bounceLight, GX_LIGHT3);
+u32 LightingSystem::ValidateBake(const Vector3* normals, const u32* materials, const u32* baked,
+                                 u32 count, u32 stride) {
+    if (stride == 0) stride = 1;
+
+    f64 worst = 0.0;
+    for (u32 i = 0; i < count; i += stride) {
+        f64 expected[3];
+        EvaluateReference(materials[i], normals[i], expected);
+
+        for (int c = 0; c < 3; c++) {
+            f64 error = fabs(static_cast<f64>((baked[i] >> (24 - c * 8)) & 0xff) - expected[c]);
+            if (error > worst) worst = error;
+        }
+    }
+
+    // Whole steps only: 0 means every sample is within rounding
+    return static_cast<u32>(worst);
 }
 
+// Largest simplification error, in pixels, a level of detail may show
+const f32 Renderer::LOD_PIXEL_ERROR = 1.0f;
+
+// Perspective projection, shared by the GPU setup and CPU culling
+const f32 Renderer::FIELD_OF_VIEW = 45.0f;
+const f32 Renderer::ASPECT_RATIO = 1.33f;
+const f32 Renderer::NEAR_PLANE = 1.0f;
+const f32 Renderer::FAR_PLANE = 1000.0f;
+
 // Renderer implementation
-Renderer::Renderer() : videoMode(nullptr), frameBuffer(nullptr), fifoBuffer(nullptr),
-                       lighting(nullptr), initialized(false), readyForCopy(GX_FALSE) {
+Renderer::Renderer() : videoMode(nullptr), fifoBuffer(nullptr),
+                       lighting(nullptr), initialized(false), frameBufferCount(0), shownBuffer(0),
+                       queuedBuffer(-1), displayActive(false), submittedFrames(0), completedFrames(0),
+                       frameQueue(LWP_TQUEUE_NULL), frameStartTime(0), previousFrameStart(0),
+                       frameWaitMicros(0), lastGpuMicros(0), timedFrames(0), cpuMicrosTotal(0),
+                       gpuMicrosTotal(0), waitMicrosTotal(0), frameMicrosTotal(0),
+                       drawnMesh(nullptr), drawnMeshRevision(0), drawnCameraRevision(0),
+                       drawnSettingsRevision(0), settingsRevision(1), frameValid(false),
+                       framesRendered(0), framesReused(0), countedFrames(0),
+                       displayListsEnabled(true), stripsEnabled(true), vertexArraysEnabled(true),
+                       vertexColors(nullptr), vertexIndexType(GX_DIRECT),
+                       colorScheme(ColorScheme::GetScheme(0)), faceColors(nullptr), meshDataRevision(0), colorsStale(false),
+                       recordingDisplayList(false), displayListMarker(0), lodLevel(0), visibleClusters(nullptr) {
+    for (int i = 0; i < MAX_FRAME_BUFFERS; i++) {
+        frameBuffers[i] = nullptr;
+    }
+    for (u32 i = 0; i < FRAME_RING; i++) {
+        frameTargets[i] = -1;
+        frameStartTimes[i] = 0;
+        frameDoneTimes[i] = 0;
+        frameMetricSets[i] = -1;
+    }
     instance = this;
 }
 
@@ -123,7 +266,7 @@ Renderer::~Renderer() {
     }
 }
 
-bool Renderer::Initialize(GXRModeObj* vMode) {
+bool Renderer::Initialize(GXRModeObj* vMode, int bufferCount) {
     if (initialized) {
         return true;
     }
@@ -134,20 +277,26 @@ bool Renderer::Initialize(GXRModeObj* vMode) {
         return false;
     }
 
-    // Allocate FIFO buffer
-    fifoBuffer = MEM_K0_TO_K1(memalign(32, FIFO_SIZE));
+    // Allocate FIFO buffer from the long-lived system arena
+    fifoBuffer = MEM_K0_TO_K1(MemorySystem::GetSystemArena().Allocate(FIFO_SIZE));
     if (!fifoBuffer) {
         printf("ERROR: Failed to allocate FIFO buffer\n");
         return false;
     }
     memset(fifoBuffer, 0, FIFO_SIZE);
 
-    // Allocate frame buffer
-    frameBuffer = MEM_K0_TO_K1(SYS_AllocateFramebuffer(videoMode));
-    if (!frameBuffer) {
-        printf("ERROR: Failed to allocate frame buffer\n");
-        return false;
+    // Allocate the external frame buffers the EFB is copied into
+    if (bufferCount < 2) bufferCount = 2;
+    if (bufferCount > MAX_FRAME_BUFFERS) bufferCount = MAX_FRAME_BUFFERS;
+    for (int i = 0; i < bufferCount; i++) {
+        frameBuffers[i] = MEM_K0_TO_K1(SYS_AllocateFramebuffer(videoMode));
+        if (!frameBuffers[i]) {
+            printf("ERROR: Failed to allocate frame buffer %d of %d\n", i + 1, bufferCount);
+            return false;
+        }
     }
+    frameBufferCount = bufferCount;
+    LWP_InitQueue(&frameQueue);
 
     // Initialize graphics pipeline
     InitializeGraphicsPipeline();
@@ -156,8 +305,11 @@ bool Renderer::Initialize(GXRModeObj* vMode) {
     lighting = new LightingSystem();
     lighting->Initialize();
 
+    // Optional: the font texture lives next to the FIFO
+    hud.Initialize(MemorySystem::GetSystemArena());
+
     initialized = true;
-    printf("Renderer initialized successfully\n");
+    printf("Renderer initialized successfully (%d frame buffers)\n", frameBufferCount);
     return true;
 }
 
@@ -166,17 +318,20 @@ void Renderer::Shutdown() {
         return;
     }
 
+    ReleaseDisplay();
+    GX_SetDrawDoneCallback(nullptr);
+    VIDEO_SetPreRetraceCallback(nullptr);
+    LWP_CloseQueue(frameQueue);
+    frameQueue = LWP_TQUEUE_NULL;
+
     if (lighting) {
         delete lighting;
         lighting = nullptr;
     }
 
-    if (fifoBuffer) {
-        free(fifoBuffer);
-        fifoBuffer = nullptr;
-    }
-
-    // Note: frameBuffer is managed by the system, don't free it manually
+    // Note: fifoBuffer belongs to the system arena and the frame buffers
+    // are managed by the system, so none are freed here
+    fifoBuffer = nullptr;
 
     initialized = false;
 }
@@ -203,7 +358,10 @@ void Renderer::InitializeGraphicsPipeline() {
     GX_SetAlphaUpdate(GX_TRUE);
     GX_SetCullMode(GX_CULL_NONE); // Disable culling to ensure all faces render
 
-    GX_CopyDisp(frameBuffer, GX_TRUE);
+    // Start every frame buffer out cleared
+    for (int i = 0; i < frameBufferCount; i++) {
+        GX_CopyDisp(frameBuffers[i], GX_TRUE);
+    }
     GX_SetDispCopyGamma(GX_GM_1_0);
 
     SetupProjectionMatrix();
@@ -212,18 +370,38 @@ void Renderer::InitializeGraphicsPipeline() {
     GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORDNULL, GX_TEXMAP_NULL, GX_COLOR0A0);
     GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
 
-    VIDEO_SetPostRetraceCallback(CopyBuffersCallback);
+    GX_DrawDone();
+
+    GX_SetDrawDoneCallback(DrawDoneCallback);
+    VIDEO_SetPreRetraceCallback(RetraceCallback);
 }
 
 void Renderer::SetupProjectionMatrix() {
     Mtx44 projection;
-    guPerspective(projection, 45, 1.33F, 1.0F, 1000.0F);
+    guPerspective(projection, FIELD_OF_VIEW, ASPECT_RATIO, NEAR_PLANE, FAR_PLANE);
     GX_LoadProjectionMtx(projection, GX_PERSPECTIVE);
 }
 
 void Renderer::BeginFrame() {
     if (!initialized) return;
 
+    // Let the GPU fall at most MAX_FRAMES_AHEAD frames behind, so the CPU
+    // overlaps the previous frame without queueing up latency
+    u64 waitStart = gettime();
+    u32 level = IRQ_Disable();
+    while (submittedFrames - completedFrames > MAX_FRAMES_AHEAD) {
+        LWP_ThreadSleep(frameQueue);
+    }
+    IRQ_Restore(level);
+
+    previousFrameStart = frameStartTime;
+    frameStartTime = gettime();
+    frameWaitMicros = diff_usec(waitStart, frameStartTime);
+    frameStartTimes[submittedFrames % FRAME_RING] = frameStartTime;
+    frameMetricSets[submittedFrames % FRAME_RING] = hud.IsVisible() ? hud.SelectMetrics() : -1;
+
+    frameStats.Clear();
+
     // Clear the screen
     GX_SetCopyClear((GXColor){20, 20, 40, 255}, 0x00ffffff);
 
@@ -239,15 +417,189 @@ void Renderer::BeginFrame() {
 void Renderer::EndFrame() {
     if (!initialized) return;
 
-    GX_DrawDone();
-    readyForCopy = GX_TRUE;
+    if (hud.IsVisible()) {
+        DrawHud();
+    }
+
+    u64 submitTime = gettime();
+    int buffer = AcquireFrameBuffer();
+    u64 acquiredTime = gettime();
+
+    // The copy and the draw done token follow the frame's commands through
+    // the FIFO; DrawDoneCallback queues the buffer once the GPU reaches them
+    GX_SetZMode(GX_TRUE, GX_LEQUAL, GX_TRUE);
+    GX_SetColorUpdate(GX_TRUE);
+    GX_CopyDisp(frameBuffers[buffer], GX_TRUE);
+    frameTargets[submittedFrames % FRAME_RING] = buffer;
+    submittedFrames++;
+    GX_SetDrawDone();
+    GX_Flush();
+
+    frameValid = true;
+    framesRendered++;
+
+    frameStats.cpuMicros = diff_usec(frameStartTime, submitTime);
+    frameWaitMicros += diff_usec(submitTime, acquiredTime);
+    AccountFrameTiming();
 }
 
-void Renderer::Present() {
+int Renderer::AcquireFrameBuffer() {
+    // Wait until a buffer is neither shown, queued for display nor the
+    // target of a frame still in flight. With two buffers that means the
+    // previous frame has been shown; a third buffer usually avoids the wait.
+    u32 level = IRQ_Disable();
+    for (;;) {
+        for (int i = 0; i < frameBufferCount; i++) {
+            if (!IsBufferBusy(i)) {
+                IRQ_Restore(level);
+                return i;
+            }
+        }
+        LWP_ThreadSleep(frameQueue);
+    }
+}
+
+bool Renderer::IsBufferBusy(int buffer) const {
+    if (buffer == shownBuffer || buffer == queuedBuffer) {
+        return true;
+    }
+    for (u32 frame = completedFrames; frame != submittedFrames; frame++) {
+        if (frameTargets[frame % FRAME_RING] == buffer) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Renderer::AccountFrameTiming() {
+    // GPU time of the latest finished frame: from its first command, or
+    // from the end of the frame before if the GPU was still busy with that
+    u32 finished = completedFrames;
+    if (finished > 0) {
+        u32 frame = finished - 1;
+        u64 start = frameStartTimes[frame % FRAME_RING];
+        if (frame > 0 && frameDoneTimes[(frame - 1) % FRAME_RING] > start) {
+            start = frameDoneTimes[(frame - 1) % FRAME_RING];
+        }
+        u64 done = frameDoneTimes[frame % FRAME_RING];
+        if (done > start) {
+            lastGpuMicros = diff_usec(start, done);
+        }
+    }
+
+    frameStats.waitMicros = frameWaitMicros;
+    frameStats.gpuMicros = lastGpuMicros;
+    frameStats.frameMicros = previousFrameStart ? diff_usec(previousFrameStart, frameStartTime) : 0;
+
+    // Counters cover a frame when the samples at its draw done token and
+    // the one before were taken under the same metric set
+    for (; countedFrames < finished; countedFrames++) {
+        u32 frame = countedFrames;
+        s32 set = frameMetricSets[frame % FRAME_RING];
+        if (frame > 0 && set >= 0 && frameMetricSets[(frame - 1) % FRAME_RING] == set) {
+            hud.AddCounters(set, frameCounters[(frame - 1) % FRAME_RING], frameCounters[frame % FRAME_RING]);
+        }
+    }
+    if (hud.IsVisible()) {
+        hud.AddFrame(frameStats);
+    }
+
+    // Skip the first frame after the display was idle
+    if (frameStats.frameMicros == 0 || frameStats.frameMicros > 1000000) {
+        return;
+    }
+    cpuMicrosTotal += frameStats.cpuMicros;
+    gpuMicrosTotal += frameStats.gpuMicros;
+    waitMicrosTotal += frameStats.waitMicros;
+    frameMicrosTotal += frameStats.frameMicros;
+    if (++timedFrames == TIMING_REPORT_FRAMES) {
+        printf("Frame timing over %u frames: CPU %.2f ms, GPU %.2f ms, waiting %.2f ms, frame %.2f ms\n",
+               timedFrames, cpuMicrosTotal / 1000.0f / timedFrames, gpuMicrosTotal / 1000.0f / timedFrames,
+               waitMicrosTotal / 1000.0f / timedFrames, frameMicrosTotal / 1000.0f / timedFrames);
+        timedFrames = 0;
+        cpuMicrosTotal = gpuMicrosTotal = waitMicrosTotal = frameMicrosTotal = 0;
+    }
+}
+
+bool Renderer::NeedsRedraw(const Mesh* mesh, const Camera& camera) const {
+    return !frameValid || hud.IsVisible() || mesh != drawnMesh || (mesh && mesh->GetRevision() != drawnMeshRevision) ||
+           camera.GetRevision() != drawnCameraRevision || settingsRevision != drawnSettingsRevision;
+}
+
+void Renderer::SetHudVisible(bool visible) {
+    if (hud.IsVisible() != visible) {
+        hud.SetVisible(visible);
+        settingsRevision++;
+    }
+}
+
+void Renderer::DrawHud() {
+    // Preprocessing passes that ran out of memory leave simpler geometry
+    const char* fallback = nullptr;
+    if (drawnMesh && drawnMesh->GetTriangleCount() > 0) {
+        if (!drawnMesh->IsIndexed()) {
+            fallback = "unwelded triangles";
+        } else if (!drawnMesh->HasRenderGeometry()) {
+            fallback = "indexed, no strips/LODs";
+        }
+    }
+    hud.Draw(videoMode, lodLevel, fallback);
+
+    // Back to the scene state of InitializeGraphicsPipeline; RenderMesh
+    // sets the vertex format itself
+    SetupProjectionMatrix();
+    GX_SetCurrentMtx(GX_PNMTX0);
+    GX_SetBlendMode(GX_BM_NONE, GX_BL_ONE, GX_BL_ZERO, GX_LO_CLEAR);
+    GX_SetNumTexGens(0);
+    GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORDNULL, GX_TEXMAP_NULL, GX_COLOR0A0);
+    GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
+    if (lighting) {
+        lighting->SetupLights();
+    }
+}
+
+void Renderer::ReuseFrame() {
+    framesReused++;
+
+    // The next rendered frame follows an idle gap, so it is not timed
+    frameStartTime = 0;
+}
+
+void Renderer::AcquireDisplay() {
+    if (!initialized) return;
+
+    // The buffer shown first still holds whatever was drawn last time
+    frameValid = false;
+    framesRendered = 0;
+    framesReused = 0;
+    displayActive = true;
+    VIDEO_SetNextFramebuffer(frameBuffers[shownBuffer]);
+    VIDEO_SetBlack(FALSE);
+    VIDEO_Flush();
+}
+
+void Renderer::ReleaseDisplay() {
     if (!initialized) return;
 
-    // The actual copy is handled by the callback
-    VIDEO_WaitVSync();
+    WaitForIdle();
+    if (displayActive && framesRendered + framesReused > 0) {
+        printf("Viewer frames: %u rendered, %u reused (%.0f%% idle)\n", framesRendered, framesReused,
+               100.0f * framesReused / (framesRendered + framesReused));
+    }
+    displayActive = false;
+    queuedBuffer = -1;
+    previousFrameStart = 0;
+    frameStartTime = 0;
+}
+
+void Renderer::WaitForIdle() {
+    if (!initialized) return;
+
+    u32 level = IRQ_Disable();
+    while (completedFrames != submittedFrames) {
+        LWP_ThreadSleep(frameQueue);
+    }
+    IRQ_Restore(level);
 }
 
 void Renderer::RenderMesh(const Mesh* mesh, const Camera& camera) {
@@ -255,6 +607,43 @@ void Renderer::RenderMesh(const Mesh* mesh, const Camera& camera) {
         return;
     }
 
+    drawnMesh = mesh;
+    drawnMeshRevision = mesh->GetRevision();
+    drawnCameraRevision = camera.GetRevision();
+    drawnSettingsRevision = settingsRevision;
+
+    // Colors, vertex arrays and display lists are rebuilt once per mesh
+    // revision, in place of the previous revision's; a re-bake in place
+    // needs the buffer of a successful one
+    if (colorsStale && !vertexColors && !faceColors) {
+        meshDataRevision = 0;
+    }
+    // The previous frame may still be reading the colors and lists being
+    // replaced, so let the GPU finish it first
+    if (meshDataRevision != mesh->GetRevision()) {
+        meshDataRevision = mesh->GetRevision();
+        WaitForIdle();
+        ReleaseMeshData(mesh);
+        BakeColors(mesh);
+        PrepareVertexArrays(mesh);
+        PrepareCulling(mesh);
+        displayListMarker = mesh->GetArena() ? mesh->GetArena()->GetBackMarker() : 0;
+    } else if (colorsStale) {
+        // Same buffer, new colors: indexed lists fetch them from the array,
+        // anything else has them embedded and is recompiled
+        WaitForIdle();
+        BakeColors(mesh);
+        if (vertexIndexType != GX_DIRECT) {
+            DCFlushRange(vertexColors, mesh->GetRenderVertexCount() * sizeof(u32));
+        } else {
+            ReleaseDisplayLists(mesh);
+        }
+    }
+    colorsStale = false;
+
+    bool strips = UseStrips(mesh);
+    lodLevel = strips ? SelectLod(mesh, camera) : 0;
+
     // Set up camera view matrix
     Mtx view, model, modelView;
     camera.GetViewMatrix(view);
@@ -264,83 +653,628 @@ void Renderer::RenderMesh(const Mesh* mesh, const Camera& camera) {
     f32 maxSize = mesh->GetMaxSize();
     f32 scale = 20.0f / maxSize; // Scale to fit in a 20-unit cube
 
-    // Set up model matrix with scaling and centering
+    // Set up model matrix with scaling and centering. Quantized positions
+    // are already stored relative to the center, so they are drawn without
+    // the translation; culling works in model space and keeps it.
+    Mtx centeredModelView;
     guMtxIdentity(model);
     guMtxScaleApply(model, model, scale, scale, scale);
+    guMtxConcat(view, model, centeredModelView);
     guMtxTransApply(model, model, -center.x * scale, -center.y * scale, -center.z * scale);
 
     // Combine view and model matrices
     guMtxConcat(view, model, modelView);
-    GX_LoadPosMtxImm(modelView, GX_PNMTX0);
+    GX_LoadPosMtxImm(UseQuantizedVertices(mesh) ? centeredModelView : modelView, GX_PNMTX0);
 
     // Set up vertex format
-    SetupVertexFormat();
+    SetupVertexFormat(mesh);
+
+    // Compile each level once per mesh revision, the first time it is
+    // drawn, then replay its lists every frame
+    DisplayListSet& set = displayListSets[lodLevel];
+    if (displayListsEnabled && !set.compiled) {
+        CompileDisplayLists(mesh, set);
+    }
 
-    // Render triangles
-    RenderTriangles(mesh->GetTriangles(), mesh->GetTriangleCount(), mesh);
+    // Clustered geometry has one display list per cluster, so both paths
+    // can draw just the clusters that may be visible
+    const ClusterSet& clusters = GetActiveClusters(mesh);
+    bool culling = strips && clusters.clusterCount > 0 && visibleClusters;
+    u32 visibleCount = culling ? FindVisibleClusters(mesh, camera, modelView, scale) : 0;
+
+    if (displayListsEnabled && set.lists) {
+        int count = culling ? static_cast<int>(visibleCount) : set.count;
+        for (int i = 0; i < count; i++) {
+            const DisplayList& list = set.lists[culling ? visibleClusters[i] : i];
+            GX_CallDispList(list.data, list.size);
+
+            // The call itself is a 12 byte command; the list is fetched by the GPU
+            AccountBatch(list.vertexCount, list.triangleCount, 12);
+            frameStats.displayListBytes += list.size;
+        }
+    } else if (culling) {
+        for (u32 i = 0; i < visibleCount; i++) {
+            const MeshCluster& cluster = clusters.clusters[visibleClusters[i]];
+            SubmitRange(mesh, cluster.firstPrimitive, cluster.primitiveCount);
+        }
+    } else {
+        SubmitRange(mesh, 0, GetWorkUnitCount(mesh));
+    }
 }
 
-void Renderer::SetupVertexFormat() {
+u32 Renderer::FindVisibleClusters(const Mesh* mesh, const Camera& camera, Mtx modelView, f32 scale) {
+    ClusterView view;
+    guMtxCopy(modelView, view.modelView);
+    view.scale = scale;
+    view.tanHalfFovY = tanf(FIELD_OF_VIEW * 0.5f * static_cast<f32>(M_PI) / 180.0f);
+    view.tanHalfFovX = view.tanHalfFovY * ASPECT_RATIO;
+    view.nearPlane = NEAR_PLANE;
+    view.farPlane = FAR_PLANE;
+
+    // Clusters are in model space, which is centered and scaled into the
+    // world by the model matrix
+    Vector3 eye = camera.GetPosition();
+    Vector3 center = mesh->GetCenter();
+    view.eye = Vector3(eye.x / scale + center.x, eye.y / scale + center.y, eye.z / scale + center.z);
+
+    const ClusterSet& clusters = GetActiveClusters(mesh);
+    u32 visibleCount = ClusterCuller::FindVisible(clusters, view, visibleClusters);
+
+    u32 visibleTriangles = 0;
+    for (u32 i = 0; i < visibleCount; i++) {
+        visibleTriangles += clusters.clusters[visibleClusters[i]].triangleCount;
+    }
+    frameStats.clustersDrawn += visibleCount;
+    frameStats.clustersCulled += clusters.clusterCount - visibleCount;
+    frameStats.culledTriangles += GetActiveStrips(mesh).triangleCount - visibleTriangles;
+    return visibleCount;
+}
+
+int Renderer::SelectLod(const Mesh* mesh, const Camera& camera) const {
+    // Distance from the eye to the nearest point of the model's bounding
+    // sphere, in the 20-unit space the model is scaled into
+    f32 scale = 20.0f / mesh->GetMaxSize();
+    Vector3 minBounds = mesh->GetMinBounds();
+    Vector3 maxBounds = mesh->GetMaxBounds();
+    f32 dx = maxBounds.x - minBounds.x;
+    f32 dy = maxBounds.y - minBounds.y;
+    f32 dz = maxBounds.z - minBounds.z;
+    f32 radius = 0.5f * sqrtf(dx * dx + dy * dy + dz * dz) * scale;
+    f32 distance = camera.GetDistance() - radius;
+    if (distance < NEAR_PLANE) distance = NEAR_PLANE;
+
+    // Pixels per unit at that distance for the vertical field of view
+    f32 pixelsPerUnit = videoMode->efbHeight /
+                        (2.0f * distance * tanf(FIELD_OF_VIEW * 0.5f * static_cast<f32>(M_PI) / 180.0f));
+
+    // Coarsest level whose error stays below the threshold on screen
+    int level = 0;
+    for (int i = 0; i < mesh->GetLodCount(); i++) {
+        if (mesh->GetLod(i).error * scale * pixelsPerUnit > LOD_PIXEL_ERROR) break;
+        level = i + 1;
+    }
+    return level;
+}
+
+void Renderer::SetDisplayListsEnabled(bool enable) {
+    if (displayListsEnabled != enable) {
+        displayListsEnabled = enable;
+        settingsRevision++;
+    }
+}
+
+void Renderer::SetStripsEnabled(bool enable) {
+    if (stripsEnabled != enable) {
+        stripsEnabled = enable;
+        settingsRevision++;
+        meshDataRevision = 0; // Lists were recorded for the other path
+    }
+}
+
+void Renderer::SetVertexArraysEnabled(bool enable) {
+    if (vertexArraysEnabled != enable) {
+        vertexArraysEnabled = enable;
+        settingsRevision++;
+        meshDataRevision = 0;
+    }
+}
+
+void Renderer::SetBakedLighting(bool enable) {
+    if (lighting && lighting->IsBaked() != enable) {
+        lighting->SetBaked(enable);
+        settingsRevision++;
+        colorsStale = true; // Same colors lit or unlit, baked into the same buffer
+    }
+}
+
+void Renderer::SetColorScheme(ColorScheme* scheme) {
+    if (scheme && scheme != colorScheme) {
+        colorScheme = scheme;
+        settingsRevision++;
+        colorsStale = true;
+    }
+}
+
+void Renderer::ReleaseMeshData(const Mesh* mesh) {
+    // Everything baked for the previous revision is at the back of the mesh
+    // arena, or already gone if the mesh was cleared since
+    faceColors = nullptr;
+    vertexColors = nullptr;
+    visibleClusters = nullptr;
+    displayListMarker = 0;
+    ReleaseDisplayLists(mesh);
+}
+
+void Renderer::ReleaseDisplayLists(const Mesh* mesh) {
+    for (int i = 0; i <= Mesh::MAX_LODS; i++) {
+        displayListSets[i].Clear();
+    }
+    if (mesh->GetArena()) {
+        mesh->GetArena()->ResetBackToMarker(displayListMarker);
+    }
+}
+
+bool Renderer::BakeColors(const Mesh* mesh) {
+    Arena* arena = mesh->GetArena();
+    if (!arena) {
+        return false;
+    }
+
+    // Only the path in use needs colors: one per render vertex for strips,
+    // one per triangle otherwise. A re-bake reuses the buffer.
+    u64 startTime = gettime();
+    bool strips = UseStrips(mesh);
+    u32 count = static_cast<u32>(strips ? mesh->GetRenderVertexCount() : mesh->GetTriangleCount());
+    u32* colors = strips ? vertexColors : faceColors;
+    if (!colors) {
+        colors = static_cast<u32*>(arena->AllocateBack(count * sizeof(u32)));
+    }
+    if (!colors) {
+        printf("ERROR: Baked colors need %u KB but the mesh arena has %u KB free\n",
+               count * static_cast<u32>(sizeof(u32)) / 1024, arena->GetRemaining() / 1024);
+        return false;
+    }
+
+    if (strips) {
+        ColorScheme::BakeVertexColors(*mesh, *colorScheme, colors);
+        vertexColors = colors;
+    } else {
+        ColorScheme::BakeFaceColors(*mesh, *colorScheme, colors);
+        faceColors = colors;
+    }
+
+    if (IsBakedLighting()) {
+        BakeLighting(mesh, colors, count, strips);
+    }
+
+    printf("Baked %u %s colors (%s%s) in %.1f ms\n", count, strips ? "vertex" : "face",
+           colorScheme->GetName(), IsBakedLighting() ? ", lit" : "",
+           diff_usec(startTime, gettime()) / 1000.0f);
+    return true;
+}
+
+void Renderer::BakeLighting(const Mesh* mesh, u32* colors, u32 count, bool perVertex) {
+    // Vertex colors follow the render normals; face colors the facet normals
+    const Vector3* normals = mesh->GetRenderNormals();
+
+    // Keep a few unlit materials to check the bake against the reference
+    u32 samples[BAKE_VALIDATION_SAMPLES];
+    Vector3 sampleNormals[BAKE_VALIDATION_SAMPLES];
+    u32 sampleCount = 0;
+    u32 sampleStride = count / BAKE_VALIDATION_SAMPLES + 1;
+
+    for (u32 i = 0; i < count; i++) {
+        const Vector3& normal = perVertex ? normals[i] : mesh->GetFaceNormal(static_cast<int>(i));
+        if (i % sampleStride == 0 && sampleCount < BAKE_VALIDATION_SAMPLES) {
+            samples[sampleCount] = colors[i];
+            sampleNormals[sampleCount] = normal;
+            sampleCount++;
+        }
+        colors[i] = LightingSystem::ApplyLighting(colors[i], normal);
+    }
+
+    // Compare against the lit values of the sampled entries
+    u32 lit[BAKE_VALIDATION_SAMPLES];
+    for (u32 i = 0; i < sampleCount; i++) {
+        lit[i] = colors[i * sampleStride];
+    }
+    u32 error = LightingSystem::ValidateBake(sampleNormals, samples, lit, sampleCount, 1);
+    if (error > 1) {
+        printf("WARNING: Baked lighting differs from the reference by %u/255\n", error);
+    }
+}
+
+bool Renderer::PrepareVertexArrays(const Mesh* mesh) {
+    vertexIndexType = GX_DIRECT;
+
+    if (!vertexArraysEnabled || !UseStrips(mesh) || !vertexColors) {
+        return false;
+    }
+
+    // The all-ones index is avoided, so 8-bit indices cover 255 vertices
+    // and 16-bit indices 65535
+    u32 count = static_cast<u32>(mesh->GetRenderVertexCount());
+    if (count > 0xffff) {
+        printf("Vertex arrays disabled: %u vertices exceed 16-bit indices\n", count);
+        return false;
+    }
+
+    // The GPU reads the arrays from main memory, bypassing the CPU caches
+    bool quantized = UseQuantizedVertices(mesh);
+    if (quantized) {
+        DCFlushRange(const_cast<s16*>(mesh->GetQuantizedPositions()), count * 3 * sizeof(s16));
+        DCFlushRange(const_cast<s8*>(mesh->GetQuantizedNormals()), count * 3 * sizeof(s8));
+    } else {
+        DCFlushRange(const_cast<Vector3*>(mesh->GetRenderPositions()), count * sizeof(Vector3));
+        DCFlushRange(const_cast<Vector3*>(mesh->GetRenderNormals()), count * sizeof(Vector3));
+    }
+    DCFlushRange(vertexColors, count * sizeof(u32));
+
+    vertexIndexType = (count <= 0xff) ? GX_INDEX8 : GX_INDEX16;
+
+    printf("Vertex arrays: %u %s vertices, %s indices (%u bytes per vertex vs %u direct)\n",
+           count, quantized ? "quantized" : "float", vertexIndexType == GX_INDEX8 ? "8-bit" : "16-bit",
+           GetStripVertexBytes(mesh), quantized ? QUANTIZED_VERTEX_BYTES : DIRECT_VERTEX_BYTES);
+    return true;
+}
+
+bool Renderer::PrepareCulling(const Mesh* mesh) {
+    Arena* arena = mesh->GetArena();
+    if (!arena || !mesh->HasStrips()) {
+        return false;
+    }
+
+    u32 capacity = mesh->GetClusters().clusterCount;
+    for (int i = 0; i < mesh->GetLodCount(); i++) {
+        if (mesh->GetLod(i).clusters.clusterCount > capacity) {
+            capacity = mesh->GetLod(i).clusters.clusterCount;
+        }
+    }
+    if (capacity == 0) {
+        return false;
+    }
+
+    visibleClusters = static_cast<u32*>(arena->AllocateBack(capacity * sizeof(u32)));
+    if (!visibleClusters) {
+        printf("Cluster culling disabled: no room for the visibility list\n");
+        return false;
+    }
+    return true;
+}
+
+u32 Renderer::GetStripVertexBytes(const Mesh* mesh) const {
+    // Position, normal and color each take one index
+    if (vertexIndexType == GX_INDEX16) return 3 * sizeof(u16);
+    if (vertexIndexType == GX_INDEX8) return 3 * sizeof(u8);
+    return UseQuantizedVertices(mesh) ? QUANTIZED_VERTEX_BYTES : DIRECT_VERTEX_BYTES;
+}
+
+int Renderer::GetWorkUnitCount(const Mesh* mesh) const {
+    return UseStrips(mesh) ? static_cast<int>(GetActiveStrips(mesh).primitiveCount) : mesh->GetTriangleCount();
+}
+
+void Renderer::SubmitRange(const Mesh* mesh, int first, int count) {
+    if (UseStrips(mesh)) {
+        SubmitStrips(mesh, first, count);
+    } else {
+        SubmitTriangles(mesh, first, count);
+    }
+}
+
+void Renderer::SubmitTriangles(const Mesh* mesh, int first, int count) {
+    // Split into primitives whose vertex count fits GX_Begin's u16
+    while (count > 0) {
+        int batch = (count < MAX_BATCH_TRIANGLES) ? count : MAX_BATCH_TRIANGLES;
+
+        const u32* colors = faceColors ? faceColors + first : nullptr;
+        RenderTriangles(mesh, first, colors, batch);
+
+        AccountBatch(batch * 3, batch, 3 + batch * 3 * DIRECT_VERTEX_BYTES);
+        first += batch;
+        count -= batch;
+    }
+}
+
+void Renderer::SubmitStrips(const Mesh* mesh, int first, int count) {
+    const StripSet& strips = GetActiveStrips(mesh);
+    u32 vertexBytes = GetStripVertexBytes(mesh);
+
+    for (int i = first; i < first + count; i++) {
+        const StripPrimitive& primitive = strips.primitives[i];
+        const u32* indices = strips.indices + primitive.firstIndex;
+        u32 n = primitive.indexCount;
+
+        // Primitives longer than GX_Begin's u16 count restart with enough
+        // overlap to continue seamlessly: strips resend their last edge
+        // (advancing by an even count keeps the winding), fans their pivot
+        // and last rim vertex
+        if (primitive.type == STRIP_PRIMITIVE_TRIANGLES) {
+            for (u32 start = 0; start < n; start += MAX_BATCH_TRIANGLES * 3) {
+                u32 length = n - start;
+                if (length > MAX_BATCH_TRIANGLES * 3) length = MAX_BATCH_TRIANGLES * 3;
+                RenderStripVertices(GX_TRIANGLES, mesh, nullptr, indices + start, length);
+                AccountBatch(length, length / 3, 3 + length * vertexBytes);
+            }
+        } else if (primitive.type == STRIP_PRIMITIVE_STRIP) {
+            for (u32 start = 0;; start += MAX_STRIP_VERTICES - 2) {
+                u32 length = n - start;
+                if (length > MAX_STRIP_VERTICES) length = MAX_STRIP_VERTICES;
+                RenderStripVertices(GX_TRIANGLESTRIP, mesh, nullptr, indices + start, length);
+                AccountBatch(length, length - 2, 3 + length * vertexBytes);
+                if (start + length >= n) break;
+            }
+        } else {
+            for (u32 start = 1;; start += MAX_STRIP_VERTICES - 2) {
+                u32 length = n - start;
+                if (length > MAX_STRIP_VERTICES - 1) length = MAX_STRIP_VERTICES - 1;
+                RenderStripVertices(GX_TRIANGLEFAN, mesh, indices, indices + start, length);
+                AccountBatch(length + 1, length - 1, 3 + (length + 1) * vertexBytes);
+                if (start + length >= n) break;
+            }
+        }
+    }
+}
+
+u32 Renderer::GetSubmittedVertexCount(const StripPrimitive& primitive, u32& segments) {
+    u32 n = primitive.indexCount;
+    if (primitive.type == STRIP_PRIMITIVE_TRIANGLES) {
+        segments = (n + MAX_BATCH_TRIANGLES * 3 - 1) / (MAX_BATCH_TRIANGLES * 3);
+        return n;
+    }
+
+    // Each extra segment covers MAX_STRIP_VERTICES - 2 new vertices and
+    // repeats two
+    segments = 1;
+    if (n > MAX_STRIP_VERTICES) {
+        segments += (n - MAX_STRIP_VERTICES + MAX_STRIP_VERTICES - 3) / (MAX_STRIP_VERTICES - 2);
+    }
+    return n + (segments - 1) * 2;
+}
+
+int Renderer::MeasureListRange(const Mesh* mesh, int first, int end, DisplayList& list) const {
+    list.triangleCount = 0;
+    list.vertexCount = 0;
+    list.size = 0;
+
+    // Triangle lists take a fixed number of triangles; strip lists take
+    // whole primitives until they reach about the same number
+    if (!UseStrips(mesh)) {
+        int count = end - first;
+        if (count > DISPLAY_LIST_TRIANGLES) count = DISPLAY_LIST_TRIANGLES;
+        int batches = (count + MAX_BATCH_TRIANGLES - 1) / MAX_BATCH_TRIANGLES;
+
+        list.triangleCount = count;
+        list.vertexCount = count * 3;
+        list.size = 3 * batches + list.vertexCount * DIRECT_VERTEX_BYTES;
+        return count;
+    }
+
+    const StripSet& strips = GetActiveStrips(mesh);
+    int count = 0;
+    while (first + count < end &&
+           (count == 0 || list.triangleCount < DISPLAY_LIST_TRIANGLES)) {
+        const StripPrimitive& primitive = strips.primitives[first + count];
+        u32 segments = 0;
+        u32 vertices = GetSubmittedVertexCount(primitive, segments);
+
+        list.triangleCount += primitive.GetTriangleCount();
+        list.vertexCount += vertices;
+        list.size += 3 * segments + vertices * GetStripVertexBytes(mesh);
+        count++;
+    }
+    return count;
+}
+
+void Renderer::AccountBatch(u32 vertexCount, u32 triangleCount, u32 fifoBytes) {
+    if (recordingDisplayList) {
+        return;
+    }
+
+    frameStats.batches++;
+    frameStats.vertices += vertexCount;
+    frameStats.triangles += triangleCount;
+    frameStats.fifoBytes += fifoBytes;
+
+    // Sample how far the CPU is ahead of the GPU in the FIFO
+    GXFifoObj fifo;
+    GX_GetCPUFifo(&fifo);
+    u32 fill = GX_GetFifoCount(&fifo);
+    if (fill > frameStats.peakFifoFill) {
+        frameStats.peakFifoFill = fill;
+    }
+}
+
+bool Renderer::CompileDisplayLists(const Mesh* mesh, DisplayListSet& set) {
+    set.Clear();
+    set.compiled = true;
+
+    Arena* arena = mesh->GetArena();
+    if (!arena) {
+        return false;
+    }
+
+    u64 startTime = gettime();
+    int unitCount = GetWorkUnitCount(mesh);
+
+    // Clustered geometry gets one list per cluster so culled clusters can
+    // be skipped; otherwise lists take about DISPLAY_LIST_TRIANGLES each
+    const ClusterSet& clusters = GetActiveClusters(mesh);
+    bool clustered = UseStrips(mesh) && clusters.clusterCount > 0;
+
+    int listCount = 0;
+    DisplayList range;
+    if (clustered) {
+        listCount = static_cast<int>(clusters.clusterCount);
+    } else {
+        for (int first = 0; first < unitCount; listCount++) {
+            first += MeasureListRange(mesh, first, unitCount, range);
+        }
+    }
+
+    u32 marker = arena->GetBackMarker();
+    DisplayList* lists = static_cast<DisplayList*>(arena->AllocateBack(listCount * sizeof(DisplayList)));
+    if (!lists) {
+        printf("Display lists disabled: no room for list table\n");
+        return false;
+    }
+
+    int first = 0;
+    for (int i = 0; i < listCount; i++) {
+        int end = clustered ? first + static_cast<int>(clusters.clusters[i].primitiveCount) : unitCount;
+        int count = MeasureListRange(mesh, first, end, range);
+
+        // GX_Begin commands (opcode + u16 count) and vertex data, then room
+        // for the NOP padding GX_EndDispList adds to reach 32 bytes; back
+        // blocks cannot hand an unused tail back, so it stays with the list
+        u32 capacity = (range.size + 63) & ~31u;
+        void* data = arena->AllocateBack(capacity);
+        if (!data) {
+            printf("Display lists disabled: %u KB needed, mesh arena has %u KB free\n",
+                   capacity / 1024, arena->GetRemaining() / 1024);
+            arena->ResetBackToMarker(marker);
+            set.bytes = 0;
+            return false;
+        }
+
+        DCInvalidateRange(data, capacity);
+        GX_BeginDispList(data, capacity);
+        recordingDisplayList = true;
+        SubmitRange(mesh, first, count);
+        recordingDisplayList = false;
+        u32 size = GX_EndDispList();
+
+        if (size == 0) {
+            printf("Display lists disabled: list %d overflowed\n", i);
+            arena->ResetBackToMarker(marker);
+            set.bytes = 0;
+            return false;
+        }
+
+        lists[i].data = data;
+        lists[i].size = size;
+        lists[i].triangleCount = range.triangleCount;
+        lists[i].vertexCount = range.vertexCount;
+        set.bytes += size;
+        first += count;
+    }
+
+    set.lists = lists;
+    set.count = listCount;
+    set.buildMicros = diff_usec(startTime, gettime());
+
+    if (lodLevel > 0) {
+        printf("Compiled %d display list(s) from LOD %d: %u KB in %.1f ms\n", set.count, lodLevel,
+               set.bytes / 1024, set.buildMicros / 1000.0f);
+    } else {
+        printf("Compiled %d display list(s) from %s: %u KB in %.1f ms\n", set.count,
+               UseStrips(mesh) ? "strips" : "triangles", set.bytes / 1024, set.buildMicros / 1000.0f);
+    }
+    return true;
+}
+
+void Renderer::SetupVertexFormat(const Mesh* mesh) {
     GX_ClearVtxDesc();
-    GX_SetVtxDesc(GX_VA_POS, GX_DIRECT);
-    GX_SetVtxDesc(GX_VA_NRM, GX_DIRECT);
-    GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
+    if (UseStrips(mesh) && vertexIndexType != GX_DIRECT) {
+        GX_SetVtxDesc(GX_VA_POS, vertexIndexType);
+        GX_SetVtxDesc(GX_VA_NRM, vertexIndexType);
+        GX_SetVtxDesc(GX_VA_CLR0, vertexIndexType);
+        if (UseQuantizedVertices(mesh)) {
+            GX_SetArray(GX_VA_POS, const_cast<s16*>(mesh->GetQuantizedPositions()), 3 * sizeof(s16));
+            GX_SetArray(GX_VA_NRM, const_cast<s8*>(mesh->GetQuantizedNormals()), 3 * sizeof(s8));
+        } else {
+            GX_SetArray(GX_VA_POS, const_cast<Vector3*>(mesh->GetRenderPositions()), sizeof(Vector3));
+            GX_SetArray(GX_VA_NRM, const_cast<Vector3*>(mesh->GetRenderNormals()), sizeof(Vector3));
+        }
+        GX_SetArray(GX_VA_CLR0, vertexColors, 4);
+    } else {
+        GX_SetVtxDesc(GX_VA_POS, GX_DIRECT);
+        GX_SetVtxDesc(GX_VA_NRM, GX_DIRECT);
+        GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
+    }
+
+    // Format 0: full precision floats (28 bytes per vertex)
     GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_POS, GX_POS_XYZ, GX_F32, 0);
     GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_NRM, GX_NRM_XYZ, GX_F32, 0);
     GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
+
+    // Format 1: quantized render vertices, s16 positions and s8 normals (13 bytes per vertex)
+    GX_SetVtxAttrFmt(GX_VTXFMT1, GX_VA_POS, GX_POS_XYZ, GX_S16, mesh->GetPositionFracBits());
+    GX_SetVtxAttrFmt(GX_VTXFMT1, GX_VA_NRM, GX_NRM_XYZ, GX_S8, Mesh::NORMAL_FRAC_BITS);
+    GX_SetVtxAttrFmt(GX_VTXFMT1, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
 }
 
-void Renderer::RenderTriangles(const Triangle* triangles, int count, const Mesh* mesh) {
+void Renderer::RenderTriangles(const Mesh* mesh, int first, const u32* colors, int count) {
     GX_Begin(GX_TRIANGLES, GX_VTXFMT0, count * 3);
 
+    // Facets come from the soup, or from the welded vertices once it is gone
     for (int i = 0; i < count; i++) {
-        const Triangle* tri = &triangles[i];
+        const Vector3& normal = mesh->GetFaceNormal(first + i);
 
-        // Get material color based on surface normal
-        u8 r, g, b;
-        GetMaterialColor(tri->normal, r, g, b);
+        // Baked material color - hardware lighting will be applied
+        u32 color = colors ? colors[i] : FALLBACK_COLOR;
 
         for (int j = 0; j < 3; j++) {
-            GX_Position3f32(tri->vertices[j].x, tri->vertices[j].y, tri->vertices[j].z);
-            GX_Normal3f32(tri->normal.x, tri->normal.y, tri->normal.z);
-            GX_Color4u8(r, g, b, 255); // Material color - hardware lighting will be applied
+            const Vector3& position = mesh->GetCorner(first + i, j);
+            GX_Position3f32(position.x, position.y, position.z);
+            GX_Normal3f32(normal.x, normal.y, normal.z);
+            GX_Color1u32(color);
         }
     }
 
     GX_End();
 }
 
-void Renderer::GetMaterialColor(const Vector3& normal, u8& r, u8& g, u8& b) const {
-    // Use material colors for different surface orientations to add variety
-    f32 normalY = normal.y;
-    f32 normalVariation = fabsf(normal.x + normal.z) * 0.3f;
-
-    // Base bitcoin orange with subtle variations based on normal direction
-    if (normalY > 0.3f) {
-        // Top-facing surfaces - brighter, more golden
-        r = static_cast<u8>(240 + normalVariation * 15);
-        g = static_cast<u8>(160 + normalVariation * 20);
-        b = static_cast<u8>(20 + normalVariation * 10);
-    } else if (normalY < -0.3f) {
-        // Bottom-facing surfaces - darker, more reddish
-        r = static_cast<u8>(180 + normalVariation * 15);
-        g = static_cast<u8>(80 + normalVariation * 15);
-        b = static_cast<u8>(10 + normalVariation * 5);
+void Renderer::RenderStripVertices(u8 primitive, const Mesh* mesh, const u32* pivot,
+                                   const u32* indices, u32 count) {
+    bool quantized = UseQuantizedVertices(mesh);
+    GX_Begin(primitive, quantized ? GX_VTXFMT1 : GX_VTXFMT0, count + (pivot ? 1 : 0));
+
+    // Indexed vertices are one index per attribute into the GX arrays
+    if (vertexIndexType == GX_INDEX16) {
+        if (pivot) EmitIndex16(*pivot);
+        for (u32 i = 0; i < count; i++) {
+            EmitIndex16(indices[i]);
+        }
+    } else if (vertexIndexType == GX_INDEX8) {
+        if (pivot) EmitIndex8(*pivot);
+        for (u32 i = 0; i < count; i++) {
+            EmitIndex8(indices[i]);
+        }
+    } else if (quantized) {
+        const s16* positions = mesh->GetQuantizedPositions();
+        const s8* normals = mesh->GetQuantizedNormals();
+        if (pivot) EmitQuantizedVertex(positions, normals, *pivot);
+        for (u32 i = 0; i < count; i++) {
+            EmitQuantizedVertex(positions, normals, indices[i]);
+        }
     } else {
-        // Side-facing surfaces - standard bitcoin orange
-        r = static_cast<u8>(220 + normalVariation * 15);
-        g = static_cast<u8>(140 + normalVariation * 15);
-        b = static_cast<u8>(15 + normalVariation * 10);
+        const Vector3* positions = mesh->GetRenderPositions();
+        const Vector3* normals = mesh->GetRenderNormals();
+        if (pivot) EmitRenderVertex(positions, normals, *pivot);
+        for (u32 i = 0; i < count; i++) {
+            EmitRenderVertex(positions, normals, indices[i]);
+        }
     }
 
-    // Clamp values to valid range
-    if (r > 255) r = 255;
-    if (g > 255) g = 255;
-    if (b > 255) b = 255;
+    GX_End();
 }
 
-void Renderer::SetFrameBuffer(void* buffer) {
-    frameBuffer = buffer;
+void Renderer::EmitRenderVertex(const Vector3* positions, const Vector3* normals, u32 index) {
+    const Vector3& position = positions[index];
+    const Vector3& normal = normals[index];
+
+    GX_Position3f32(position.x, position.y, position.z);
+    GX_Normal3f32(normal.x, normal.y, normal.z);
+    GX_Color1u32(vertexColors ? vertexColors[index] : FALLBACK_COLOR);
+}
+
+void Renderer::EmitQuantizedVertex(const s16* positions, const s8* normals, u32 index) {
+    const s16* position = positions + index * 3;
+    const s8* normal = normals + index * 3;
+
+    GX_Position3s16(position[0], position[1], position[2]);
+    GX_Normal3s8(normal[0], normal[1], normal[2]);
+    GX_Color1u32(vertexColors ? vertexColors[index] : FALLBACK_COLOR);
 }
 
 void Renderer::EnableDepthTesting(bool enable) {
@@ -355,12 +1289,33 @@ void Renderer::SetClearColor(u8 r, u8 g, u8 b, u8 a) {
     GX_SetCopyClear((GXColor){r, g, b, a}, 0x00ffffff);
 }
 
-void Renderer::CopyBuffersCallback(u32 unused) {
-    if (instance && instance->readyForCopy == GX_TRUE) {
-        GX_SetZMode(GX_TRUE, GX_LEQUAL, GX_TRUE);
-        GX_SetColorUpdate(GX_TRUE);
-        GX_CopyDisp(instance->frameBuffer, GX_TRUE);
-        GX_Flush();
-        instance->readyForCopy = GX_FALSE;
+void Renderer::DrawDoneCallback() {
+    // Interrupt context: the copy of the oldest frame in flight is complete
+    Renderer* renderer = instance;
+    if (!renderer) return;
+
+    u32 frame = renderer->completedFrames;
+    renderer->frameDoneTimes[frame % FRAME_RING] = gettime();
+    if (renderer->frameMetricSets[frame % FRAME_RING] >= 0) {
+        PerformanceHud::ReadCounters(renderer->frameCounters[frame % FRAME_RING]);
+    }
+    if (renderer->displayActive) {
+        renderer->queuedBuffer = renderer->frameTargets[frame % FRAME_RING];
     }
+    renderer->completedFrames = frame + 1;
+    LWP_ThreadBroadcast(renderer->frameQueue);
+}
+
+void Renderer::RetraceCallback(u32) {
+    // Interrupt context, before the video registers are latched: flipping
+    // here shows the newest finished frame from the next field on, never
+    // half of one
+    Renderer* renderer = instance;
+    if (!renderer || !renderer->displayActive || renderer->queuedBuffer < 0) return;
+
+    VIDEO_SetNextFramebuffer(renderer->frameBuffers[renderer->queuedBuffer]);
+    VIDEO_Flush();
+    renderer->shownBuffer = renderer->queuedBuffer;
+    renderer->queuedBuffer = -1;
+    LWP_ThreadBroadcast(renderer->frameQueue);
 }
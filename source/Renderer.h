@@ -3,6 +3,9 @@
 
 #include <gccore.h>
 #include "Mesh.h"
+#include "PerformanceHud.h"
+
+class ColorScheme;
 
 /**
  * Camera class for handling 3D view transformations
@@ -20,12 +23,19 @@ public:
     f32 GetRotationX() const { return rotationX; }
     f32 GetRotationY() const { return rotationY; }
 
+    // Eye position in world space; the camera always looks at the origin
+    Vector3 GetPosition() const;
+
+    // Changes whenever the view does
+    u32 GetRevision() const { return revision; }
+
     void GetViewMatrix(Mtx view) const;
 
 private:
     f32 distance;
     f32 rotationX;
     f32 rotationY;
+    u32 revision;
 
     static const f32 MIN_DISTANCE;
     static const f32 MAX_DISTANCE;
@@ -33,7 +43,18 @@ private:
 };
 
 /**
- * Lighting system for enhanced 3D rendering
+ * Directional light shared by the hardware setup and the CPU bake.
+ * The direction points from the surface towards the light.
+ */
+struct DirectionalLight {
+    Vector3 direction;
+    GXColor color;
+};
+
+/**
+ * Lighting system for enhanced 3D rendering. Lights are either evaluated by
+ * the GX color channel per vertex, or baked into vertex colors on the CPU
+ * with channel lighting switched off.
  */
 class LightingSystem {
 public:
@@ -42,11 +63,93 @@ public:
     void Initialize();
     void SetupLights();
 
+    void SetBaked(bool enable);
+    bool IsBaked() const { return baked; }
+
+    // Light a packed 0xRRGGBBAA material color for a unit normal the way
+    // the color channel does: material * clamp(ambient + sum of diffuse)
+    static u32 ApplyLighting(u32 material, const Vector3& normal);
+
+    // Double precision reference for the same model, with unnormalized
+    // inputs; out receives unrounded 0-255 channel values
+    static void EvaluateReference(u32 material, const Vector3& normal, f64 out[3]);
+
+    // Largest per-channel difference between baked colors and the reference
+    // over every stride-th entry
+    static u32 ValidateBake(const Vector3* normals, const u32* materials, const u32* baked,
+                            u32 count, u32 stride);
+
+    static const int LIGHT_COUNT = 4;
+
 private:
-    void SetupKeyLight();
-    void SetupFillLight();
-    void SetupRimLight();
-    void SetupBounceLight();
+    bool baked;
+
+    static const DirectionalLight lights[LIGHT_COUNT];
+    static const GXColor ambient;
+
+    void LoadLight(const DirectionalLight& light, u8 id);
+};
+
+/**
+ * Compiled GX display list covering a run of the mesh's triangles or strips
+ */
+struct DisplayList {
+    void* data;
+    u32 size;
+    u32 triangleCount;
+    u32 vertexCount;
+};
+
+/**
+ * Display lists for one level of detail, compiled on first use
+ */
+struct DisplayListSet {
+    DisplayList* lists;
+    int count;
+    u32 bytes;
+    u32 buildMicros;
+    bool compiled;      // Also set when compiling failed, so it is not retried
+
+    DisplayListSet() { Clear(); }
+
+    void Clear() {
+        lists = nullptr;
+        count = 0;
+        bytes = 0;
+        buildMicros = 0;
+        compiled = false;
+    }
+};
+
+/**
+ * Per-frame submission counters
+ */
+struct RenderStats {
+    u32 batches;            // GX_Begin primitives and display list calls
+    u32 vertices;
+    u32 triangles;
+    u32 fifoBytes;          // Bytes written into the CPU FIFO
+    u32 displayListBytes;   // Bytes the GPU fetched from display lists
+    u32 peakFifoFill;       // Highest FIFO occupancy sampled between batches
+    u32 clustersDrawn;
+    u32 clustersCulled;     // Outside the frustum or facing away
+    u32 culledTriangles;
+
+    // Frame timing. The CPU builds a frame while the GPU still draws the one
+    // before, so cpuMicros + gpuMicros can exceed frameMicros.
+    u32 cpuMicros;          // Building this frame's commands
+    u32 waitMicros;         // Blocked on the GPU or a free frame buffer
+    u32 gpuMicros;          // Latest frame the GPU finished, first command to draw done
+    u32 frameMicros;        // Since the previous frame began
+
+    RenderStats() { Clear(); }
+
+    void Clear() {
+        batches = vertices = triangles = 0;
+        fifoBytes = displayListBytes = peakFifoFill = 0;
+        clustersDrawn = clustersCulled = culledTriangles = 0;
+        cpuMicros = waitMicros = gpuMicros = frameMicros = 0;
+    }
 };
 
 /**
@@ -54,41 +157,220 @@ private:
  */
 class Renderer {
 public:
+    static const int DEFAULT_FRAME_BUFFERS = 2;
+    static const int MAX_FRAME_BUFFERS = 3;
+
     Renderer();
     ~Renderer();
 
-    bool Initialize(GXRModeObj* videoMode);
+    // bufferCount external frame buffers (2 or 3) are allocated; a third
+    // lets the CPU start a frame before the previous one has been shown
+    bool Initialize(GXRModeObj* videoMode, int bufferCount = DEFAULT_FRAME_BUFFERS);
     void Shutdown();
 
+    // EndFrame queues the copy to a free frame buffer and returns without
+    // waiting for the GPU; the buffer is shown at the first retrace after
+    // the GPU finishes. BeginFrame only waits if the GPU is a full frame
+    // behind.
     void BeginFrame();
     void EndFrame();
-    void Present();
+
+    // Show the renderer's frame buffers, or stop: ReleaseDisplay waits for
+    // the GPU to finish, so mesh data may be changed and another buffer
+    // shown afterwards
+    void AcquireDisplay();
+    void ReleaseDisplay();
+    void WaitForIdle();
+
+    // Whether drawing mesh from camera would change what is on screen.
+    // When it would not, ReuseFrame counts the frame and the shown buffer
+    // simply stays up.
+    bool NeedsRedraw(const Mesh* mesh, const Camera& camera) const;
+    void ReuseFrame();
+    u32 GetFramesRendered() const { return framesRendered; }
+    u32 GetFramesReused() const { return framesReused; }
+
+    // Performance overlay; while shown every frame is redrawn
+    void SetHudVisible(bool visible);
+    bool IsHudVisible() const { return hud.IsVisible(); }
 
     void RenderMesh(const Mesh* mesh, const Camera& camera);
-    void SetFrameBuffer(void* frameBuffer);
 
     // Rendering state
     void EnableDepthTesting(bool enable);
     void SetClearColor(u8 r, u8 g, u8 b, u8 a);
+    void SetDisplayListsEnabled(bool enable);
+    void SetStripsEnabled(bool enable);
+    void SetVertexArraysEnabled(bool enable);
+    void SetColorScheme(ColorScheme* scheme);
+    void SetBakedLighting(bool enable);
+    bool IsBakedLighting() const { return lighting && lighting->IsBaked(); }
+    ColorScheme* GetColorScheme() const { return colorScheme; }
+
+    // Statistics for the last frame and the FIFO it was submitted through
+    const RenderStats& GetFrameStats() const { return frameStats; }
+    static u32 GetFifoSize() { return FIFO_SIZE; }
+
+    // Display list statistics for the current mesh at the level last drawn
+    int GetDisplayListCount() const { return displayListSets[lodLevel].count; }
+    u32 GetDisplayListBytes() const { return displayListSets[lodLevel].bytes; }
+    u32 GetDisplayListBuildMicros() const { return displayListSets[lodLevel].buildMicros; }
+
+    // Level of detail last drawn: 0 for the full mesh, otherwise
+    // Mesh::GetLod(level - 1)
+    int GetLodLevel() const { return lodLevel; }
 
 private:
     GXRModeObj* videoMode;
-    void* frameBuffer;
     void* fifoBuffer;
     LightingSystem* lighting;
 
     bool initialized;
-    vu8 readyForCopy;
+
+    // Frame buffers cycle between shown, queued for the next retrace,
+    // awaiting the copy of a frame in flight, and free. Frames in flight
+    // are those submitted but not yet signalled by the draw done callback;
+    // per-frame entries are indexed by frame number modulo FRAME_RING.
+    void* frameBuffers[MAX_FRAME_BUFFERS];
+    int frameBufferCount;
+    vs32 shownBuffer;
+    vs32 queuedBuffer;
+    volatile bool displayActive;
+    vu32 submittedFrames;
+    vu32 completedFrames;
+    static const u32 FRAME_RING = 4;
+    s32 frameTargets[FRAME_RING];
+    u64 frameStartTimes[FRAME_RING];
+    volatile u64 frameDoneTimes[FRAME_RING];
+    s32 frameMetricSets[FRAME_RING];        // -1 when the HUD was hidden
+    GpuCounterSample frameCounters[FRAME_RING];
+    lwpq_t frameQueue;
+
+    // Timing of the frame being built and the running report
+    u64 frameStartTime;
+    u64 previousFrameStart;
+    u32 frameWaitMicros;
+    u32 lastGpuMicros;
+    u32 timedFrames;
+    u64 cpuMicrosTotal;
+    u64 gpuMicrosTotal;
+    u64 waitMicrosTotal;
+    u64 frameMicrosTotal;
+
+    // What the latest frame showed, for redraw on demand; settingsRevision
+    // changes with every setting that affects the image
+    const Mesh* drawnMesh;
+    u32 drawnMeshRevision;
+    u32 drawnCameraRevision;
+    u32 drawnSettingsRevision;
+    u32 settingsRevision;
+    bool frameValid;
+    u32 framesRendered;
+    u32 framesReused;
+
+    PerformanceHud hud;
+    u32 countedFrames;      // Finished frames whose counters reached the HUD
+
+    // Display lists compiled for the mesh revision they were built from
+    bool displayListsEnabled;
+    bool stripsEnabled;
+
+    // Indexed vertex arrays for the strip path: positions and normals come
+    // from the mesh, quantized if it has them, colors from the bake below.
+    // vertexIndexType is GX_DIRECT when strips are sent with full vertices.
+    bool vertexArraysEnabled;
+    u32* vertexColors;
+    u8 vertexIndexType;
+
+    // Colors baked by the active scheme, per render vertex (vertexColors)
+    // or per triangle, for the mesh revision in meshDataRevision. They and
+    // the rest of the per-mesh data live at the back of the mesh arena,
+    // which is rewound when the revision is rebuilt; display lists sit
+    // below displayListMarker so they can be dropped on their own when the
+    // colors are re-baked in place after a scheme or lighting change
+    // (colorsStale).
+    ColorScheme* colorScheme;
+    u32* faceColors;
+    u32 meshDataRevision;
+    bool colorsStale;
+    bool recordingDisplayList;
+    DisplayListSet displayListSets[Mesh::MAX_LODS + 1];
+    u32 displayListMarker;
+
+    // Level chosen for the current frame; only the strip path has levels
+    int lodLevel;
+
+    // Clusters found visible this frame, with room for the largest set of
+    // the current mesh revision
+    u32* visibleClusters;
+
+    RenderStats frameStats;
 
     static const u32 FIFO_SIZE = 256 * 1024;
+    static const u32 MAX_FRAMES_AHEAD = 1;         // Unfinished GPU frames when a new one begins
+    static const u32 TIMING_REPORT_FRAMES = 600;
+    static const int MAX_BATCH_TRIANGLES = 65535 / 3; // GX_Begin takes a u16 vertex count
+    static const int DISPLAY_LIST_TRIANGLES = 8192;
+    static const u32 MAX_STRIP_VERTICES = 65534;   // Even, so split strips keep their winding
+    static const u32 BAKE_VALIDATION_SAMPLES = 64;
+    static const u32 FALLBACK_COLOR = 0xdc8c0fff;   // Used if colors could not be baked
+    static const u32 DIRECT_VERTEX_BYTES = 3 * sizeof(f32) + 3 * sizeof(f32) + 4;
+    static const u32 QUANTIZED_VERTEX_BYTES = 3 * sizeof(s16) + 3 * sizeof(s8) + 4;
+    static const f32 LOD_PIXEL_ERROR;
+    static const f32 FIELD_OF_VIEW;
+    static const f32 ASPECT_RATIO;
+    static const f32 NEAR_PLANE;
+    static const f32 FAR_PLANE;
 
     void InitializeGraphicsPipeline();
     void SetupProjectionMatrix();
-    void SetupVertexFormat();
-    void RenderTriangles(const Triangle* triangles, int count, const Mesh* mesh);
-    void GetMaterialColor(const Vector3& normal, u8& r, u8& g, u8& b) const;
+    void SetupVertexFormat(const Mesh* mesh);
+    void ReleaseMeshData(const Mesh* mesh);
+    void ReleaseDisplayLists(const Mesh* mesh);
+    bool BakeColors(const Mesh* mesh);
+    void BakeLighting(const Mesh* mesh, u32* colors, u32 count, bool perVertex);
+    bool PrepareVertexArrays(const Mesh* mesh);
+    bool PrepareCulling(const Mesh* mesh);
+    u32 FindVisibleClusters(const Mesh* mesh, const Camera& camera, Mtx modelView, f32 scale);
+    u32 GetStripVertexBytes(const Mesh* mesh) const;
+    bool CompileDisplayLists(const Mesh* mesh, DisplayListSet& set);
+    int SelectLod(const Mesh* mesh, const Camera& camera) const;
+
+    // Geometry is submitted in work units: strip primitives when the mesh
+    // has strips and they are enabled, triangles otherwise
+    bool UseStrips(const Mesh* mesh) const { return stripsEnabled && mesh->HasStrips(); }
+
+    // Strips use the s16/s8 copy when the mesh has one, whether sent as
+    // full vertices or as indices into the vertex arrays
+    bool UseQuantizedVertices(const Mesh* mesh) const {
+        return UseStrips(mesh) && mesh->IsQuantized();
+    }
+    const StripSet& GetActiveStrips(const Mesh* mesh) const {
+        return lodLevel > 0 ? mesh->GetLod(lodLevel - 1).strips : mesh->GetStrips();
+    }
+    const ClusterSet& GetActiveClusters(const Mesh* mesh) const {
+        return lodLevel > 0 ? mesh->GetLod(lodLevel - 1).clusters : mesh->GetClusters();
+    }
+    int GetWorkUnitCount(const Mesh* mesh) const;
+    int MeasureListRange(const Mesh* mesh, int first, int end, DisplayList& list) const;
+    static u32 GetSubmittedVertexCount(const StripPrimitive& primitive, u32& segments);
+    void SubmitRange(const Mesh* mesh, int first, int count);
+    void SubmitTriangles(const Mesh* mesh, int first, int count);
+    void SubmitStrips(const Mesh* mesh, int first, int count);
+    void AccountBatch(u32 vertexCount, u32 triangleCount, u32 fifoBytes);
+    void RenderTriangles(const Mesh* mesh, int first, const u32* colors, int count);
+    void RenderStripVertices(u8 primitive, const Mesh* mesh, const u32* pivot,
+                             const u32* indices, u32 count);
+    void EmitRenderVertex(const Vector3* positions, const Vector3* normals, u32 index);
+    void EmitQuantizedVertex(const s16* positions, const s8* normals, u32 index);
+
+    int AcquireFrameBuffer();
+    bool IsBufferBusy(int buffer) const;
+    void AccountFrameTiming();
+    void DrawHud();
 
-    static void CopyBuffersCallback(u32 unused);
+    static void DrawDoneCallback();
+    static void RetraceCallback(u32 retraceCount);
     static Renderer* instance; // For callback
 };
 
@@ -1,15 +1,21 @@
 #include "STLViewer.h"
+#include "ColorScheme.h"
 #include "FileManager.h"
 #include "Renderer.h"
 #include "InputHandler.h"
 #include "UI.h"
 #include "Mesh.h"
+#include "MeshLoadJob.h"
+#include "MemorySystem.h"
 #include <cstdio>
 #include <cstdlib>
 
+// Menu frame time given to rechecking the media while nothing else happens
+static const u32 INDEX_UPDATE_BUDGET_MICROS = 8000;
+
 STLViewer::STLViewer() : fileManager(nullptr), renderer(nullptr), inputHandler(nullptr),
                          ui(nullptr), currentState(STATE_MENU), currentMesh(nullptr),
-                         selectedFileIndex(0), frameBuffer(nullptr), consoleBuffer(nullptr),
+                         loadJob(nullptr), selectedFileIndex(0), colorSchemeIndex(0), consoleBuffer(nullptr),
                          videoMode(nullptr) {
 }
 
@@ -30,13 +36,6 @@ bool STLViewer::Initialize() {
         return false;
     }
 
-    // Allocate frame buffer for 3D rendering
-    frameBuffer = MEM_K0_TO_K1(SYS_AllocateFramebuffer(videoMode));
-    if (!frameBuffer) {
-        printf("ERROR: Failed to allocate frame buffer\n");
-        return false;
-    }
-
     // Allocate console buffer for menu display
     consoleBuffer = MEM_K0_TO_K1(SYS_AllocateFramebuffer(videoMode));
     if (!consoleBuffer) {
@@ -52,6 +51,13 @@ bool STLViewer::Initialize() {
     VIDEO_WaitVSync();
     if(videoMode->viTVMode & VI_NON_INTERLACE) VIDEO_WaitVSync();
 
+    // Reserve the fixed memory arenas before anything else claims the heap,
+    // leaving room for the renderer's frame buffers
+    if (!MemorySystem::Initialize(Renderer::MAX_FRAME_BUFFERS * VIDEO_GetFrameBufferSize(videoMode))) {
+        printf("ERROR: Memory arena initialization failed\n");
+        return false;
+    }
+
     // Initialize components
     fileManager = new FileManager();
     if (!fileManager->Initialize()) {
@@ -64,7 +70,6 @@ bool STLViewer::Initialize() {
         printf("ERROR: Renderer initialization failed\n");
         return false;
     }
-    renderer->SetFrameBuffer(frameBuffer);
 
     inputHandler = new InputHandler();
     inputHandler->Initialize();
@@ -75,8 +80,9 @@ bool STLViewer::Initialize() {
         return false;
     }
 
-    // Initialize mesh
-    currentMesh = new Mesh();
+    // Initialize mesh and its background loader
+    currentMesh = new Mesh(&MemorySystem::GetMeshArena());
+    loadJob = new MeshLoadJob();
 
     // Set initial state
     currentState = STATE_MENU;
@@ -113,15 +119,19 @@ void STLViewer::Run() {
                 UpdateMenu();
                 break;
 
+            case STATE_LOADING:
+                UpdateLoading();
+                break;
+
             case STATE_RENDERING:
                 UpdateRendering();
                 break;
         }
 
-        // Present frame
-        if (currentState == STATE_RENDERING) {
-            renderer->Present();
-        } else {
+        // Rendered frames are paced by the renderer's frame buffers, idle
+        // viewer frames in UpdateRendering; the menu and loading screens
+        // by the retrace
+        if (currentState != STATE_RENDERING) {
             VIDEO_WaitVSync();
         }
     }
@@ -130,6 +140,20 @@ void STLViewer::Run() {
 }
 
 void STLViewer::Shutdown() {
+    // Let the GPU finish with the mesh before it is released
+    if (renderer) {
+        renderer->ReleaseDisplay();
+    }
+
+    // Stop any load in flight before releasing the mesh it writes to
+    if (loadJob) {
+        loadJob->Cancel();
+        loadJob->Finish();
+        loadJob->FlushDeferredWork();
+        delete loadJob;
+        loadJob = nullptr;
+    }
+
     if (currentMesh) {
         delete currentMesh;
         currentMesh = nullptr;
@@ -151,11 +175,14 @@ void STLViewer::Shutdown() {
     }
 
     if (fileManager) {
+        fileManager->SaveIndex();
         delete fileManager;
         fileManager = nullptr;
     }
 
-    // Note: frameBuffer and consoleBuffer are managed by the system
+    MemorySystem::Shutdown();
+
+    // Note: consoleBuffer is managed by the system
 }
 
 void STLViewer::UpdateMenu() {
@@ -177,17 +204,35 @@ void STLViewer::UpdateMenu() {
     if (input.aPressed && fileManager->GetFileCount() > 0) {
         const FileEntry* selectedFile = fileManager->GetFile(selectedFileIndex);
         if (selectedFile) {
-            ui->ShowLoadingScreen(selectedFile->name);
-
-            if (currentMesh->LoadFromSTL(selectedFile->path.c_str())) {
-                printf("Successfully loaded: %s\n", selectedFile->name.c_str());
-                SwitchToRenderMode();
+            if (loadJob->Start(selectedFile->path, currentMesh)) {
+                ui->ShowLoadingScreen(selectedFile->name);
+                currentState = STATE_LOADING;
                 return;
-            } else {
-                printf("Failed to load: %s\n", selectedFile->name.c_str());
-                ui->ShowStatusBox("Failed to load STL file!");
-                needsRedraw = true;
             }
+
+            ui->ShowStatusBox("Failed to start loading!");
+        }
+    }
+
+    // Otherwise the frame goes to the last model's cache sidecar, then to
+    // keeping the file index current. The selection follows its file if the
+    // list is reordered, and the info box is redrawn once the selected
+    // file's header has been read.
+    if (!needsRedraw && loadJob->RunDeferredStep()) {
+        return;
+    }
+    if (!needsRedraw && !fileManager->IsIndexUpToDate()) {
+        const FileEntry* selectedFile = fileManager->GetFile(selectedFileIndex);
+        std::string selectedPath = selectedFile ? selectedFile->path : "";
+        u32 selectedFlags = selectedFile ? selectedFile->flags : 0;
+
+        if (fileManager->UpdateIndex(INDEX_UPDATE_BUDGET_MICROS)) {
+            int index = fileManager->FindFile(selectedPath);
+            selectedFileIndex = index >= 0 ? index : 0;
+            needsRedraw = true;
+        } else {
+            selectedFile = fileManager->GetFile(selectedFileIndex);
+            needsRedraw = selectedFile && selectedFile->flags != selectedFlags;
         }
     }
 
@@ -197,6 +242,40 @@ void STLViewer::UpdateMenu() {
     }
 }
 
+void STLViewer::UpdateLoading() {
+    const InputState& input = inputHandler->GetCurrentState();
+
+    if (input.bPressed) {
+        loadJob->Cancel();
+    }
+
+    if (!loadJob->IsFinished()) {
+        const MeshLoadProgress& progress = loadJob->GetProgress();
+        ui->ShowLoadingProgress(loadJob->WasCancelled() ? "Cancelling" : loadJob->GetPhaseName(),
+                                progress.bytesProcessed, progress.bytesTotal,
+                                progress.trianglesProcessed);
+        return;
+    }
+
+    bool cancelled = loadJob->WasCancelled();
+    const FileEntry* selectedFile = fileManager->GetFile(selectedFileIndex);
+
+    if (loadJob->Finish()) {
+        printf("Successfully loaded: %s\n", selectedFile ? selectedFile->name.c_str() : "");
+        if (selectedFile) {
+            fileManager->RecordLoadedModel(selectedFile->path, *currentMesh,
+                                           MemorySystem::GetMeshArena().GetUsed());
+        }
+        SwitchToRenderMode();
+        return;
+    }
+
+    printf("%s: %s\n", cancelled ? "Cancelled loading" : "Failed to load",
+           selectedFile ? selectedFile->name.c_str() : "");
+    SwitchToMenuMode();
+    ui->ShowStatusBox(cancelled ? "Loading cancelled" : "Failed to load STL file!");
+}
+
 void STLViewer::UpdateRendering() {
     const InputState& input = inputHandler->GetCurrentState();
     static Camera camera; // Static to maintain state between frames
@@ -214,20 +293,50 @@ void STLViewer::UpdateRendering() {
         camera.AdjustRotation(deltaX, deltaY);
     }
 
+    // Cycle the material color scheme; colors are rebaked once
+    if (input.xPressed) {
+        colorSchemeIndex = (colorSchemeIndex + 1) % ColorScheme::GetSchemeCount();
+        renderer->SetColorScheme(ColorScheme::GetScheme(colorSchemeIndex));
+        printf("Color scheme: %s\n", renderer->GetColorScheme()->GetName());
+    }
+
+    // Toggle between hardware lights and lighting baked into vertex colors
+    if (input.aPressed) {
+        renderer->SetBakedLighting(!renderer->IsBakedLighting());
+        printf("Lighting: %s\n", renderer->IsBakedLighting() ? "baked" : "hardware");
+    }
+
+    // Toggle the performance overlay
+    if (input.yPressed) {
+        renderer->SetHudVisible(!renderer->IsHudVisible());
+    }
+
     // Handle zoom
     f32 zoomDelta = inputHandler->GetZoomDelta();
     if (zoomDelta != 0.0f) {
         camera.AdjustDistance(zoomDelta);
     }
 
-    // Render the scene
-    renderer->BeginFrame();
-    renderer->RenderMesh(currentMesh, camera);
-    renderer->EndFrame();
+    // Render the scene only when the picture would change. Otherwise the
+    // last frame stays on screen and the time goes to deferred load work.
+    if (renderer->NeedsRedraw(currentMesh, camera)) {
+        renderer->BeginFrame();
+        renderer->RenderMesh(currentMesh, camera);
+        renderer->EndFrame();
+    } else {
+        renderer->ReuseFrame();
+        loadJob->RunDeferredStep();
+        VIDEO_WaitVSync();
+    }
 }
 
 void STLViewer::SwitchToMenuMode() {
     currentState = STATE_MENU;
+
+    // The GPU may still be drawing the last frame from the mesh, which the
+    // menu is about to unload
+    renderer->ReleaseDisplay();
+    fileManager->SaveIndex();
     VIDEO_SetNextFramebuffer(consoleBuffer);
     VIDEO_SetBlack(FALSE);
     VIDEO_Flush();
@@ -238,7 +347,5 @@ void STLViewer::SwitchToMenuMode() {
 
 void STLViewer::SwitchToRenderMode() {
     currentState = STATE_RENDERING;
-    VIDEO_SetNextFramebuffer(frameBuffer);
-    VIDEO_SetBlack(FALSE);
-    VIDEO_Flush();
+    renderer->AcquireDisplay();
 }
@@ -11,6 +11,7 @@ class FileManager;
 class Renderer;
 class InputHandler;
 class UI;
+class MeshLoadJob;
 
 /**
  * Main application class that coordinates all components
@@ -27,7 +28,8 @@ public:
 private:
     enum AppState {
         STATE_MENU = 0,
-        STATE_RENDERING = 1
+        STATE_RENDERING = 1,
+        STATE_LOADING = 2
     };
 
     // Core components
@@ -39,14 +41,16 @@ private:
     // Application state
     AppState currentState;
     Mesh* currentMesh;
+    MeshLoadJob* loadJob;
     int selectedFileIndex;
+    int colorSchemeIndex;
 
     // Video system
-    void* frameBuffer;
     void* consoleBuffer;
     GXRModeObj* videoMode;
 
     void UpdateMenu();
+    void UpdateLoading();
     void UpdateRendering();
     void SwitchToMenuMode();
     void SwitchToRenderMode();
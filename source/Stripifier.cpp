@@ -0,0 +1,259 @@
+#include "Stripifier.h"
+#include "Log.h"
+#include <cstring>
+
+f32 StripSet::GetAverageStripLength() const {
+    u32 runs = stripCount + fanCount;
+    if (runs == 0) return 0.0f;
+    return static_cast<f32>(triangleCount - looseTriangleCount) / static_cast<f32>(runs);
+}
+
+f32 StripSet::GetVerticesPerTriangle() const {
+    if (triangleCount == 0) return 0.0f;
+    return static_cast<f32>(indexCount) / static_cast<f32>(triangleCount);
+}
+
+namespace {
+
+const u32 NO_TRIANGLE = 0xffffffff;
+const u32 COMMITTED = 0xffffffff;
+
+/**
+ * Walks triangle adjacency through a vertex-to-triangle table. Candidate
+ * runs are grown tentatively by tagging triangles with the current stamp;
+ * only the chosen run is committed and written out.
+ */
+struct StripBuilder {
+    const u32* triangles;
+    const u32* faceStart;
+    const u32* faceList;
+    u32* used;
+    u32 stamp;
+    u32 rangeBegin;     // Runs stay within the current triangle range
+    u32 rangeEnd;
+
+    bool IsFree(u32 face) const {
+        return face >= rangeBegin && face < rangeEnd && used[face] != COMMITTED && used[face] != stamp;
+    }
+
+    // Find a free triangle containing the directed edge from -> to, which
+    // keeps the winding of the run consistent with the source triangles
+    u32 FindNeighbor(u32 from, u32 to, u32& third) const {
+        for (u32 i = faceStart[from]; i < faceStart[from + 1]; i++) {
+            u32 face = faceList[i];
+            if (!IsFree(face)) continue;
+
+            const u32* tri = triangles + face * 3;
+            for (int k = 0; k < 3; k++) {
+                if (tri[k] == from && tri[(k + 1) % 3] == to) {
+                    third = tri[(k + 2) % 3];
+                    return face;
+                }
+            }
+        }
+        return NO_TRIANGLE;
+    }
+
+    // Grow a strip (or a fan around the first corner) from seed, starting at
+    // the given rotation. With out == nullptr the run is only measured.
+    u32 Grow(u32 seed, bool fan, int rotation, u32* out) {
+        const u32* tri = triangles + seed * 3;
+        u32 first = tri[rotation];
+        u32 p = tri[(rotation + 1) % 3];
+        u32 q = tri[(rotation + 2) % 3];
+
+        used[seed] = out ? COMMITTED : stamp;
+        if (out) {
+            out[0] = first;
+            out[1] = p;
+            out[2] = q;
+        }
+
+        u32 count = 1;
+        for (;;) {
+            // Strip triangle i is (v[i], v[i+1], v[i+2]) for even i and
+            // (v[i+1], v[i], v[i+2]) for odd i; fan triangles are (v[0], v[i+1], v[i+2])
+            u32 third = 0;
+            u32 next;
+            if (fan) {
+                next = FindNeighbor(first, q, third);
+            } else if (count & 1) {
+                next = FindNeighbor(q, p, third);
+            } else {
+                next = FindNeighbor(p, q, third);
+            }
+            if (next == NO_TRIANGLE) break;
+
+            used[next] = out ? COMMITTED : stamp;
+            if (out) {
+                out[count + 2] = third;
+            }
+            count++;
+            p = q;
+            q = third;
+        }
+        return count;
+    }
+};
+
+} // namespace
+
+bool Stripifier::Build(const u32* triangleIndices, u32 triangleCount,
+                       Arena& output, Arena& scratch, StripSet& result) {
+    const u32 rangeStarts[2] = { 0, triangleCount };
+    u32 primitiveStarts[2];
+    return Build(triangleIndices, triangleCount, rangeStarts, 1, output, scratch, result, primitiveStarts);
+}
+
+bool Stripifier::Build(const u32* triangleIndices, u32 triangleCount,
+                       const u32* rangeStarts, u32 rangeCount,
+                       Arena& output, Arena& scratch, StripSet& result, u32* primitiveStarts) {
+    result.Clear();
+    if (!triangleIndices || triangleCount == 0 || rangeCount == 0) {
+        return false;
+    }
+
+    const u32 cornerCount = triangleCount * 3;
+    u32 vertexCount = 0;
+    for (u32 i = 0; i < cornerCount; i++) {
+        if (triangleIndices[i] >= vertexCount) vertexCount = triangleIndices[i] + 1;
+    }
+
+    // Vertex-to-triangle table, usage tags and the primitive list are
+    // temporary. Every run of k >= 2 triangles needs at most 2k indices, so
+    // runs fill the index buffer from the front and loose triangles from the
+    // back without the two ever meeting.
+    u32 scratchMarker = scratch.GetMarker();
+    u32 maxPrimitives = triangleCount / 2 + rangeCount;
+    u32* faceStart = static_cast<u32*>(scratch.Allocate((vertexCount + 1) * sizeof(u32)));
+    u32* faceList = static_cast<u32*>(scratch.Allocate(cornerCount * sizeof(u32)));
+    u32* used = static_cast<u32*>(scratch.Allocate(triangleCount * sizeof(u32)));
+    StripPrimitive* runs = static_cast<StripPrimitive*>(scratch.Allocate(maxPrimitives * sizeof(StripPrimitive)));
+    if (!faceStart || !faceList || !used || !runs) {
+        Log::Print("ERROR: Stripification needs more than %u KB of scratch memory\n",
+               scratch.GetCapacity() / 1024);
+        scratch.ResetToMarker(scratchMarker);
+        return false;
+    }
+
+    u32* indices = static_cast<u32*>(output.Allocate(cornerCount * sizeof(u32)));
+    if (!indices) {
+        Log::Print("ERROR: Strip indices need %u KB but only %u KB are free\n",
+               cornerCount * static_cast<u32>(sizeof(u32)) / 1024, output.GetRemaining() / 1024);
+        scratch.ResetToMarker(scratchMarker);
+        return false;
+    }
+
+    memset(faceStart, 0, (vertexCount + 1) * sizeof(u32));
+    for (u32 i = 0; i < cornerCount; i++) {
+        faceStart[triangleIndices[i] + 1]++;
+    }
+    for (u32 v = 0; v < vertexCount; v++) {
+        faceStart[v + 1] += faceStart[v];
+    }
+    // Fill using faceStart[v] as a cursor, then shift the offsets back
+    for (u32 i = 0; i < cornerCount; i++) {
+        faceList[faceStart[triangleIndices[i]]++] = i / 3;
+    }
+    for (u32 v = vertexCount; v > 0; v--) {
+        faceStart[v] = faceStart[v - 1];
+    }
+    faceStart[0] = 0;
+
+    memset(used, 0, triangleCount * sizeof(u32));
+
+    StripBuilder builder;
+    builder.triangles = triangleIndices;
+    builder.faceStart = faceStart;
+    builder.faceList = faceList;
+    builder.used = used;
+    builder.stamp = 0;
+
+    u32 front = 0;
+    u32 back = cornerCount;
+    u32 runCount = 0;
+
+    for (u32 range = 0; range < rangeCount; range++) {
+        builder.rangeBegin = rangeStarts[range];
+        builder.rangeEnd = rangeStarts[range + 1];
+        primitiveStarts[range] = runCount;
+
+        for (u32 seed = builder.rangeBegin; seed < builder.rangeEnd; seed++) {
+            if (used[seed] == COMMITTED) continue;
+
+            const u32* tri = triangleIndices + seed * 3;
+            bool degenerate = (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]);
+
+            u32 bestLength = 1;
+            bool bestFan = false;
+            int bestRotation = 0;
+            for (int option = 0; option < 6 && !degenerate; option++) {
+                bool fan = (option >= 3);
+                int rotation = option % 3;
+                builder.stamp++;
+                u32 length = builder.Grow(seed, fan, rotation, nullptr);
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestFan = fan;
+                    bestRotation = rotation;
+                }
+            }
+            builder.stamp++;
+
+            if (bestLength == 1) {
+                used[seed] = COMMITTED;
+                back -= 3;
+                indices[back] = tri[0];
+                indices[back + 1] = tri[1];
+                indices[back + 2] = tri[2];
+                result.looseTriangleCount++;
+                continue;
+            }
+
+            u32 length = builder.Grow(seed, bestFan, bestRotation, indices + front);
+            StripPrimitive& run = runs[runCount++];
+            run.type = bestFan ? STRIP_PRIMITIVE_FAN : STRIP_PRIMITIVE_STRIP;
+            run.firstIndex = front;
+            run.indexCount = length + 2;
+            front += run.indexCount;
+
+            if (bestFan) {
+                result.fanCount++;
+            } else {
+                result.stripCount++;
+            }
+        }
+
+        // Loose triangles go last in their range, as one independent-triangle run
+        u32 looseIndices = cornerCount - back;
+        if (looseIndices > 0) {
+            memmove(indices + front, indices + back, looseIndices * sizeof(u32));
+            StripPrimitive& run = runs[runCount++];
+            run.type = STRIP_PRIMITIVE_TRIANGLES;
+            run.firstIndex = front;
+            run.indexCount = looseIndices;
+            front += looseIndices;
+            back = cornerCount;
+        }
+    }
+    primitiveStarts[rangeCount] = runCount;
+
+    output.Resize(indices, front * sizeof(u32));
+    StripPrimitive* primitives = static_cast<StripPrimitive*>(output.Allocate(runCount * sizeof(StripPrimitive)));
+    if (!primitives) {
+        Log::Print("ERROR: Strip primitive list needs %u KB but only %u KB are free\n",
+               runCount * static_cast<u32>(sizeof(StripPrimitive)) / 1024, output.GetRemaining() / 1024);
+        scratch.ResetToMarker(scratchMarker);
+        result.Clear();
+        return false;
+    }
+    memcpy(primitives, runs, runCount * sizeof(StripPrimitive));
+    scratch.ResetToMarker(scratchMarker);
+
+    result.indices = indices;
+    result.indexCount = front;
+    result.primitives = primitives;
+    result.primitiveCount = runCount;
+    result.triangleCount = triangleCount;
+    return true;
+}
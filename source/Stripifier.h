@@ -0,0 +1,87 @@
+#ifndef STRIPIFIER_H
+#define STRIPIFIER_H
+
+#include "Platform.h"
+#include "Arena.h"
+
+/**
+ * Kind of primitive produced by the stripifier. Each maps directly onto a
+ * GX primitive type.
+ */
+enum StripPrimitiveType {
+    STRIP_PRIMITIVE_TRIANGLES,  // Independent triangles, three indices each
+    STRIP_PRIMITIVE_STRIP,      // GX_TRIANGLESTRIP
+    STRIP_PRIMITIVE_FAN         // GX_TRIANGLEFAN
+};
+
+/**
+ * One run of indices submitted as a single primitive
+ */
+struct StripPrimitive {
+    u8 type;
+    u32 firstIndex;
+    u32 indexCount;
+
+    u32 GetTriangleCount() const {
+        return type == STRIP_PRIMITIVE_TRIANGLES ? indexCount / 3 : indexCount - 2;
+    }
+};
+
+/**
+ * Strips and fans covering every triangle of an indexed mesh. Triangles
+ * that could not join a longer primitive are gathered into one
+ * STRIP_PRIMITIVE_TRIANGLES run at the end (of each range, see Build).
+ */
+struct StripSet {
+    u32* indices;
+    u32 indexCount;
+    StripPrimitive* primitives;
+    u32 primitiveCount;
+
+    u32 triangleCount;
+    u32 stripCount;
+    u32 fanCount;
+    u32 looseTriangleCount;
+
+    StripSet() { Clear(); }
+
+    void Clear() {
+        indices = nullptr;
+        indexCount = 0;
+        primitives = nullptr;
+        primitiveCount = 0;
+        triangleCount = 0;
+        stripCount = 0;
+        fanCount = 0;
+        looseTriangleCount = 0;
+    }
+
+    // Average triangles per strip or fan, ignoring loose triangles
+    f32 GetAverageStripLength() const;
+
+    // Vertices sent to the transform unit per triangle drawn (3.0 for lists)
+    f32 GetVerticesPerTriangle() const;
+};
+
+/**
+ * Greedy triangle stripifier. Walks edge adjacency from each unused
+ * triangle, tries a strip in all three directions and a fan around each
+ * corner, and keeps whichever covers the most triangles.
+ */
+class Stripifier {
+public:
+    // Build strips for triangleCount triangles of three indices each.
+    // Results are allocated from output; temporary tables from scratch.
+    static bool Build(const u32* triangleIndices, u32 triangleCount,
+                      Arena& output, Arena& scratch, StripSet& result);
+
+    // As above, but runs never cross from one triangle range to the next
+    // and each range's primitives stay together. rangeStarts holds
+    // rangeCount + 1 triangle offsets; primitiveStarts receives as many
+    // offsets into the primitive list.
+    static bool Build(const u32* triangleIndices, u32 triangleCount,
+                      const u32* rangeStarts, u32 rangeCount,
+                      Arena& output, Arena& scratch, StripSet& result, u32* primitiveStarts);
+};
+
+#endif // STRIPIFIER_H
@@ -0,0 +1,65 @@
+#include "Thread.h"
+
+#ifdef HOST_BUILD
+
+Thread::Thread() : started(false) {
+}
+
+bool Thread::Start(EntryPoint entry, void* arg) {
+    if (started) {
+        return false;
+    }
+    started = (pthread_create(&handle, nullptr, entry, arg) == 0);
+    return started;
+}
+
+void Thread::Join() {
+    if (started) {
+        pthread_join(handle, nullptr);
+        started = false;
+    }
+}
+
+Thread::Id Thread::GetCurrentId() {
+    return pthread_self();
+}
+
+bool Thread::IsCurrent(Id id) {
+    return pthread_equal(id, pthread_self()) != 0;
+}
+
+#else
+
+Thread::Thread() : handle(LWP_THREAD_NULL), started(false) {
+}
+
+bool Thread::Start(EntryPoint entry, void* arg) {
+    if (started) {
+        return false;
+    }
+    // A null stack base lets LWP allocate the stack itself
+    started = (LWP_CreateThread(&handle, entry, arg, nullptr, STACK_SIZE, PRIORITY) == 0);
+    return started;
+}
+
+void Thread::Join() {
+    if (started) {
+        LWP_JoinThread(handle, nullptr);
+        handle = LWP_THREAD_NULL;
+        started = false;
+    }
+}
+
+Thread::Id Thread::GetCurrentId() {
+    return LWP_GetSelf();
+}
+
+bool Thread::IsCurrent(Id id) {
+    return id == LWP_GetSelf();
+}
+
+#endif
+
+Thread::~Thread() {
+    Join();
+}
@@ -0,0 +1,46 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+#ifdef HOST_BUILD
+#include <pthread.h>
+#else
+#include <gccore.h>
+#include <ogc/lwp.h>
+#endif
+
+/**
+ * Minimal joinable thread: LWP on the console, pthreads in host builds
+ */
+class Thread {
+public:
+    typedef void* (*EntryPoint)(void* arg);
+#ifdef HOST_BUILD
+    typedef pthread_t Id;
+#else
+    typedef lwp_t Id;
+#endif
+
+    Thread();
+    ~Thread();
+
+    bool Start(EntryPoint entry, void* arg);
+    void Join();
+    bool IsStarted() const { return started; }
+
+    // The calling thread, whether or not it was started through this class
+    static Id GetCurrentId();
+    static bool IsCurrent(Id id);
+
+private:
+#ifdef HOST_BUILD
+    pthread_t handle;
+#else
+    lwp_t handle;
+
+    static const unsigned int STACK_SIZE = 32 * 1024;
+    static const unsigned char PRIORITY = 48; // Below the main thread (64)
+#endif
+    bool started;
+};
+
+#endif // THREAD_H
@@ -5,7 +5,7 @@
 #include <iomanip>
 
 UI::UI() : videoMode(nullptr), consoleBuffer(nullptr), initialized(false),
-           consoleWidth(80), consoleHeight(24) {
+           consoleWidth(80), consoleHeight(24), loadingFrame(0) {
 }
 
 UI::~UI() {
@@ -39,11 +39,17 @@ void UI::ShowMainMenu(const FileManager& fileManager, int selectedIndex) {
     // File selection box
     ShowFileSelectionBox(fileManager, selectedIndex);
 
-    // Instructions
-    int instructionY = 18;
+    // The list shown may be from the index while the media is rechecked
+    if (!fileManager.IsIndexUpToDate()) {
+        PrintCentered(4, "Checking files...");
+    }
+
+    // Instructions, ending on the last of the 27 rows a 480-line mode has
+    int instructionY = 23;
     PrintCentered(instructionY++, "Controls:");
     PrintCentered(instructionY++, "UP/DOWN - Navigate files  |  A - Load file  |  START - Exit");
     PrintCentered(instructionY++, "3D View: Analog stick - Rotate  |  L/R - Zoom  |  B - Back to menu");
+    PrintCentered(instructionY++, "X - Color scheme  |  A - Baked lighting  |  Y - Performance HUD");
 }
 
 void UI::ShowFileSelectionBox(const FileManager& fileManager, int selectedIndex) {
@@ -69,14 +75,41 @@ void UI::ShowFileSelectionBox(const FileManager& fileManager, int selectedIndex)
         if (selectedIndex >= 0 && selectedIndex < static_cast<int>(files.size())) {
             const FileEntry& selectedFile = files[selectedIndex];
 
-            UIBox infoBox(boxX, boxY + boxHeight + 1, boxWidth, 4, "Selected File");
+            UIBox infoBox(boxX, boxY + boxHeight + 1, boxWidth, 6, "Selected File");
             DrawBox(infoBox);
 
             std::string filename = "File: " + selectedFile.name;
-            std::string filesize = "Size: " + FormatFileSize(selectedFile.size);
-
             PrintAt(boxX + 2, boxY + boxHeight + 3, TruncateText(filename, boxWidth - 4));
-            PrintAt(boxX + 2, boxY + boxHeight + 4, filesize);
+
+            // Known from the file index without loading the model
+            const char* format = "checking";
+            if (selectedFile.flags & FILE_INFO_PROBED) {
+                format = (selectedFile.flags & FILE_INFO_BINARY) ? "binary" : "ASCII";
+            }
+            char line[80];
+            char triangles[24];
+            if (selectedFile.triangleCount > 0) {
+                snprintf(triangles, sizeof(triangles), "%u", selectedFile.triangleCount);
+            } else {
+                snprintf(triangles, sizeof(triangles), "%s",
+                         (selectedFile.flags & FILE_INFO_PROBED) ? "counted on load" : "-");
+            }
+            snprintf(line, sizeof(line), "Size: %s  Format: %s  Triangles: %s",
+                     FormatFileSize(selectedFile.size).c_str(), format, triangles);
+            PrintAt(boxX + 2, boxY + boxHeight + 4, TruncateText(line, boxWidth - 4));
+
+            bool loaded = (selectedFile.flags & FILE_INFO_LOADED) != 0;
+            u32 memoryBytes = selectedFile.GetMemoryBytes();
+            std::string memory = memoryBytes > 0 ? FormatFileSize(memoryBytes) : std::string("-");
+            snprintf(line, sizeof(line), "Memory: %s%s", (loaded || memoryBytes == 0) ? "" : "~", memory.c_str());
+            if (loaded) {
+                const Vector3& minBounds = selectedFile.minBounds;
+                const Vector3& maxBounds = selectedFile.maxBounds;
+                size_t length = strlen(line);
+                snprintf(line + length, sizeof(line) - length, "  Bounds: %.1f x %.1f x %.1f",
+                         maxBounds.x - minBounds.x, maxBounds.y - minBounds.y, maxBounds.z - minBounds.z);
+            }
+            PrintAt(boxX + 2, boxY + boxHeight + 5, TruncateText(line, boxWidth - 4));
         }
     }
 }
@@ -96,15 +129,34 @@ void UI::ShowStatusBox(const std::string& status) {
 void UI::ShowLoadingScreen(const std::string& filename) {
     ClearScreen();
 
-    PrintCentered(10, "Loading STL File...");
-    PrintCentered(12, filename);
-    PrintCentered(14, "Please wait...");
+    PrintCentered(8, "Loading STL File...");
+    PrintCentered(10, filename);
+    PrintCentered(19, "B - Cancel");
+
+    loadingFrame = 0;
+    ShowLoadingProgress("Reading", 0, 0, 0);
+}
+
+void UI::ShowLoadingProgress(const char* phase, u32 bytesProcessed, u32 bytesTotal, u32 triangles) {
+    const int barWidth = 40;
+    int percent = (bytesTotal > 0) ? static_cast<int>((static_cast<u64>(bytesProcessed) * 100) / bytesTotal) : 0;
+    if (percent > 100) percent = 100;
+    int filled = percent * barWidth / 100;
 
-    // Simple loading animation
-    static int loadingFrame = 0;
+    // Rewrite every line in full so shorter text leaves nothing behind
     const char* loadingChars = "|/-\\";
-    char loadingStr[3] = {loadingChars[loadingFrame % 4], ' ', '\0'};
-    PrintCentered(16, loadingStr);
+    char line[81];
+    snprintf(line, sizeof(line), "%c %-24s", loadingChars[loadingFrame % 4], phase);
+    PrintCentered(12, line);
+
+    std::string bar = "[" + std::string(filled, '#') + std::string(barWidth - filled, '-') + "]";
+    snprintf(line, sizeof(line), "%s %3d%%", bar.c_str(), percent);
+    PrintCentered(14, line);
+
+    std::string sizes = FormatFileSize(bytesProcessed) + " / " + FormatFileSize(bytesTotal);
+    snprintf(line, sizeof(line), "%-22s %10u triangles", sizes.c_str(), triangles);
+    PrintCentered(16, line);
+
     loadingFrame++;
 }
 
@@ -47,6 +47,7 @@ public:
     void ShowFileSelectionBox(const FileManager& fileManager, int selectedIndex);
     void ShowStatusBox(const std::string& status);
     void ShowLoadingScreen(const std::string& filename);
+    void ShowLoadingProgress(const char* phase, u32 bytesProcessed, u32 bytesTotal, u32 triangles);
 
     // Screen management
     void ClearScreen();
@@ -80,6 +81,8 @@ private:
     static const char BORDER_CORNER = '+';
     static const char SELECTION_MARKER = '>';
 
+    int loadingFrame;
+
     void InitializeConsole();
     void DrawHorizontalLine(int x, int y, int length, char character = BORDER_HORIZONTAL);
     void DrawVerticalLine(int x, int y, int length, char character = BORDER_VERTICAL);
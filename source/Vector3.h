@@ -0,0 +1,16 @@
+#ifndef VECTOR3_H
+#define VECTOR3_H
+
+#include "Platform.h"
+
+/**
+ * 3D Vector structure
+ */
+struct Vector3 {
+    f32 x, y, z;
+
+    Vector3() : x(0), y(0), z(0) {}
+    Vector3(f32 x_, f32 y_, f32 z_) : x(x_), y(y_), z(z_) {}
+};
+
+#endif // VECTOR3_H
@@ -0,0 +1,249 @@
+#include "VertexCacheOptimizer.h"
+#include "Log.h"
+#include <cstring>
+#include <cmath>
+
+namespace {
+
+// Scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+const f32 CACHE_DECAY_POWER = 1.5f;
+const f32 LAST_TRIANGLE_SCORE = 0.75f;
+const f32 VALENCE_BOOST_SCALE = 2.0f;
+const f32 VALENCE_BOOST_POWER = 0.5f;
+const u32 VALENCE_TABLE_SIZE = 32;
+
+const u32 EMPTY = 0xffffffff;
+
+/**
+ * Precomputed vertex scores by cache position and remaining valence
+ */
+struct ScoreTable {
+    f32 cache[VertexCacheOptimizer::MAX_CACHE_SIZE];
+    f32 valence[VALENCE_TABLE_SIZE];
+
+    explicit ScoreTable(u32 cacheSize) {
+        for (u32 i = 0; i < cacheSize; i++) {
+            // The three vertices of the last triangle get a fixed score so
+            // the next triangle does not simply reuse the same edge
+            if (i < 3) {
+                cache[i] = LAST_TRIANGLE_SCORE;
+            } else {
+                f32 scale = 1.0f / static_cast<f32>(cacheSize - 3);
+                cache[i] = powf(1.0f - static_cast<f32>(i - 3) * scale, CACHE_DECAY_POWER);
+            }
+        }
+        for (u32 i = 0; i < VALENCE_TABLE_SIZE; i++) {
+            valence[i] = ValenceScore(i);
+        }
+    }
+
+    static f32 ValenceScore(u32 remaining) {
+        return remaining == 0 ? 0.0f
+                              : VALENCE_BOOST_SCALE * powf(static_cast<f32>(remaining), -VALENCE_BOOST_POWER);
+    }
+
+    // Vertices with no triangles left score -1 so they never attract work
+    f32 Score(s32 cachePosition, u32 remaining) const {
+        if (remaining == 0) return -1.0f;
+        f32 score = (cachePosition >= 0) ? cache[cachePosition] : 0.0f;
+        return score + (remaining < VALENCE_TABLE_SIZE ? valence[remaining] : ValenceScore(remaining));
+    }
+};
+
+} // namespace
+
+bool VertexCacheOptimizer::OptimizeTriangles(u32* indices, u32 triangleCount, u32 vertexCount,
+                                             u32 cacheSize, Arena& scratch) {
+    if (!indices || triangleCount == 0) {
+        return false;
+    }
+    if (cacheSize < 4) cacheSize = 4;
+    if (cacheSize > MAX_CACHE_SIZE) cacheSize = MAX_CACHE_SIZE;
+
+    const u32 cornerCount = triangleCount * 3;
+
+    u32 scratchMarker = scratch.GetMarker();
+    u32* remaining = static_cast<u32*>(scratch.Allocate(vertexCount * sizeof(u32)));
+    u32* triangleStart = static_cast<u32*>(scratch.Allocate((vertexCount + 1) * sizeof(u32)));
+    u32* vertexTriangles = static_cast<u32*>(scratch.Allocate(cornerCount * sizeof(u32)));
+    s32* cachePosition = static_cast<s32*>(scratch.Allocate(vertexCount * sizeof(s32)));
+    f32* vertexScore = static_cast<f32*>(scratch.Allocate(vertexCount * sizeof(f32)));
+    f32* triangleScore = static_cast<f32*>(scratch.Allocate(triangleCount * sizeof(f32)));
+    u8* emitted = static_cast<u8*>(scratch.Allocate(triangleCount));
+    u32* output = static_cast<u32*>(scratch.Allocate(cornerCount * sizeof(u32)));
+    if (!remaining || !triangleStart || !vertexTriangles || !cachePosition ||
+        !vertexScore || !triangleScore || !emitted || !output) {
+        Log::Print("ERROR: Vertex cache optimization needs more than %u KB of scratch memory\n",
+               scratch.GetCapacity() / 1024);
+        scratch.ResetToMarker(scratchMarker);
+        return false;
+    }
+
+    // Vertex-to-triangle table; each vertex's live triangles are kept at
+    // the front of its range, remaining[v] of them
+    memset(remaining, 0, vertexCount * sizeof(u32));
+    for (u32 i = 0; i < cornerCount; i++) {
+        remaining[indices[i]]++;
+    }
+    triangleStart[0] = 0;
+    for (u32 v = 0; v < vertexCount; v++) {
+        triangleStart[v + 1] = triangleStart[v] + remaining[v];
+        remaining[v] = 0;
+    }
+    for (u32 i = 0; i < cornerCount; i++) {
+        u32 v = indices[i];
+        vertexTriangles[triangleStart[v] + remaining[v]++] = i / 3;
+    }
+
+    ScoreTable table(cacheSize);
+    for (u32 v = 0; v < vertexCount; v++) {
+        cachePosition[v] = -1;
+        vertexScore[v] = table.Score(-1, remaining[v]);
+    }
+    for (u32 t = 0; t < triangleCount; t++) {
+        const u32* tri = indices + t * 3;
+        triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+    }
+    memset(emitted, 0, triangleCount);
+
+    // LRU cache with room for the three vertices pushed ahead of it
+    u32 cache[MAX_CACHE_SIZE + 3];
+    u32 cacheCount = 0;
+
+    u32 best = EMPTY;
+    f32 bestScore = -1.0f;
+    for (u32 t = 0; t < triangleCount; t++) {
+        if (triangleScore[t] > bestScore) {
+            bestScore = triangleScore[t];
+            best = t;
+        }
+    }
+
+    u32 scanCursor = 0;
+    for (u32 out = 0; out < triangleCount; out++) {
+        // With nothing scoring in the cache, continue from the next triangle
+        // not yet emitted rather than rescanning the whole mesh
+        if (best == EMPTY) {
+            while (emitted[scanCursor]) scanCursor++;
+            best = scanCursor;
+        }
+
+        const u32* tri = indices + best * 3;
+        emitted[best] = 1;
+        output[out * 3] = tri[0];
+        output[out * 3 + 1] = tri[1];
+        output[out * 3 + 2] = tri[2];
+
+        // Retire the triangle from its vertices' live lists
+        for (int k = 0; k < 3; k++) {
+            u32 v = tri[k];
+            u32* list = vertexTriangles + triangleStart[v];
+            for (u32 i = 0; i < remaining[v]; i++) {
+                if (list[i] == best) {
+                    list[i] = list[remaining[v] - 1];
+                    list[remaining[v] - 1] = best;
+                    remaining[v]--;
+                    break;
+                }
+            }
+        }
+
+        // Move the triangle's vertices to the front of the cache
+        u32 updated[MAX_CACHE_SIZE + 3];
+        u32 updatedCount = 0;
+        for (int k = 0; k < 3; k++) {
+            bool duplicate = false;
+            for (u32 i = 0; i < updatedCount; i++) {
+                duplicate = duplicate || updated[i] == tri[k];
+            }
+            if (!duplicate) updated[updatedCount++] = tri[k];
+        }
+        for (u32 i = 0; i < cacheCount; i++) {
+            u32 v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                updated[updatedCount++] = v;
+            }
+        }
+
+        // Rescore everything that moved, including the entries pushed out,
+        // and look for the best triangle around the cache
+        best = EMPTY;
+        bestScore = -1.0f;
+        for (u32 i = 0; i < updatedCount; i++) {
+            u32 v = updated[i];
+            cachePosition[v] = (i < cacheSize) ? static_cast<s32>(i) : -1;
+
+            f32 score = table.Score(cachePosition[v], remaining[v]);
+            f32 delta = score - vertexScore[v];
+            vertexScore[v] = score;
+
+            const u32* list = vertexTriangles + triangleStart[v];
+            for (u32 j = 0; j < remaining[v]; j++) {
+                u32 t = list[j];
+                triangleScore[t] += delta;
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+
+        cacheCount = (updatedCount < cacheSize) ? updatedCount : cacheSize;
+        memcpy(cache, updated, cacheCount * sizeof(u32));
+    }
+
+    memcpy(indices, output, cornerCount * sizeof(u32));
+    scratch.ResetToMarker(scratchMarker);
+    return true;
+}
+
+u32 VertexCacheOptimizer::BuildFetchOrder(u32* indices, u32 indexCount, u32 vertexCount, u32* remap) {
+    memset(remap, 0xff, vertexCount * sizeof(u32));
+
+    u32 next = 0;
+    for (u32 i = 0; i < indexCount; i++) {
+        u32& slot = remap[indices[i]];
+        if (slot == EMPTY) {
+            slot = next++;
+        }
+        indices[i] = slot;
+    }
+
+    u32 referenced = next;
+    for (u32 v = 0; v < vertexCount; v++) {
+        if (remap[v] == EMPTY) {
+            remap[v] = next++;
+        }
+    }
+    return referenced;
+}
+
+f32 VertexCacheOptimizer::ComputeACMR(const u32* indices, u32 indexCount, u32 triangleCount, u32 cacheSize) {
+    if (triangleCount == 0) return 0.0f;
+    if (cacheSize > MAX_CACHE_SIZE) cacheSize = MAX_CACHE_SIZE;
+
+    // FIFO replacement: hits do not refresh an entry
+    u32 cache[MAX_CACHE_SIZE];
+    u32 filled = 0;
+    u32 oldest = 0;
+    u32 misses = 0;
+
+    for (u32 i = 0; i < indexCount; i++) {
+        bool hit = false;
+        for (u32 j = 0; j < filled && !hit; j++) {
+            hit = (cache[j] == indices[i]);
+        }
+        if (hit) continue;
+
+        misses++;
+        if (cacheSize == 0) continue;
+        if (filled < cacheSize) {
+            cache[filled++] = indices[i];
+        } else {
+            cache[oldest] = indices[i];
+            oldest = (oldest + 1) % cacheSize;
+        }
+    }
+
+    return static_cast<f32>(misses) / static_cast<f32>(triangleCount);
+}
@@ -0,0 +1,34 @@
+#ifndef VERTEX_CACHE_OPTIMIZER_H
+#define VERTEX_CACHE_OPTIMIZER_H
+
+#include "Platform.h"
+#include "Arena.h"
+
+/**
+ * Reorders indexed triangles for post-transform vertex cache reuse using
+ * Tom Forsyth's linear-speed algorithm, and measures the result with a
+ * FIFO cache simulator.
+ */
+class VertexCacheOptimizer {
+public:
+    // Cache size assumed for the GX transform unit; every entry point takes
+    // the size as a parameter so other sizes can be simulated
+    static const u32 DEFAULT_CACHE_SIZE = 16;
+    static const u32 MAX_CACHE_SIZE = 64;
+
+    // Reorder triangleCount triangles of three indices each in place.
+    // Temporary tables come from scratch.
+    static bool OptimizeTriangles(u32* indices, u32 triangleCount, u32 vertexCount,
+                                  u32 cacheSize, Arena& scratch);
+
+    // Renumber vertices in order of first use so fetches walk the vertex
+    // arrays forwards. remap receives the new index of each old vertex;
+    // unreferenced vertices are numbered last. Returns the referenced count.
+    static u32 BuildFetchOrder(u32* indices, u32 indexCount, u32 vertexCount, u32* remap);
+
+    // Average cache miss ratio: vertices transformed per triangle when the
+    // index stream is fed through a FIFO cache of the given size
+    static f32 ComputeACMR(const u32* indices, u32 indexCount, u32 triangleCount, u32 cacheSize);
+};
+
+#endif // VERTEX_CACHE_OPTIMIZER_H